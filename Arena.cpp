@@ -0,0 +1,188 @@
+#include "Arena.hpp"
+#include "Collision.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//Fighters only walk left and right, so those in the same row share a head height
+// (compared to within the rules' time rift distance, RewindParams::overlap_dist):
+inline bool same_row(glm::vec2 a, glm::vec2 b, float overlap_dist) {
+	return std::abs(a.y - b.y) <= overlap_dist;
+}
+
+//Bounding box of the parts of a fighter a sword can hit (see body_shapes):
+inline void body_bounds(player_info const &player, glm::vec2 *min, glm::vec2 *max) {
+	float reach = std::max(std::abs(player_body.left_arm_radius.x), std::abs(player_body.right_arm_radius.x)) + 0.2f;
+	*min = glm::vec2(player.head.x - reach, player.left_leg().y - player_body.left_leg_radius.y);
+	*max = glm::vec2(player.head.x + reach, player.head.y + player_body.head_radius.y);
+}
+
+}
+
+RewindArena::RewindArena(size_t count, float tick_rate_, RewindParams const &params_) : tick_rate(tick_rate_), tick(1.0f / tick_rate_), params(params_) {
+	//rows a bit over twice as wide as the court is tall:
+	uint32_t columns = std::max(2u, uint32_t(std::ceil(std::sqrt(float(count) * 2.0f))));
+	uint32_t rows = std::max(1u, uint32_t((count + columns - 1) / columns));
+	court_radius = glm::vec2(0.5f * (columns - 1) * ARENA_SPACING + 4.0f, 0.5f * rows * ARENA_ROW_SPACING);
+
+	fighters.reserve(count);
+	spawns.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t column = uint32_t(i % columns);
+		uint32_t row = uint32_t(i / columns);
+		glm::vec2 spawn = glm::vec2(
+			(column - 0.5f * (columns - 1)) * ARENA_SPACING,
+			court_radius.y - row * ARENA_ROW_SPACING - 1.0f
+		);
+		spawns.emplace_back(spawn);
+		if (i % 2 == 0) {
+			fighters.emplace_back(spawn, PLAYER_ONE, PALETTE_PLAYER_ONE);
+		} else {
+			fighters.emplace_back(spawn, PLAYER_TWO, PALETTE_PLAYER_TWO);
+		}
+		//size rewind logs for the actual tick rate and rules:
+		fighters.back().rewind_log = RewindLog(rewind_log_size(params, tick_rate));
+	}
+	kills.assign(count, 0);
+	deaths.assign(count, 0);
+
+	//(cells also have to cover the walls and time rifts between neighbors, which params may have made wider)
+	grid.resize(court_radius, std::max(ARENA_CELL_SIZE, std::max(params.max_dist, params.overlap_dist)));
+	heads.resize(count);
+	dead.resize(count);
+}
+
+void RewindArena::walk_fighter(uint32_t i, int right_or_left, float walk) {
+	player_info &player = fighters[i];
+	int forward = (player.sword_arm == PLAYER_ONE ? RIGHT : LEFT);
+
+	glm::vec2 pos;
+	if (right_or_left == forward) {
+		//There's an invisible wall between a fighter and the neighbors in their row:
+		bool blocked = false;
+		for_each_near(i, [&](uint32_t j){
+			if (same_row(heads[i], heads[j], params.overlap_dist) && std::abs(heads[i].x - heads[j].x) <= params.max_dist) blocked = true;
+		});
+		if (blocked) return;
+
+		//The sword tip has to stay in the court:
+		glm::vec2 points[3];
+		get_sword_points(player, sword_tip_length, points);
+		pos = points[1];
+	} else {
+		//The back hand has to stay in the court:
+		glm::vec2 arm = (player.sword_arm == PLAYER_ONE ? player.left_arm() : player.right_arm());
+		glm::vec2 arm_radius = (player.sword_arm == PLAYER_ONE ? player_body.left_arm_radius : player_body.right_arm_radius);
+		float angle = (player.sword_arm == PLAYER_ONE ? player.left_arm_angle : player.right_arm_angle);
+		pos = glm::vec2(arm.x + arm_radius.x * get_cos(angle), arm.y - arm_radius.x * get_sin(angle));
+	}
+
+	if (pos.x <= court_radius.x && pos.x >= -court_radius.x) {
+		player.update_coords(glm::vec2(player.head.x + (right_or_left == RIGHT ? walk : -walk), player.head.y));
+	}
+}
+
+void RewindArena::step(uint8_t const *inputs) {
+	uint32_t count = uint32_t(fighters.size());
+	float elapsed = tick;
+	float ticks = elapsed * TICK_RATE;
+	float walk = params.walk_speed * ticks;
+
+	/* ----------------------- INPUT ----------------------- */
+
+	for (uint32_t i = 0; i < count; ++i) {
+		apply_input(inputs[i], fighters[i], 0);
+	}
+
+	/* --------------- MOVEMENT AND ATTACKS  --------------- */
+
+	//Everyone moves at once, so walls between neighbors use where they were at the start of the tick:
+	for (uint32_t i = 0; i < count; ++i) {
+		heads[i] = fighters[i].head;
+	}
+	if (use_grid) grid.build(heads.data(), count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		player_info &player = fighters[i];
+		if (player.is_rewinding == 0) {
+			update_cooldown(player, elapsed, params);
+			update_swing(player, ticks, params);
+
+			//If you're holding both keys down, you don't move
+			if (player.left_walk == 1 && player.right_walk == 0) {
+				walk_fighter(i, LEFT, walk);
+			} else if (player.left_walk == 0 && player.right_walk == 1) {
+				walk_fighter(i, RIGHT, walk);
+			}
+
+			float angle = (player.sword_arm == PLAYER_ONE ? player.right_arm_angle : player.left_arm_angle);
+			player.rewind_log.push_front(glm::vec4(player.head.x, player.head.y, angle, player.is_attacking));
+		} else {
+			update_rewind(player, elapsed, params);
+		}
+	}
+
+	/* ---------------- COLLISION DETECTION ---------------- */
+
+	for (uint32_t i = 0; i < count; ++i) {
+		heads[i] = fighters[i].head;
+	}
+	if (use_grid) grid.build(heads.data(), count);
+	std::fill(dead.begin(), dead.end(), 0);
+
+	//A rewinding fighter who runs into a neighbor loses (the kill goes to the lowest-numbered neighbor, so it doesn't depend on search order):
+	for (uint32_t i = 0; i < count; ++i) {
+		if (fighters[i].is_rewinding != 1) continue;
+		uint32_t by = count;
+		for_each_near(i, [&](uint32_t j){
+			if (same_row(heads[i], heads[j], params.overlap_dist) && std::abs(heads[i].x - heads[j].x) <= params.overlap_dist) by = std::min(by, j);
+		});
+		if (by != count) {
+			dead[i] = 1;
+			kills[by] += 1;
+		}
+	}
+
+	/* -------------------- HIT DETECTION -------------------- */
+
+	//A swinging sword kills every fighter it touches (the whole sword against every body part, as with RewindSim::exact_hits):
+	for (uint32_t i = 0; i < count; ++i) {
+		if (fighters[i].is_attacking != 1) continue;
+		ConvexShape sword = sword_shape(fighters[i], sword_tip_length);
+		glm::vec2 sword_min = sword.corners[0], sword_max = sword.corners[0];
+		for (uint32_t c = 1; c < sword.count; ++c) {
+			sword_min = glm::min(sword_min, sword.corners[c]);
+			sword_max = glm::max(sword_max, sword.corners[c]);
+		}
+
+		for_each_near(i, [&](uint32_t j){
+			glm::vec2 body_min, body_max;
+			body_bounds(fighters[j], &body_min, &body_max);
+			if (sword_max.x < body_min.x || sword_min.x > body_max.x
+			 || sword_max.y < body_min.y || sword_min.y > body_max.y) return;
+
+			ConvexShape body[BodyPartCount];
+			body_shapes(fighters[j], body);
+			Contact contacts[BodyPartCount];
+			collide_one(sword, body, BodyPartCount, contacts);
+			for (auto const &contact : contacts) {
+				if (contact.hit) {
+					dead[j] = 1;
+					kills[i] += 1;
+					break;
+				}
+			}
+		});
+	}
+
+	/* -------------------- RESPAWN -------------------- */
+
+	for (uint32_t i = 0; i < count; ++i) {
+		if (dead[i]) {
+			deaths[i] += 1;
+			fighters[i].reset(spawns[i]);
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//Party mode: any number of fighters sharing one wide court, in rows.
+// Each fighter plays by the same per-player rules as RewindSim, but against
+// whoever is nearby: neighbors (found with a UniformGrid) block walking,
+// time rifts kill a rewinding fighter, and a sword kills any fighter it touches.
+// A killed fighter respawns where they started; there are no rounds.
+//
+// This is an add-on next to RewindSim, not a generalization of it: replays,
+// rollback, and the tools all still play two-player RewindSim matches (with
+// their rounds, scores, and one rewind at a time). The two share the
+// per-player rules and the player_palettes colors. 'rewind --arena <fighters>'
+// plays one (RewindMode draws every fighter; the keyboard controls the first
+// two and the rest mash buttons); rewind-bench arena measures about 160-220ns
+// per fighter per tick from 64 to 4096 fighters.
+
+#include "RewindSim.hpp"
+#include "UniformGrid.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Fighters start this far apart in a row, facing alternately right and left:
+#define ARENA_SPACING 4.0f
+//Rows are this far apart (a fighter is 5 tall, and a sword at rest reaches 1.7 above the head):
+#define ARENA_ROW_SPACING 7.0f
+//Grid cell size; has to cover the furthest one fighter can reach another from head to head
+// (a sword reaches 3.45 forward, a body 1.45 sideways; a sword reaches 1.7 up and a body 4.5 down):
+#define ARENA_CELL_SIZE 6.5f
+
+struct RewindArena {
+	//Sets up 'count' fighters, with the court sized to fit them:
+	RewindArena(size_t count, float tick_rate = TICK_RATE, RewindParams const &params = RewindParams());
+
+	//Advances every fighter by one tick; 'inputs' holds one input per fighter.
+	// Unlike a RewindSim match, any number of fighters may rewind at once.
+	void step(uint8_t const *inputs);
+
+	float tick_rate; //Ticks per second
+	float tick; //Seconds per tick (1.0f / tick_rate)
+	RewindParams params; //(as in RewindSim; only set by the constructor, since rewind logs and the grid are sized from it)
+
+	float sword_tip_length = 2.0f;
+	glm::vec2 court_radius;
+
+	std::vector< player_info > fighters;
+	std::vector< glm::vec2 > spawns; //where each fighter starts and respawns
+	std::vector< uint32_t > kills; //per fighter
+	std::vector< uint32_t > deaths; //per fighter
+
+	//false tests every pair of fighters instead of using the grid (for checking the grid; same results, slower):
+	bool use_grid = true;
+	uint64_t pair_tests = 0; //number of fighter pairs looked at so far
+
+	//Calls 'visit(j)' for (at least) every fighter j != i that fighter i could touch:
+	template< typename F >
+	void for_each_near(uint32_t i, F const &visit) {
+		if (use_grid) {
+			grid.for_each_near(heads[i], [&](uint32_t j){
+				if (j == i) return;
+				pair_tests += 1;
+				visit(j);
+			});
+		} else {
+			for (uint32_t j = 0; j < uint32_t(fighters.size()); ++j) {
+				if (j == i) continue;
+				pair_tests += 1;
+				visit(j);
+			}
+		}
+	}
+
+	//Walks fighter i one step left or right, unless a wall or a neighbor is in the way:
+	void walk_fighter(uint32_t i, int right_or_left, float walk);
+
+	//Scratch space, kept to avoid allocating every tick:
+	UniformGrid grid;
+	std::vector< glm::vec2 > heads; //fighters' heads when the grid was built
+	std::vector< uint8_t > dead; //fighters killed this tick
+};
@@ -0,0 +1,261 @@
+#include "Collision.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+ConvexShape box_shape(glm::vec2 center, glm::vec2 radius) {
+	ConvexShape shape;
+	shape.corners[0] = glm::vec2(center.x - radius.x, center.y - radius.y);
+	shape.corners[1] = glm::vec2(center.x + radius.x, center.y - radius.y);
+	shape.corners[2] = glm::vec2(center.x + radius.x, center.y + radius.y);
+	shape.corners[3] = glm::vec2(center.x - radius.x, center.y + radius.y);
+	shape.count = 4;
+	return shape;
+}
+
+ConvexShape arm_shape(glm::vec2 arm, glm::vec2 arm_radius, float angle) {
+	double sin_angle = get_sin(angle);
+	double cos_angle = get_cos(angle);
+	glm::vec2 hand = glm::vec2(arm.x + arm_radius.x * cos_angle, arm.y - arm_radius.x * sin_angle);
+
+	ConvexShape shape;
+	shape.corners[0] = arm;
+	shape.corners[1] = glm::vec2(arm.x, arm.y - arm_radius.y);
+	shape.corners[2] = glm::vec2(hand.x, hand.y - arm_radius.y);
+	shape.corners[3] = hand;
+	shape.count = 4;
+	return shape;
+}
+
+ConvexShape sword_shape(player_state const &player, float sword_tip_length) {
+	glm::vec2 points[3];
+	get_sword_points(player, sword_tip_length, points);
+
+	ConvexShape shape;
+	shape.corners[0] = points[0];
+	shape.corners[1] = points[1];
+	shape.corners[2] = points[2];
+	shape.count = 3;
+	return shape;
+}
+
+void body_shapes(player_state const &player, ConvexShape shapes[BodyPartCount]) {
+	shapes[BodyHead] = box_shape(player.head, player_body.head_radius);
+	shapes[BodyTorso] = box_shape(player.torso(), player_body.torso_radius);
+	shapes[BodyLeftArm] = arm_shape(player.left_arm(), player_body.left_arm_radius, player.left_arm_angle);
+	shapes[BodyRightArm] = arm_shape(player.right_arm(), player_body.right_arm_radius, player.right_arm_angle);
+	shapes[BodyLeftLeg] = box_shape(player.left_leg(), player_body.left_leg_radius);
+	shapes[BodyRightLeg] = box_shape(player.right_leg(), player_body.right_leg_radius);
+}
+
+namespace {
+
+//Projects the edge normals of 'from' onto both shapes; returns false as soon as one separates them.
+// Otherwise lowers 'depth' to the smallest overlap seen (with 'normal' the axis it was seen on).
+bool overlap_on_axes(ConvexShape const &from, ConvexShape const &a, ConvexShape const &b, float *depth, glm::vec2 *normal) {
+	for (uint32_t i = 0; i < from.count; ++i) {
+		glm::vec2 edge = from.corners[(i + 1 == from.count ? 0 : i + 1)] - from.corners[i];
+		glm::vec2 axis = glm::vec2(edge.y, -edge.x);
+		float length2 = axis.x * axis.x + axis.y * axis.y;
+		if (length2 == 0.0f) continue; //(repeated corner)
+
+		float a_min = std::numeric_limits< float >::infinity(), a_max = -a_min;
+		for (uint32_t c = 0; c < a.count; ++c) {
+			float d = axis.x * a.corners[c].x + axis.y * a.corners[c].y;
+			a_min = std::min(a_min, d);
+			a_max = std::max(a_max, d);
+		}
+		float b_min = std::numeric_limits< float >::infinity(), b_max = -b_min;
+		for (uint32_t c = 0; c < b.count; ++c) {
+			float d = axis.x * b.corners[c].x + axis.y * b.corners[c].y;
+			b_min = std::min(b_min, d);
+			b_max = std::max(b_max, d);
+		}
+
+		//distance 'b' would have to move along +axis or -axis to stop overlapping 'a':
+		float push_forward = a_max - b_min;
+		float push_back = b_max - a_min;
+		if (push_forward < 0.0f || push_back < 0.0f) return false;
+
+		float length = std::sqrt(length2);
+		float push = std::min(push_forward, push_back) / length;
+		if (push < *depth) {
+			*depth = push;
+			*normal = (push_forward <= push_back ? axis : -axis) / length;
+		}
+	}
+	return true;
+}
+
+inline Contact collide_pair(ConvexShape const &a, ConvexShape const &b) {
+	Contact contact;
+	float depth = std::numeric_limits< float >::infinity();
+	glm::vec2 normal = glm::vec2(0.0f);
+	if (overlap_on_axes(a, a, b, &depth, &normal) && overlap_on_axes(b, a, b, &depth, &normal)) {
+		contact.hit = true;
+		contact.depth = depth;
+		contact.normal = normal;
+	}
+	return contact;
+}
+
+}
+
+void collide(ConvexShape const *a, ConvexShape const *b, size_t count, Contact *contacts) {
+	for (size_t i = 0; i < count; ++i) {
+		contacts[i] = collide_pair(a[i], b[i]);
+	}
+}
+
+void collide_one(ConvexShape const &a, ConvexShape const *b, size_t count, Contact *contacts) {
+	for (size_t i = 0; i < count; ++i) {
+		contacts[i] = collide_pair(a, b[i]);
+	}
+}
+
+namespace {
+
+//Convex hull of 'points' (which get sorted), counter-clockwise into 'hull' (room for count + 1); returns its size:
+uint32_t convex_hull(glm::vec2 *points, uint32_t count, glm::vec2 *hull) {
+	for (uint32_t i = 1; i < count; ++i) { //(insertion sort: there are only ever a dozen)
+		glm::vec2 point = points[i];
+		uint32_t j = i;
+		for (; j > 0 && (point.x < points[j-1].x || (point.x == points[j-1].x && point.y < points[j-1].y)); --j) points[j] = points[j-1];
+		points[j] = point;
+	}
+	auto turn = [](glm::vec2 const &o, glm::vec2 const &a, glm::vec2 const &b) {
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	};
+	//(Andrew's monotone chain: the lower half, then the upper half)
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		while (size >= 2 && turn(hull[size-2], hull[size-1], points[i]) <= 0.0f) --size;
+		hull[size++] = points[i];
+	}
+	for (uint32_t i = count - 1, lower = size + 1; i-- > 0; ) {
+		while (size >= lower && turn(hull[size-2], hull[size-1], points[i]) <= 0.0f) --size;
+		hull[size++] = points[i];
+	}
+	return (size > 1 ? size - 1 : size); //(the last point is the first one again)
+}
+
+//Whether some edge normal of 'from' separates 'a' from 'b':
+bool separated_on(glm::vec2 const *from, uint32_t from_count, glm::vec2 const *a, uint32_t a_count, glm::vec2 const *b, uint32_t b_count) {
+	for (uint32_t i = 0; i < from_count; ++i) {
+		glm::vec2 edge = from[(i + 1 == from_count ? 0 : i + 1)] - from[i];
+		glm::vec2 axis = glm::vec2(edge.y, -edge.x);
+		float a_min = std::numeric_limits< float >::infinity(), a_max = -a_min;
+		for (uint32_t c = 0; c < a_count; ++c) {
+			float d = axis.x * a[c].x + axis.y * a[c].y;
+			a_min = std::min(a_min, d);
+			a_max = std::max(a_max, d);
+		}
+		float b_min = std::numeric_limits< float >::infinity(), b_max = -b_min;
+		for (uint32_t c = 0; c < b_count; ++c) {
+			float d = axis.x * b[c].x + axis.y * b[c].y;
+			b_min = std::min(b_min, d);
+			b_max = std::max(b_max, d);
+		}
+		if (a_max < b_min || b_max < a_min) return true;
+	}
+	return false;
+}
+
+struct SwordSweep {
+	player_state player; //(with the sword arm's angle changed as needed)
+	glm::vec2 pivots[3]; //what each corner of the sword (from get_sword_points) turns around
+	float from_angle, to_angle;
+	float sword_tip_length;
+	ConvexShape const *targets;
+	size_t count;
+
+	//The corners of the sword 'time' of the way through the sweep:
+	void sword_at(float time, glm::vec2 corners[3]) {
+		player.set_sword_angle(from_angle + (to_angle - from_angle) * time);
+		get_sword_points(player, sword_tip_length, corners);
+	}
+};
+
+//Which of the 'live' targets (bit t for targets[t]) the sword might touch anywhere between
+// corners 'a' and corners 'b', 'degrees' apart.
+//The hull of the sword at both ends leaves out the bulge of each corner's arc;
+// pushing each corner out from its pivot by 1/cos(half the angle) covers that,
+// since the arc then stays inside the line between the pushed-out ends.
+uint64_t sweep_touches(SwordSweep const &sweep, glm::vec2 const a[3], glm::vec2 const b[3], float degrees, uint64_t live) {
+	float half = 0.5f * degrees;
+	if (half > 45.0f) return live; //(too far to bound this way; split it up first)
+
+	glm::vec2 points[12];
+	float stretch = float(1.0 / get_cos(half));
+	for (uint32_t i = 0; i < 3; ++i) {
+		glm::vec2 const &pivot = sweep.pivots[i];
+		points[i] = a[i];
+		points[3 + i] = b[i];
+		points[6 + i] = pivot + (a[i] - pivot) * stretch;
+		points[9 + i] = pivot + (b[i] - pivot) * stretch;
+	}
+	glm::vec2 hull[13];
+	uint32_t size = convex_hull(points, 12, hull);
+	glm::vec2 low = hull[0], high = hull[0];
+	for (uint32_t i = 1; i < size; ++i) {
+		low = glm::min(low, hull[i]);
+		high = glm::max(high, hull[i]);
+	}
+
+	uint64_t touched = 0;
+	for (size_t t = 0; t < sweep.count; ++t) {
+		if (!(live & (uint64_t(1) << t))) continue;
+		ConvexShape const &target = sweep.targets[t];
+		//(bounding boxes first, since most targets are nowhere near)
+		glm::vec2 target_low = target.corners[0], target_high = target.corners[0];
+		for (uint32_t c = 1; c < target.count; ++c) {
+			target_low = glm::min(target_low, target.corners[c]);
+			target_high = glm::max(target_high, target.corners[c]);
+		}
+		if (target_high.x < low.x || high.x < target_low.x || target_high.y < low.y || high.y < target_low.y) continue;
+		if (!separated_on(hull, size, hull, size, target.corners, target.count)
+		 && !separated_on(target.corners, target.count, hull, size, target.corners, target.count)) touched |= (uint64_t(1) << t);
+	}
+	return touched;
+}
+
+//Looks for the first touch between 'ta' and 'tb' of the way through the sweep (where the sword's
+// corners are 'a' and 'b'), earlier half first; only against the 'live' targets, the ones the level above touched:
+bool first_contact(SwordSweep &sweep, float ta, glm::vec2 const a[3], float tb, glm::vec2 const b[3], uint64_t live, float *time) {
+	float degrees = std::abs(sweep.to_angle - sweep.from_angle) * (tb - ta);
+	live = sweep_touches(sweep, a, b, degrees, live);
+	if (!live) return false;
+	if (degrees <= SWEEP_LEAF_DEGREES) {
+		*time = ta;
+		return true;
+	}
+	float middle = 0.5f * (ta + tb);
+	glm::vec2 m[3];
+	sweep.sword_at(middle, m);
+	return first_contact(sweep, ta, a, middle, m, live, time) || first_contact(sweep, middle, m, tb, b, live, time);
+}
+
+}
+
+bool sweep_sword(player_state const &player, float from_angle, float sword_tip_length, ConvexShape const *targets, size_t count, float *time) {
+	SwordSweep sweep;
+	sweep.player = player;
+	glm::vec2 shoulder = (player.sword_arm == PLAYER_ONE ? player.right_arm() : player.left_arm());
+	float drop = (player.sword_arm == PLAYER_ONE ? player_body.right_arm_radius.y : player_body.left_arm_radius.y);
+	sweep.pivots[0] = shoulder;
+	sweep.pivots[1] = shoulder;
+	sweep.pivots[2] = glm::vec2(shoulder.x, shoulder.y - drop); //(the sword's back corner hangs below the hand)
+	sweep.from_angle = from_angle;
+	sweep.to_angle = player.sword_angle();
+	sweep.sword_tip_length = sword_tip_length;
+	sweep.targets = targets;
+	sweep.count = count;
+	assert(count <= SWEEP_MAX_TARGETS);
+	uint64_t all = (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1);
+	glm::vec2 from[3], to[3];
+	sweep.sword_at(0.0f, from);
+	sweep.sword_at(1.0f, to);
+	return first_contact(sweep, 0.0f, from, 1.0f, to, all, time);
+}
@@ -0,0 +1,237 @@
+#include "DegreeTrig.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEGREE_TRIG_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+//sin(x) and cos(x) by their Taylor series; plenty of terms for |x| <= pi/4:
+constexpr double taylor_sin(double x2, double term, double sum, int n) {
+	return n == 16 ? sum : taylor_sin(x2, -term * x2 / ((2 * n) * (2 * n + 1)), sum + term, n + 1);
+}
+constexpr double taylor_cos(double x2, double term, double sum, int n) {
+	return n == 16 ? sum : taylor_cos(x2, -term * x2 / ((2 * n - 1) * (2 * n)), sum + term, n + 1);
+}
+constexpr double step_radians(size_t i) {
+	return i * PI / (180.0 * DEGREE_TABLE_STEPS_PER_DEGREE);
+}
+//sin of i table steps, for i in [0, 90 degrees] (past 45 degrees, as the cos of the rest, which is more accurate):
+constexpr double table_entry(size_t i, size_t quadrant) {
+	return 2 * i <= quadrant
+		? taylor_sin(step_radians(i) * step_radians(i), step_radians(i), 0.0, 1)
+		: taylor_cos(step_radians(quadrant - i) * step_radians(quadrant - i), 1.0, 0.0, 1);
+}
+
+//(C++11 has no std::index_sequence; this one halves N at each level, so long tables don't hit the template depth limit)
+template< size_t... I > struct Indices { };
+template< typename A, typename B > struct JoinIndices;
+template< size_t... A, size_t... B > struct JoinIndices< Indices< A... >, Indices< B... > > {
+	typedef Indices< A..., (sizeof...(A) + B)... > type;
+};
+template< size_t N > struct MakeIndices {
+	typedef typename JoinIndices< typename MakeIndices< N / 2 >::type, typename MakeIndices< N - N / 2 >::type >::type type;
+};
+template< > struct MakeIndices< 0 > { typedef Indices< > type; };
+template< > struct MakeIndices< 1 > { typedef Indices< 0 > type; };
+
+size_t const QUADRANT = 90 * DEGREE_TABLE_STEPS_PER_DEGREE;
+
+struct Table {
+	double sin[QUADRANT + 1];
+};
+template< size_t... I >
+constexpr Table make_table(Indices< I... >) {
+	return Table{{ table_entry(I, QUADRANT)... }};
+}
+constexpr Table table = make_table(MakeIndices< QUADRANT + 1 >::type());
+
+static_assert(table.sin[0] == 0.0, "sin(0) should be exact");
+static_assert(table.sin[QUADRANT] == 1.0, "sin(90) should be exact");
+
+//The same table rounded to 16.16 fixed point (worked out by the compiler, with only
+// IEEE-exact double operations, so every compiler gets the same integers):
+struct FixedTable {
+	int32_t sin[QUADRANT + 1];
+};
+template< size_t... I >
+constexpr FixedTable make_fixed_table(Indices< I... >) {
+	return FixedTable{{ int32_t(table.sin[I] * 65536.0 + 0.5)... }};
+}
+constexpr FixedTable fixed_table = make_fixed_table(MakeIndices< QUADRANT + 1 >::type());
+
+static_assert(fixed_table.sin[0] == 0, "sin(0) should be exact");
+static_assert(fixed_table.sin[30 * DEGREE_TABLE_STEPS_PER_DEGREE] == 32768, "sin(30) should be exact");
+static_assert(fixed_table.sin[QUADRANT] == 65536, "sin(90) should be exact");
+
+//Both tables unfolded over [-360, 360) degrees, so that a lookup is a single load with
+// no quadrant to work out (entry i is the sin of i - TURN table steps):
+size_t const TURN = 4 * QUADRANT;
+static_assert(TURN == DEGREE_TABLE_TURN, "DEGREE_TABLE_TURN should be a full turn of table steps");
+size_t const SPAN = 2 * TURN;
+
+//sin of 'at' table steps, for 'at' in [0, TURN), from the quarter turn tables:
+constexpr double folded_sin(size_t at) {
+	return at < QUADRANT ? table.sin[at]
+		: at < 2 * QUADRANT ? table.sin[2 * QUADRANT - at]
+		: at < 3 * QUADRANT ? -table.sin[at - 2 * QUADRANT]
+		: -table.sin[TURN - at];
+}
+constexpr int32_t folded_fixed_sin(size_t at) {
+	return at < QUADRANT ? fixed_table.sin[at]
+		: at < 2 * QUADRANT ? fixed_table.sin[2 * QUADRANT - at]
+		: at < 3 * QUADRANT ? -fixed_table.sin[at - 2 * QUADRANT]
+		: -fixed_table.sin[TURN - at];
+}
+
+typedef DegreeSinTable FullTable;
+static_assert(sizeof(FullTable::sin) == SPAN * sizeof(double), "DegreeSinTable should span two turns");
+template< size_t... I >
+constexpr FullTable make_full_table(Indices< I... >) {
+	return FullTable{{ folded_sin(I % TURN)... }};
+}
+constexpr FullTable full_table = make_full_table(MakeIndices< SPAN >::type());
+
+struct FullFixedTable {
+	int32_t sin[SPAN];
+};
+template< size_t... I >
+constexpr FullFixedTable make_full_fixed_table(Indices< I... >) {
+	return FullFixedTable{{ folded_fixed_sin(I % TURN)... }};
+}
+constexpr FullFixedTable full_fixed_table = make_full_fixed_table(MakeIndices< SPAN >::type());
+
+static_assert(full_fixed_table.sin[TURN + 30 * DEGREE_TABLE_STEPS_PER_DEGREE] == 32768, "sin(30) should be exact");
+static_assert(full_fixed_table.sin[TURN - 30 * DEGREE_TABLE_STEPS_PER_DEGREE] == -32768, "sin(-30) should be exact");
+
+//Index into the full tables for 'steps' table steps (any integer); angles past +-360
+// degrees (which the game doesn't produce) are brought into range with a modulo:
+inline uint32_t full_index(int32_t steps) {
+	uint32_t at = uint32_t(steps) + uint32_t(TURN);
+	if (at >= SPAN) at = uint32_t(steps % int32_t(TURN) + int32_t(TURN));
+	return at;
+}
+
+//sin of 'steps' table steps (any integer), in 16.16:
+inline int32_t fixed_table_sin(int32_t steps) {
+	return full_fixed_table.sin[full_index(steps)];
+}
+
+//Bits of a 16.16 angle below one table step:
+int32_t const STEP_BITS = 16 - 2;
+static_assert((1 << (16 - STEP_BITS)) == DEGREE_TABLE_STEPS_PER_DEGREE, "STEP_BITS should match the table");
+
+//sin of a 16.16 angle, a quarter turn ahead for cos, blending the table steps on either side:
+inline int32_t fixed_sin(int32_t angle, int32_t quarters) {
+	int32_t steps = (angle >> STEP_BITS) + quarters * int32_t(QUADRANT); //(rounds down, negative angles too)
+	int32_t within = angle & ((1 << STEP_BITS) - 1);
+	int32_t a = fixed_table_sin(steps);
+	if (within == 0) return a;
+	int32_t b = fixed_table_sin(steps + 1);
+	return a + int32_t((int64_t(b - a) * within + (1 << (STEP_BITS - 1))) >> STEP_BITS);
+}
+
+//sin of 'steps' table steps (any integer):
+inline double table_sin(int32_t steps) {
+	return full_table.sin[full_index(steps)];
+}
+
+//If 'angle' is a whole number of table steps, sets 'steps' and returns true:
+inline bool to_steps(float angle, int32_t *steps) {
+	float scaled = angle * float(DEGREE_TABLE_STEPS_PER_DEGREE); //(exact, since that's a power of two)
+	if (!(std::fabs(scaled) < 1e9f)) return false;
+	*steps = int32_t(scaled);
+	return float(*steps) == scaled;
+}
+
+//sincos_degrees polynomials, on [-pi/4, pi/4] (coefficients from Cephes' sinf/cosf):
+float const S1 = -1.6666654611e-1f;
+float const S2 = 8.3321608736e-3f;
+float const S3 = -1.9515295891e-4f;
+float const C1 = 4.166664568298827e-2f;
+float const C2 = -1.388731625493765e-3f;
+float const C3 = 2.443315711809948e-5f;
+float const RADIANS_PER_DEGREE = float(PI / 180.0);
+
+//One angle at a time; the SSE2 version below does exactly the same operations in the same order:
+inline void sincos_one(float angle, float *sine, float *cosine) {
+	int32_t quadrant = int32_t(std::lrint(angle * (1.0f / 90.0f)));
+	float x = (angle - float(quadrant) * 90.0f) * RADIANS_PER_DEGREE;
+	float x2 = x * x;
+	float s = x + (x * x2) * (S1 + x2 * (S2 + x2 * S3));
+	float c = (1.0f - 0.5f * x2) + (x2 * x2) * (C1 + x2 * (C2 + x2 * C3));
+	if (quadrant & 1) {
+		float t = s;
+		s = c;
+		c = t;
+	}
+	*sine = (quadrant & 2) ? -s : s;
+	*cosine = ((quadrant + 1) & 2) ? -c : c;
+}
+
+}
+
+DegreeSinTable const degree_sin_table = full_table;
+
+double sin_degrees_off_table(float angle) {
+	int32_t steps;
+	if (to_steps(angle, &steps)) return table_sin(steps);
+	return std::sin(angle * (PI / 180.0));
+}
+
+double cos_degrees_off_table(float angle) {
+	int32_t steps;
+	if (to_steps(angle, &steps)) return table_sin(steps + int32_t(QUADRANT));
+	return std::cos(angle * (PI / 180.0));
+}
+
+double const *sin_degrees_table() {
+	return degree_sin_table.sin;
+}
+
+int32_t sin_degrees_16_16(int32_t angle) {
+	return fixed_sin(angle, 0);
+}
+
+int32_t cos_degrees_16_16(int32_t angle) {
+	return fixed_sin(angle, 1);
+}
+
+void sincos_degrees(float const *angles, size_t count, float *sines, float *cosines) {
+	size_t i = 0;
+#ifdef DEGREE_TRIG_SSE2
+	__m128 const inv90 = _mm_set1_ps(1.0f / 90.0f);
+	__m128 const ninety = _mm_set1_ps(90.0f);
+	__m128 const to_radians = _mm_set1_ps(RADIANS_PER_DEGREE);
+	__m128 const sign = _mm_set1_ps(-0.0f);
+	__m128i const one = _mm_set1_epi32(1);
+	__m128i const two = _mm_set1_epi32(2);
+	for (; i + 4 <= count; i += 4) {
+		__m128 angle = _mm_loadu_ps(angles + i);
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, inv90)); //(rounds to nearest, like lrint)
+		__m128 x = _mm_mul_ps(_mm_sub_ps(angle, _mm_mul_ps(_mm_cvtepi32_ps(quadrant), ninety)), to_radians);
+		__m128 x2 = _mm_mul_ps(x, x);
+		__m128 s = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2),
+			_mm_add_ps(_mm_set1_ps(S1), _mm_mul_ps(x2, _mm_add_ps(_mm_set1_ps(S2), _mm_mul_ps(x2, _mm_set1_ps(S3)))))));
+		__m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), x2)), _mm_mul_ps(_mm_mul_ps(x2, x2),
+			_mm_add_ps(_mm_set1_ps(C1), _mm_mul_ps(x2, _mm_add_ps(_mm_set1_ps(C2), _mm_mul_ps(x2, _mm_set1_ps(C3)))))));
+
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+		__m128 sine = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		__m128 cosine = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+		__m128 negate_sine = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, two), two));
+		__m128 negate_cosine = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), two));
+		_mm_storeu_ps(sines + i, _mm_xor_ps(sine, _mm_and_ps(negate_sine, sign)));
+		_mm_storeu_ps(cosines + i, _mm_xor_ps(cosine, _mm_and_ps(negate_cosine, sign)));
+	}
+#endif
+	for (; i < count; ++i) {
+		sincos_one(angles[i], sines + i, cosines + i);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+//Trigonometry for angles in degrees (which is what all of the game's angles are in).
+//
+// sin_degrees() / cos_degrees() are double precision, for the simulation.
+//  Angles that are whole multiples of 1/DEGREE_TABLE_STEPS_PER_DEGREE degrees
+//  (every angle the game produces at the default tick rate, since swings move
+//  10 degrees and retractions 1.75 degrees per tick) come out of a table built
+//  at compile time, so they are fast and the same on every platform; other
+//  angles fall back to std::sin / std::cos. The table covers -360 to 360
+//  degrees, so a lookup is one load (with a modulo only for angles outside that).
+//
+// sin_degrees_16_16() / cos_degrees_16_16() are 16.16 fixed point (see Fixed.hpp),
+//  for the fixed point simulation: the same table, rounded to integers, with
+//  angles between table steps blended in integer math, so every angle comes
+//  out the same on every platform and build (within 2^-15 of the true value;
+//  checked by 'rewind-bench trig').
+//
+// sincos_degrees() is single precision, for many angles at once (SIMD where
+//  available), within SINCOS_DEGREES_MAX_ERROR of the true value for
+//  |angle| < 1e5 degrees. It's for drawing, not for the simulation.
+
+#include <cstddef>
+#include <cstdint>
+
+#define DEGREE_TABLE_STEPS_PER_DEGREE 4
+
+//(checked by 'rewind-bench trig')
+#define SINCOS_DEGREES_MAX_ERROR 2e-7f
+
+//The table behind sin_degrees, for code that looks angles up itself (RewindBatch's kernels):
+// entry i is sin_degrees() of i - DEGREE_TABLE_TURN table steps, bit for bit, for i in [0, 2 * DEGREE_TABLE_TURN):
+#define DEGREE_TABLE_TURN (360 * DEGREE_TABLE_STEPS_PER_DEGREE)
+double const *sin_degrees_table();
+
+//(the table itself, so that the lookup below can be inlined into the simulation)
+struct DegreeSinTable {
+	double sin[2 * DEGREE_TABLE_TURN];
+};
+extern DegreeSinTable const degree_sin_table;
+
+//sin_degrees / cos_degrees for angles that aren't in the table (between table steps, or past +-360 degrees):
+double sin_degrees_off_table(float angle);
+double cos_degrees_off_table(float angle);
+
+//If 'angle' is a whole number of table steps, and 'angle' plus 'ahead' steps is in the table, sets 'at' to its entry:
+inline bool degree_table_at(float angle, int32_t ahead, uint32_t *at) {
+	float scaled = angle * float(DEGREE_TABLE_STEPS_PER_DEGREE); //(exact, since that's a power of two)
+	if (!(scaled < 1e9f && scaled > -1e9f)) return false;
+	int32_t steps = int32_t(scaled);
+	if (float(steps) != scaled) return false;
+	*at = uint32_t(steps + ahead) + uint32_t(DEGREE_TABLE_TURN);
+	return *at < uint32_t(2 * DEGREE_TABLE_TURN);
+}
+
+inline double sin_degrees(float angle) {
+	uint32_t at;
+	if (degree_table_at(angle, 0, &at)) return degree_sin_table.sin[at];
+	return sin_degrees_off_table(angle);
+}
+
+inline double cos_degrees(float angle) {
+	uint32_t at;
+	if (degree_table_at(angle, 90 * DEGREE_TABLE_STEPS_PER_DEGREE, &at)) return degree_sin_table.sin[at];
+	return cos_degrees_off_table(angle);
+}
+
+int32_t sin_degrees_16_16(int32_t angle);
+int32_t cos_degrees_16_16(int32_t angle);
+
+void sincos_degrees(float const *angles, size_t count, float *sines, float *cosines);
+
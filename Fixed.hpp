@@ -0,0 +1,67 @@
+#pragma once
+
+//16.16 fixed point numbers, for simulating with nothing but integer math
+// (see SimScalar.hpp): every operation comes out the same, bit for bit,
+// whatever the compiler, optimization level or floating point unit.
+// Values range over about +/-32768 in steps of 2^-16 (about 0.000015).
+// Products and quotients round to nearest; sums wrap around on overflow.
+
+#include "DegreeTrig.hpp"
+
+#include <cstdint>
+#include <cmath>
+
+struct Fixed {
+	int32_t raw = 0; //the value times 65536
+
+	Fixed() = default;
+	explicit Fixed(int whole) : raw(int32_t(uint32_t(whole) << 16)) { }
+
+	static Fixed from_raw(int32_t raw) {
+		Fixed f;
+		f.raw = raw;
+		return f;
+	}
+	//The nearest fixed point number to 'value' (exact steps on every platform,
+	// since scaling a float by a power of two and rounding loses nothing in double):
+	static Fixed from_float(float value) {
+		double scaled = double(value) * 65536.0;
+		int32_t whole = int32_t(scaled);
+		if (double(whole) == scaled) return from_raw(whole); //(already a multiple of 2^-16, as fixed point results stored in floats are)
+		return from_raw(int32_t(std::floor(scaled + 0.5)));
+	}
+	float to_float() const {
+		return float(raw) * (1.0f / 65536.0f);
+	}
+
+	Fixed operator+(Fixed b) const { return from_raw(int32_t(uint32_t(raw) + uint32_t(b.raw))); }
+	Fixed operator-(Fixed b) const { return from_raw(int32_t(uint32_t(raw) - uint32_t(b.raw))); }
+	Fixed operator-() const { return from_raw(int32_t(0u - uint32_t(raw))); }
+	Fixed operator*(Fixed b) const {
+		return from_raw(int32_t((int64_t(raw) * b.raw + (1 << 15)) >> 16));
+	}
+	//(dividing by zero is an error, as with integers)
+	Fixed operator/(Fixed b) const {
+		int64_t n = int64_t(raw) * 65536;
+		int64_t half = (b.raw < 0 ? -int64_t(b.raw) : int64_t(b.raw)) / 2;
+		return from_raw(int32_t(((n < 0) == (b.raw < 0) ? n + half : n - half) / b.raw));
+	}
+	Fixed &operator+=(Fixed b) { return *this = *this + b; }
+	Fixed &operator-=(Fixed b) { return *this = *this - b; }
+
+	bool operator==(Fixed b) const { return raw == b.raw; }
+	bool operator!=(Fixed b) const { return raw != b.raw; }
+	bool operator<(Fixed b) const { return raw < b.raw; }
+	bool operator<=(Fixed b) const { return raw <= b.raw; }
+	bool operator>(Fixed b) const { return raw > b.raw; }
+	bool operator>=(Fixed b) const { return raw >= b.raw; }
+};
+static_assert(sizeof(Fixed) == 4, "Fixed should be a plain int32");
+
+//sin / cos of an angle in degrees (see sin_degrees_16_16):
+inline Fixed sin_degrees(Fixed angle) {
+	return Fixed::from_raw(sin_degrees_16_16(angle.raw));
+}
+inline Fixed cos_degrees(Fixed angle) {
+	return Fixed::from_raw(cos_degrees_16_16(angle.raw));
+}
@@ -0,0 +1,60 @@
+#include "LagCompensation.hpp"
+
+#include <algorithm>
+
+LagCompensation::LagCompensation(size_t players) : reach(players, 0), logged(players, 0) {
+}
+
+void LagCompensation::observe(size_t index, player_info const &player) {
+	//A player who isn't rewinding pushes exactly one entry a tick (and the oldest falls off once the log is full);
+	// anything else means the entries no longer line up with past ticks (a rewind popped them, or a reset emptied the log):
+	uint32_t size = uint32_t(player.rewind_log.size());
+	uint32_t pushed = uint32_t(std::min(size_t(logged[index]) + 1, player.rewind_log.capacity()));
+	if (player.is_rewinding == 0 && size != 0 && size == pushed) {
+		reach[index] = std::min(reach[index] + 1, size);
+	} else {
+		reach[index] = 0;
+	}
+	logged[index] = size;
+}
+
+void LagCompensation::observe(RewindSim const &sim) {
+	observe(0, sim.playerOne());
+	observe(1, sim.playerTwo());
+	tick += 1;
+}
+
+void LagCompensation::observe(RewindArena const &arena) {
+	for (size_t i = 0; i < arena.fighters.size(); ++i) {
+		observe(i, arena.fighters[i]);
+	}
+	tick += 1;
+}
+
+bool LagCompensation::rewind(size_t index, player_info const &player, uint32_t t, player_state *past) const {
+	if (t > tick) return false;
+	uint32_t ticks_ago = tick - t;
+	if (ticks_ago != 0 && ticks_ago >= reach[index]) return false; //(now is always there, whether or not it's in their log)
+	*past = player;
+	if (ticks_ago == 0) return true;
+
+	glm::vec4 const &entry = player.rewind_log[ticks_ago];
+	past->update_coords(glm::vec2(entry.x, entry.y));
+	past->set_sword_angle(entry.z);
+	past->is_attacking = (int)entry.w;
+	return true;
+}
+
+int LagCompensation::tip_hits_at(player_state const &attacker, size_t index, player_info const &defender, uint32_t t, float sword_tip_length) const {
+	player_state past;
+	if (!rewind(index, defender, t, &past)) return -1;
+	if (attacker.is_attacking != 1) return 0;
+	return sword_tip_hits(attacker, past, sword_tip_length);
+}
+
+void LagCompensation::judge(RewindArena const &arena, Query const *queries, size_t count, int8_t *results) const {
+	for (size_t q = 0; q < count; ++q) {
+		Query const &query = queries[q];
+		results[q] = int8_t(tip_hits_at(arena.fighters[query.attacker], query.defender, arena.fighters[query.defender], query.tick, arena.sword_tip_length));
+	}
+}
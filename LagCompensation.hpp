@@ -0,0 +1,63 @@
+#pragma once
+
+//Lag compensation: judging an attack against where the defender was when the
+// attacker saw them. An attacker's input reaches the server some ticks late, so
+// their swing was aimed at the defender of that many ticks ago; the server
+// rewinds the defender to that tick from their rewind log, runs the sword-tip
+// hit test there, and puts them back.
+//
+// Rewind logs hold one entry per tick, newest first -- but only for ticks the
+// player wasn't rewinding (a rewind plays entries back and drops them) and only
+// since their round started or they respawned (which empties the log). So a
+// LagCompensation watches the logs after every tick to know how many of their
+// newest entries still line up with past ticks, and refuses queries that reach
+// back further than that.
+//
+// Queries are const and rewind a copy of the defender's player_state on the
+// stack (so the match itself is never touched, and 'restoring' is free):
+// they don't allocate, and any number of threads can make them at once.
+// (rewind-bench lag checks them against recorded history and times them: about
+// 25-30ns a query among 1024 fighters, mostly cache misses on their logs.)
+
+#include "RewindSim.hpp"
+#include "Arena.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct LagCompensation {
+	//For a match with 'players' players (2 for a RewindSim, fighters.size() for a RewindArena):
+	LagCompensation(size_t players = 2);
+
+	//Call after every tick (starting from any tick; rewinds can only reach back to the first one watched):
+	void observe(RewindSim const &sim);
+	void observe(RewindArena const &arena);
+
+	//Sets 'past' to player 'index' as they were after tick 't' (where the latest tick observed is 'tick'):
+	// head, sword angle and is_attacking from their rewind log, everything else as it is now.
+	// Returns false (leaving 'past' alone) if 't' is after 'tick' or further back than their log lines up:
+	bool rewind(size_t index, player_info const &player, uint32_t t, player_state *past) const;
+
+	//The sword-tip hit test (sword_tip_hits, as the rules use it: only while attacking) between
+	// 'attacker' as they are now and player 'index' ('defender') as they were after tick 't':
+	// 1 for a hit, 0 for a miss, or -1 if the defender can't be rewound that far.
+	int tip_hits_at(player_state const &attacker, size_t index, player_info const &defender, uint32_t t, float sword_tip_length) const;
+
+	//Many tip_hits_at queries between the fighters of 'arena' (results[i] answers queries[i]):
+	struct Query {
+		uint32_t attacker;
+		uint32_t defender;
+		uint32_t tick;
+	};
+	void judge(RewindArena const &arena, Query const *queries, size_t count, int8_t *results) const;
+
+	uint32_t tick = 0; //ticks observed so far
+
+	//How many of each player's newest rewind log entries are their last ticks, one per tick:
+	std::vector< uint32_t > reach;
+	std::vector< uint32_t > logged; //each rewind log's size at the last observe()
+
+private:
+	void observe(size_t index, player_info const &player);
+};
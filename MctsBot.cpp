@@ -0,0 +1,229 @@
+#include "MctsBot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+//Small, quickly-seeded random numbers for rollouts (splitmix64):
+struct RolloutRandom {
+	RolloutRandom(uint64_t seed) : state(seed) { }
+	uint32_t next() {
+		state += 0x9e3779b97f4a7c15ULL;
+		uint64_t z = state;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return uint32_t((z ^ (z >> 31)) >> 32);
+	}
+	uint64_t state;
+};
+
+}
+
+uint8_t const MctsBot::Actions[MCTS_ACTIONS] = {
+	0,
+	INPUT_LEFT,
+	INPUT_RIGHT,
+	INPUT_ATTACK,
+	INPUT_LEFT | INPUT_ATTACK,
+	INPUT_RIGHT | INPUT_ATTACK,
+	INPUT_REWIND,
+};
+
+MctsBot::MctsBot(int player_, float tick_rate, uint32_t threads, uint32_t seed) : player(player_), rollout_counter(uint64_t(seed) << 32), pool(threads), current(tick_rate) {
+	action_ticks = std::max(1u, uint32_t(std::lround(MCTS_ACTION_SECONDS * tick_rate)));
+	horizon_ticks = std::max(1u, uint32_t(std::lround(MCTS_HORIZON_SECONDS * tick_rate)));
+
+	for (uint32_t t = 0; t < pool.size(); ++t) {
+		sims.emplace_back(new RewindSim(tick_rate));
+	}
+	batch.resize(pool.size() * MCTS_BATCH_PER_THREAD);
+	for (auto &rollout : batch) {
+		rollout.path.reserve(horizon_ticks / action_ticks + 2);
+		rollout.actions.reserve(horizon_ticks / action_ticks + 2);
+	}
+
+	reset();
+}
+
+void MctsBot::reset() {
+	nodes.clear();
+	add_node();
+	held = 0;
+	held_ticks = 0;
+}
+
+uint32_t MctsBot::add_node() {
+	Node node;
+	std::fill(node.child, node.child + MCTS_ACTIONS, 0);
+	node.visits = 0.0f;
+	node.value = 0.0f;
+	nodes.emplace_back(node);
+	return uint32_t(nodes.size() - 1);
+}
+
+uint8_t MctsBot::act(RewindSim const &sim, double budget) {
+	auto start = std::chrono::steady_clock::now();
+	if (budget >= 0.0 || (held_ticks == 0 && nodes.size() == 1)) {
+		if (sim.tick_rate != current.tick_rate) throw std::runtime_error("MctsBot was made for a different tick rate.");
+		current = sim; //(a branch: shares the rewind logs)
+		search(std::max(budget, 0.0));
+	}
+
+	if (held_ticks == 0) {
+		//Time to pick the next action: the most-visited one (the most reliable estimate):
+		uint32_t best = 0;
+		for (uint32_t a = 1; a < MCTS_ACTIONS; ++a) {
+			Node const *b = (nodes[0].child[best] ? &nodes[nodes[0].child[best]] : nullptr);
+			Node const *c = (nodes[0].child[a] ? &nodes[nodes[0].child[a]] : nullptr);
+			if (!c) continue;
+			if (!b || c->visits > b->visits || (c->visits == b->visits && c->value > b->value)) best = a;
+		}
+		held = Actions[best];
+		held_ticks = action_ticks;
+		if (nodes[0].child[best]) {
+			keep_subtree(nodes[0].child[best]);
+		} else {
+			nodes.clear();
+			add_node();
+		}
+		stats.decisions += 1;
+		stats.reused = uint32_t(nodes.size());
+	}
+
+	held_ticks -= 1;
+	stats.tree_size = uint32_t(nodes.size());
+	stats.search_seconds += std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+	return held;
+}
+
+void MctsBot::search(double budget) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration< double >(budget);
+	uint32_t max_depth = horizon_ticks / action_ticks;
+
+	do {
+		//Walk the tree once per rollout, counting each visit now (and its result only
+		// once the batch is done), so rollouts in flight look like losses and the
+		// batch spreads out over the tree:
+		for (auto &rollout : batch) {
+			rollout.path.clear();
+			rollout.actions.clear();
+			rollout.seed = rollout_counter++;
+
+			uint32_t at = 0;
+			nodes[at].visits += 1.0f;
+			rollout.path.emplace_back(at);
+			while (rollout.actions.size() < max_depth) {
+				//Expand the first untried action, if any:
+				uint32_t pick = MCTS_ACTIONS;
+				for (uint32_t a = 0; a < MCTS_ACTIONS; ++a) {
+					if (nodes[at].child[a] == 0) {
+						pick = a;
+						break;
+					}
+				}
+				if (pick != MCTS_ACTIONS) {
+					uint32_t child = add_node();
+					nodes[at].child[pick] = child;
+					nodes[child].visits += 1.0f;
+					rollout.actions.emplace_back(uint8_t(pick));
+					rollout.path.emplace_back(child);
+					break;
+				}
+
+				//Otherwise, follow the best upper confidence bound (UCT):
+				float log_visits = std::log(nodes[at].visits);
+				float best_score = -1.0f;
+				for (uint32_t a = 0; a < MCTS_ACTIONS; ++a) {
+					Node const &child = nodes[nodes[at].child[a]];
+					float score = child.value / child.visits + exploration * std::sqrt(log_visits / child.visits);
+					if (score > best_score) {
+						best_score = score;
+						pick = a;
+					}
+				}
+				at = nodes[at].child[pick];
+				nodes[at].visits += 1.0f;
+				rollout.actions.emplace_back(uint8_t(pick));
+				rollout.path.emplace_back(at);
+			}
+		}
+
+		pool.run(batch.size(), [this](size_t index, uint32_t thread) {
+			run_rollout(batch[index], *sims[thread]);
+		});
+
+		for (auto const &rollout : batch) {
+			for (uint32_t n : rollout.path) {
+				nodes[n].value += rollout.result;
+			}
+			stats.rollouts += 1;
+			stats.rollout_ticks += rollout.ticks;
+		}
+	} while (std::chrono::steady_clock::now() < deadline);
+}
+
+void MctsBot::run_rollout(Rollout &rollout, RewindSim &sim) const {
+	sim = current;
+	RolloutRandom random(rollout.seed);
+
+	uint32_t left_score = sim.left_score;
+	uint32_t right_score = sim.right_score;
+
+	//The other player holds random buttons, changing as often as the bot does:
+	uint8_t other = 0;
+	uint32_t other_ticks = 0;
+	uint32_t ticks = 0;
+	auto step = [&](uint8_t input) {
+		if (other_ticks == 0) {
+			other = Actions[random.next() % MCTS_ACTIONS];
+			other_ticks = action_ticks;
+		}
+		other_ticks -= 1;
+		if (player == PLAYER_ONE) sim.step(input, other);
+		else sim.step(other, input);
+		ticks += 1;
+		return sim.left_score != left_score || sim.right_score != right_score; //(round over)
+	};
+
+	bool over = false;
+	//finish the action being held:
+	for (uint32_t t = 0; t < held_ticks && !over; ++t) {
+		over = step(held);
+	}
+	//follow the path through the tree:
+	for (uint8_t action : rollout.actions) {
+		for (uint32_t t = 0; t < action_ticks && !over; ++t) {
+			over = step(Actions[action]);
+		}
+	}
+	//then play randomly until the horizon:
+	while (!over && ticks < held_ticks + horizon_ticks) {
+		uint8_t action = Actions[random.next() % MCTS_ACTIONS];
+		for (uint32_t t = 0; t < action_ticks && !over; ++t) {
+			over = step(action);
+		}
+	}
+
+	bool won = (player == PLAYER_ONE ? sim.left_score != left_score : sim.right_score != right_score);
+	bool lost = (player == PLAYER_ONE ? sim.right_score != right_score : sim.left_score != left_score);
+	rollout.result = (won == lost ? 0.5f : (won ? 1.0f : 0.0f));
+	rollout.ticks = ticks;
+}
+
+void MctsBot::keep_subtree(uint32_t root) {
+	//copy the subtree into 'spare' in breadth-first order, renumbering children as they are copied:
+	spare.clear();
+	spare.emplace_back(nodes[root]);
+	for (size_t i = 0; i < spare.size(); ++i) {
+		for (uint32_t a = 0; a < MCTS_ACTIONS; ++a) {
+			uint32_t child = spare[i].child[a];
+			if (child == 0) continue;
+			spare.emplace_back(nodes[child]);
+			spare[i].child[a] = uint32_t(spare.size() - 1);
+		}
+	}
+	std::swap(nodes, spare);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+//A computer opponent that plays by searching, not by script.
+// It runs Monte Carlo tree search over its own actions (each action is a set
+// of buttons held for MCTS_ACTION_SECONDS), simulating forward from copies of
+// the real match with RewindSim, so it plays by exactly the same rules as
+// everyone else. (Copies share their rewind logs with the match they were
+// copied from -- see PersistentLog.hpp -- so starting a rollout doesn't copy
+// whole histories.) The other player is modeled as pressing random buttons.
+//
+// Rollouts run on a ThreadPool, in batches: the tree is walked on the calling
+// thread (counting in-flight rollouts as losses so a batch spreads out), then
+// the batch is simulated in parallel and the results added back.
+//
+// The tree is kept between ticks: while an action is being held, the bot keeps
+// searching what to do after it, and when the action finishes, the subtree
+// under it becomes the new tree.
+
+#include "RewindSim.hpp"
+#include "ThreadPool.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+//Length of one action (the bot picks new buttons this often):
+#define MCTS_ACTION_SECONDS 0.1f
+//How far ahead rollouts look before calling the match a draw:
+#define MCTS_HORIZON_SECONDS 3.0f
+//UCT exploration constant:
+#define MCTS_EXPLORATION 0.7f
+//Rollouts per thread in each batch:
+#define MCTS_BATCH_PER_THREAD 8
+//Number of actions to choose from (see MctsBot::Actions):
+#define MCTS_ACTIONS 7
+
+struct MctsStats {
+	uint64_t rollouts = 0; //total rollouts run
+	uint64_t rollout_ticks = 0; //total ticks simulated by rollouts
+	double search_seconds = 0.0; //total time spent in act()
+	uint32_t decisions = 0; //number of actions chosen
+	uint32_t tree_size = 0; //nodes in the tree right now
+	uint32_t reused = 0; //nodes kept from the previous tree at the latest decision
+};
+
+struct MctsBot {
+	//'player' is PLAYER_ONE or PLAYER_TWO; 'threads' of 0 uses every hardware thread:
+	MctsBot(int player, float tick_rate = TICK_RATE, uint32_t threads = 0, uint32_t seed = 0);
+
+	//Searches for (about) 'budget' seconds -- always at least one batch -- then returns the buttons to hold for the next step of 'sim'.
+	// A negative budget skips searching, unless an action has to be picked and the tree is still empty:
+	uint8_t act(RewindSim const &sim, double budget);
+
+	//Forgets the tree and any action in progress (e.g., after the match was seeked or restored):
+	void reset();
+
+	//Buttons held by each action:
+	static uint8_t const Actions[MCTS_ACTIONS];
+
+	int player;
+	uint32_t action_ticks; //ticks per action
+	uint32_t horizon_ticks; //ticks simulated per rollout (after the current action)
+	float exploration = MCTS_EXPLORATION;
+	MctsStats stats;
+
+	//The action being held, and how many more ticks to hold it (counting the next one):
+	uint8_t held = 0;
+	uint32_t held_ticks = 0;
+
+	//The tree; nodes[0] is the state once 'held' has finished:
+	struct Node {
+		uint32_t child[MCTS_ACTIONS]; //0 if not expanded yet (node 0 is never a child)
+		float visits;
+		float value; //sum of rollout results (1 win, 0.5 draw, 0 loss)
+	};
+	std::vector< Node > nodes;
+	std::vector< Node > spare; //(scratch space for keeping a subtree)
+
+	//One rollout: the path through the tree, then its result:
+	struct Rollout {
+		std::vector< uint32_t > path; //nodes visited, starting with the root
+		std::vector< uint8_t > actions; //action taken out of each node but the last
+		uint64_t seed;
+		float result;
+		uint32_t ticks;
+	};
+	std::vector< Rollout > batch;
+	uint64_t rollout_counter = 0; //(seeds rollouts, so that results don't depend on which thread ran them)
+
+	//Per-thread copies of the match:
+	ThreadPool pool;
+	std::vector< std::unique_ptr< RewindSim > > sims;
+	RewindSim current; //the real match, as of the latest act()
+
+	void search(double budget);
+	uint32_t add_node();
+	void keep_subtree(uint32_t root);
+	void run_rollout(Rollout &rollout, RewindSim &sim) const;
+};
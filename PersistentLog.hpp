@@ -0,0 +1,280 @@
+#pragma once
+
+//Persistent (structurally shared) rewind log, for branching a timeline:
+// holds the same entries as a RingBuffer -- newest first, at most 'capacity'
+// of them, the oldest overwritten once full -- with the same interface, so
+// update_rewind() can step back through it.
+//
+// Copying a PersistentLog is a branch: the copy shares every entry with the
+// original (the copy itself is one reference count), and from then on each
+// side only copies what it writes to. Entries live in PERSISTENT_LOG_WIDTH-entry
+// leaves under PERSISTENT_LOG_WIDTH-way nodes, so the first push after a branch
+// copies one root-to-leaf path -- O(log n) -- and the pushes after it write
+// in place until they reach the next leaf: memory grows with the ticks pushed
+// since the branch (a leaf per PERSISTENT_LOG_WIDTH of them), not with the
+// history they share. pop_front never writes, so rewinding through a
+// branch allocates nothing.
+//
+// Reference counts are atomic, so branches of one log can be handed to
+// different threads (though each PersistentLog, like a RingBuffer, belongs to
+// one thread at a time).
+
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+
+//(keeps the rarely taken path out of push_front, which is on every tick's path)
+#if defined(_MSC_VER)
+#define PERSISTENT_LOG_NOINLINE __declspec(noinline)
+#else
+#define PERSISTENT_LOG_NOINLINE __attribute__((noinline))
+#endif
+
+#define PERSISTENT_LOG_BITS 5
+#define PERSISTENT_LOG_WIDTH (1 << PERSISTENT_LOG_BITS) //entries per leaf, and children per node
+
+template< typename T >
+struct PersistentLog {
+	PersistentLog(size_t capacity = 1) : capacity_(capacity > 0 ? capacity : 1) {
+		//One leaf more than 'capacity' entries can span, so the leaf being
+		// filled never holds the oldest entries still in use:
+		size_t leaves = (capacity_ + PERSISTENT_LOG_WIDTH - 1) / PERSISTENT_LOG_WIDTH + 1;
+		slots = leaves * PERSISTENT_LOG_WIDTH;
+		height = 1;
+		for (size_t reach = PERSISTENT_LOG_WIDTH; reach < leaves; reach *= PERSISTENT_LOG_WIDTH) {
+			height += 1;
+		}
+		hot_first = slots;
+		read_first = slots;
+	}
+
+	//Branches 'other' (shares all its entries):
+	PersistentLog(PersistentLog const &other) : root(other.root), slots(other.slots), height(other.height),
+		first(other.first), count(other.count), capacity_(other.capacity_), hot_first(other.slots), read_first(other.slots) {
+		share(root);
+		other.cool();
+	}
+	PersistentLog &operator=(PersistentLog const &other) {
+		share(other.root);
+		other.cool();
+		release(root, height);
+		root = other.root;
+		slots = other.slots;
+		hot = nullptr;
+		hot_first = slots;
+		read_first = slots;
+		height = other.height;
+		first = other.first;
+		count = other.count;
+		capacity_ = other.capacity_;
+		return *this;
+	}
+	~PersistentLog() {
+		release(root, height);
+	}
+
+	//Adds a new entry; drops the oldest entry if the log is full:
+	void push_front(T const &value) {
+		//(the common case: the slot is in the leaf the last push wrote, and nothing has branched off since)
+		size_t in_hot = first - 1 - hot_first; //(wraps around to something huge when the slot is outside it)
+		if (in_hot < PERSISTENT_LOG_WIDTH) {
+			first -= 1;
+			hot->items[in_hot] = value;
+			if (count < capacity_) count += 1;
+			return;
+		}
+		push_path(value);
+	}
+
+	//Removes the newest entry:
+	void pop_front() {
+		assert(count > 0);
+		first += 1;
+		if (first == slots) first = 0;
+		count -= 1;
+	}
+
+	//Newest entry:
+	T const &front() const {
+		return (*this)[0];
+	}
+
+	//i'th newest entry (0 is the same as front()):
+	T const &operator[](size_t i) const {
+		assert(i < count);
+		size_t at = first + i;
+		if (at >= slots) at -= slots;
+		if (at - hot_first < PERSISTENT_LOG_WIDTH) return hot->items[at - hot_first]; //(shared or not, it's still this log's leaf)
+		if (at - read_first >= PERSISTENT_LOG_WIDTH) {
+			read_first = at & ~size_t(PERSISTENT_LOG_WIDTH - 1);
+			read = leaf_at(at >> PERSISTENT_LOG_BITS);
+		}
+		return read->items[at - read_first];
+	}
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+	size_t capacity() const { return capacity_; }
+
+	//Copies all entries to 'out', newest first ('out' must have room for size() entries):
+	// (a leaf at a time, so a snapshot costs about what a RingBuffer's would)
+	void copy_to(T *out) const {
+		size_t at = first;
+		for (size_t i = 0; i < count; ) {
+			size_t offset = at & (PERSISTENT_LOG_WIDTH - 1);
+			size_t run = std::min< size_t >(PERSISTENT_LOG_WIDTH - offset, count - i);
+			T const *items = leaf_at(at >> PERSISTENT_LOG_BITS)->items + offset;
+			std::copy(items, items + run, out + i);
+			i += run;
+			at += run;
+			if (at == slots) at = 0;
+		}
+	}
+
+	//Replaces all entries with the 'n' entries at 'in', newest first:
+	// (writes slots 0 to n-1 a leaf at a time, copying only the leaves another log shares)
+	void assign(T const *in, size_t n) {
+		assert(n <= capacity_);
+		hot = nullptr;
+		hot_first = slots;
+		read_first = slots;
+		for (size_t i = 0; i < n; i += PERSISTENT_LOG_WIDTH) {
+			size_t run = std::min< size_t >(PERSISTENT_LOG_WIDTH, n - i);
+			std::copy(in + i, in + i + run, owned_leaf(i >> PERSISTENT_LOG_BITS)->items);
+		}
+		first = 0;
+		count = n;
+	}
+
+	//Forgets all entries (keeps the tree, whose storage later pushes reuse):
+	void clear() {
+		first = 0;
+		count = 0;
+	}
+
+	//Memory in the tree this log reads from, shared or not:
+	size_t bytes_used() const { return bytes(root, height, false); }
+	//Memory in the tree that no other log shares (what dropping this branch would free):
+	size_t bytes_owned() const { return bytes(root, height, true); }
+
+private:
+	struct Node {
+		std::atomic< uint32_t > refs;
+		Node() : refs(1) { }
+	};
+	struct Leaf : Node {
+		T items[PERSISTENT_LOG_WIDTH];
+	};
+	struct Inner : Node {
+		Node *children[PERSISTENT_LOG_WIDTH] = { };
+	};
+
+	//Adds a log holding 'node' as its root:
+	static void share(Node *node) {
+		if (!node) return;
+		node->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//push_front, copying the path to the slot's leaf where another log shares it:
+	PERSISTENT_LOG_NOINLINE void push_path(T const &value) {
+		first = (first == 0 ? slots : first) - 1;
+
+		size_t leaf = first >> PERSISTENT_LOG_BITS;
+		hot = owned_leaf(leaf);
+		read_first = slots; //(the path copy may have replaced the leaf being read)
+		hot->items[first & (PERSISTENT_LOG_WIDTH - 1)] = value;
+		hot_first = leaf << PERSISTENT_LOG_BITS;
+		if (count < capacity_) count += 1;
+	}
+
+	//The 'leaf'th leaf (which must exist):
+	Leaf const *leaf_at(size_t leaf) const {
+		Node const *node = root;
+		for (uint32_t level = height; level > 0; --level) {
+			node = static_cast< Inner const * >(node)->children[(leaf >> (PERSISTENT_LOG_BITS * (level - 1))) & (PERSISTENT_LOG_WIDTH - 1)];
+		}
+		return static_cast< Leaf const * >(node);
+	}
+
+	//The 'leaf'th leaf, copying the path to it where another log shares it:
+	Leaf *owned_leaf(size_t leaf) {
+		Node **at = &root;
+		for (uint32_t level = height; level > 0; --level) {
+			Inner *inner = static_cast< Inner * >(owned(at, level));
+			at = &inner->children[(leaf >> (PERSISTENT_LOG_BITS * (level - 1))) & (PERSISTENT_LOG_WIDTH - 1)];
+		}
+		return static_cast< Leaf * >(owned(at, 0));
+	}
+
+
+	//Makes '*at' (a node 'level' levels above the leaves, whose parent this log owns)
+	// one only this log holds, creating or copying it as needed:
+	static Node *owned(Node **at, uint32_t level) {
+		Node *node = *at;
+		if (!node) {
+			*at = (level == 0 ? static_cast< Node * >(new Leaf()) : static_cast< Node * >(new Inner()));
+		} else if (node->refs.load(std::memory_order_acquire) != 1) {
+			if (level == 0) {
+				Leaf *copy = new Leaf();
+				std::copy(static_cast< Leaf * >(node)->items, static_cast< Leaf * >(node)->items + PERSISTENT_LOG_WIDTH, copy->items);
+				*at = copy;
+			} else {
+				Inner *copy = new Inner();
+				for (uint32_t c = 0; c < PERSISTENT_LOG_WIDTH; ++c) {
+					copy->children[c] = static_cast< Inner * >(node)->children[c];
+					if (copy->children[c]) copy->children[c]->refs.fetch_add(1, std::memory_order_relaxed);
+				}
+				*at = copy;
+			}
+			release(node, level);
+		}
+		return *at;
+	}
+
+	static void release(Node *node, uint32_t level) {
+		if (!node || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		if (level == 0) {
+			delete static_cast< Leaf * >(node);
+		} else {
+			Inner *inner = static_cast< Inner * >(node);
+			for (uint32_t c = 0; c < PERSISTENT_LOG_WIDTH; ++c) {
+				release(inner->children[c], level - 1);
+			}
+			delete inner;
+		}
+	}
+
+	//Bytes in the subtree at 'node' (only the part no other log shares, if 'owned_only'):
+	static size_t bytes(Node const *node, uint32_t level, bool owned_only) {
+		if (!node || (owned_only && node->refs.load(std::memory_order_acquire) != 1)) return 0;
+		if (level == 0) return sizeof(Leaf);
+		size_t total = sizeof(Inner);
+		for (uint32_t c = 0; c < PERSISTENT_LOG_WIDTH; ++c) {
+			total += bytes(static_cast< Inner const * >(node)->children[c], level - 1, owned_only);
+		}
+		return total;
+	}
+
+	Node *root = nullptr;
+	size_t slots; //entries the tree has room for (a whole number of leaves, more than capacity_)
+	uint32_t height; //levels of nodes above the leaves
+	size_t first = 0; //slot of the newest entry
+	size_t count = 0; //number of valid entries
+	size_t capacity_;
+
+	//The leaf the last push wrote to, which this log alone can reach for as long as
+	// no log is copied from this one (a copy shares everything from the root down,
+	// so it cools the log it copies, and that log's next push takes the slow path):
+	mutable Leaf *hot = nullptr;
+	mutable size_t hot_first; //slot of hot->items[0] ('slots', which no slot is, without a hot leaf)
+	void cool() const {
+		hot = nullptr;
+		hot_first = slots;
+	}
+
+	//The leaf operator[] last walked to (reading back through a log goes a leaf at a time):
+	mutable Leaf const *read = nullptr;
+	mutable size_t read_first; //slot of read->items[0] ('slots' without one)
+};
@@ -0,0 +1,184 @@
+#include "PhaseTimers.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#ifdef PHASE_TIMERS
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Histogram buckets: exact below 4, then 4 per power of two (so within ~19%), up to 2^40:
+#define PHASE_BUCKETS 160
+
+std::atomic< bool > phase_timers_enabled(false);
+
+namespace {
+
+uint32_t bucket_of(uint64_t duration) {
+	if (duration < 4) return uint32_t(duration);
+	//index of the highest set bit:
+#if defined(_MSC_VER)
+	unsigned long e;
+	_BitScanReverse64(&e, duration);
+#else
+	uint32_t e = 63 - uint32_t(__builtin_clzll(duration));
+#endif
+	uint32_t bucket = 4 * (e - 1) + uint32_t((duration >> (e - 2)) & 3);
+	return bucket < PHASE_BUCKETS ? bucket : PHASE_BUCKETS - 1;
+}
+
+//Smallest duration that lands in 'bucket':
+uint64_t bucket_start(uint32_t bucket) {
+	if (bucket < 4) return bucket;
+	return uint64_t(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+//One thread's samples; only that thread writes them (so plain loads and stores,
+// just atomic so that dumping from another thread is well-defined):
+struct ThreadHistograms {
+	std::atomic< uint64_t > counts[PHASES][PHASE_BUCKETS];
+	std::atomic< uint64_t > max[PHASES];
+	ThreadHistograms() { clear(); }
+	void clear() {
+		for (uint32_t p = 0; p < PHASES; ++p) {
+			for (auto &count : counts[p]) count.store(0, std::memory_order_relaxed);
+			max[p].store(0, std::memory_order_relaxed);
+		}
+	}
+};
+
+//Every thread's histograms (kept after threads exit, so their samples still get dumped):
+std::mutex registry_mutex;
+std::vector< std::unique_ptr< ThreadHistograms > > registry;
+thread_local ThreadHistograms *mine = nullptr;
+
+//For converting phase_clock() to nanoseconds, measured while recording is on:
+struct Calibration {
+	uint64_t clock = 0;
+	std::chrono::steady_clock::time_point time;
+};
+Calibration calibration_start;
+
+double clock_per_ns() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	//(make sure at least a few milliseconds have passed, for a steady estimate)
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - calibration_start.time < std::chrono::milliseconds(10)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		now = std::chrono::steady_clock::now();
+	}
+	uint64_t clock = phase_clock();
+	double ns = std::chrono::duration< double, std::nano >(now - calibration_start.time).count();
+	return double(clock - calibration_start.clock) / ns;
+#else
+	return 1.0; //(the fallback clock counts nanoseconds)
+#endif
+}
+
+}
+
+uint64_t phase_clock_fallback() {
+	return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void record_phase(Phase phase, uint64_t duration) {
+	if (!mine) {
+		std::lock_guard< std::mutex > lock(registry_mutex);
+		registry.emplace_back(new ThreadHistograms);
+		mine = registry.back().get();
+	}
+	std::atomic< uint64_t > &count = mine->counts[phase][bucket_of(duration)];
+	count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if (duration > mine->max[phase].load(std::memory_order_relaxed)) {
+		mine->max[phase].store(duration, std::memory_order_relaxed);
+	}
+}
+
+void set_phase_timers(bool enabled) {
+	if (enabled && !phase_timers_enabled.load()) {
+		std::lock_guard< std::mutex > lock(registry_mutex);
+		if (calibration_start.clock == 0) {
+			calibration_start.clock = phase_clock();
+			calibration_start.time = std::chrono::steady_clock::now();
+		}
+	}
+	phase_timers_enabled.store(enabled);
+}
+
+void reset_phase_timers() {
+	std::lock_guard< std::mutex > lock(registry_mutex);
+	for (auto &histograms : registry) histograms->clear(); //(samples being recorded right now may survive)
+}
+
+void dump_phase_timers(std::ostream &out) {
+	static char const *names[PHASES] = {
+		"step", "input", "cooldown", "swing", "movement", "log", "rewind", "rift", "hits", "round", "update", "draw",
+	};
+
+	std::lock_guard< std::mutex > lock(registry_mutex);
+	if (calibration_start.clock == 0) {
+		out << "Phase timers: nothing recorded (turn them on with --phase-timers)." << std::endl;
+		return;
+	}
+	double per_ns = clock_per_ns();
+	std::streamsize precision = out.precision();
+
+	out << "Phase timers (ns, merged over " << registry.size() << " thread" << (registry.size() == 1 ? "" : "s") << "):\n";
+	out << "  " << std::left << std::setw(10) << "phase" << std::right
+		<< std::setw(12) << "count" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(12) << "max" << "\n";
+	for (uint32_t p = 0; p < PHASES; ++p) {
+		uint64_t counts[PHASE_BUCKETS] = { };
+		uint64_t total = 0, max = 0;
+		for (auto const &histograms : registry) {
+			for (uint32_t b = 0; b < PHASE_BUCKETS; ++b) {
+				uint64_t count = histograms->counts[p][b].load(std::memory_order_relaxed);
+				counts[b] += count;
+				total += count;
+			}
+			max = std::max(max, histograms->max[p].load(std::memory_order_relaxed));
+		}
+		if (total == 0) continue;
+
+		//smallest bucket with at least 'fraction' of the samples at or below it:
+		auto percentile = [&](double fraction) {
+			uint64_t want = uint64_t(fraction * double(total - 1)) + 1;
+			uint64_t seen = 0;
+			for (uint32_t b = 0; b < PHASE_BUCKETS; ++b) {
+				seen += counts[b];
+				if (seen >= want) return double(bucket_start(b)) / per_ns;
+			}
+			return double(max) / per_ns;
+		};
+		out << "  " << std::left << std::setw(10) << names[p] << std::right << std::fixed << std::setprecision(0)
+			<< std::setw(12) << total << std::setw(10) << percentile(0.50) << std::setw(10) << percentile(0.99)
+			<< std::setw(12) << double(max) / per_ns << "\n";
+	}
+	out << std::defaultfloat << std::setprecision(precision) << std::flush;
+}
+
+bool phase_timers_compiled_in() {
+	return true;
+}
+
+#else //PHASE_TIMERS
+
+bool phase_timers_compiled_in() {
+	return false;
+}
+
+void set_phase_timers(bool) {
+}
+
+void reset_phase_timers() {
+}
+
+void dump_phase_timers(std::ostream &out) {
+	out << "Phase timers: compiled out (build with 'jam -sPHASE_TIMERS=1' to have them)." << std::endl;
+}
+
+#endif //PHASE_TIMERS
@@ -0,0 +1,91 @@
+#pragma once
+
+//Scoped timers around the phases of a tick (cooldowns, swings, movement,
+// history logging, rewind playback, time rifts, hits), for seeing where tick
+// time goes.
+//
+// A PHASE_TIMER(phase) in a block times the rest of that block. Each thread
+// records into its own fixed-size histograms (no locks or shared cache lines
+// on the hot path); dump_phase_timers() merges them and prints count, p50, p99
+// and max per phase.
+//
+// Timers are compiled in only when PHASE_TIMERS is defined ('jam -sPHASE_TIMERS=1',
+// in debug or release builds alike), and then only record while enabled
+// (rewind --phase-timers, rewind-bench phases). Otherwise PHASE_TIMER expands
+// to nothing and dump_phase_timers() just says so, so the builds that ship
+// don't pay for them (even switched off, each timer costs a load and a branch).
+
+#include <iosfwd>
+#include <cstdint>
+
+enum Phase {
+	PHASE_STEP, //all of RewindSim::step
+	PHASE_INPUT, //apply_input
+	PHASE_COOLDOWN, //update_cooldown
+	PHASE_SWING, //update_swing
+	PHASE_MOVEMENT, //update_movements
+	PHASE_LOG, //recording rewind history
+	PHASE_REWIND, //update_rewind
+	PHASE_RIFT, //time rift checks
+	PHASE_HITS, //hit detection
+	PHASE_ROUND, //reset_players
+	PHASE_UPDATE, //all of RewindMode::update (networking, computer opponent and stepping)
+	PHASE_DRAW, //RewindMode::draw
+	PHASES
+};
+
+//Whether this build has the timers (PHASE_TIMERS was defined):
+bool phase_timers_compiled_in();
+//Turns recording on or off (off to begin with; does nothing if compiled out):
+void set_phase_timers(bool enabled);
+//Forgets everything recorded so far, on every thread:
+void reset_phase_timers();
+//Prints every phase that has been recorded, merged over all threads:
+void dump_phase_timers(std::ostream &out);
+
+#ifdef PHASE_TIMERS
+
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+extern std::atomic< bool > phase_timers_enabled;
+
+//(steady_clock nanoseconds, for CPUs without a timestamp counter)
+uint64_t phase_clock_fallback();
+
+//Timestamp counter (cycles where available; converted to nanoseconds when dumped):
+inline uint64_t phase_clock() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return phase_clock_fallback();
+#endif
+}
+
+//Adds one sample (in phase_clock() units) to this thread's histogram for 'phase':
+void record_phase(Phase phase, uint64_t duration);
+
+struct PhaseTimer {
+	PhaseTimer(Phase phase_) : phase(phase_), start(phase_timers_enabled.load(std::memory_order_relaxed) ? phase_clock() : 0) { }
+	~PhaseTimer() {
+		if (start) record_phase(phase, phase_clock() - start);
+	}
+	PhaseTimer(PhaseTimer const &) = delete;
+	PhaseTimer &operator=(PhaseTimer const &) = delete;
+
+	Phase phase;
+	uint64_t start; //0 if not recording
+};
+
+#define PHASE_TIMER(PHASE) PhaseTimer phase_timer_(PHASE)
+
+#else //PHASE_TIMERS
+
+#define PHASE_TIMER(PHASE)
+
+#endif //PHASE_TIMERS
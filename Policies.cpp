@@ -0,0 +1,172 @@
+#include "Policies.hpp"
+#include "MctsBot.hpp"
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+//What a policy needs to know about the match, from one player's point of view:
+struct View {
+	View(RewindSim const &sim, int player) :
+		me(player == PLAYER_ONE ? sim.playerOne() : sim.playerTwo()),
+		other(player == PLAYER_ONE ? sim.playerTwo() : sim.playerOne()) {
+		forward = (me.sword_arm == PLAYER_ONE ? INPUT_RIGHT : INPUT_LEFT);
+		back = (me.sword_arm == PLAYER_ONE ? INPUT_LEFT : INPUT_RIGHT);
+		gap = std::abs(me.head.x - other.head.x);
+		//how far apart heads can be for a full swing to reach the other player's head:
+		reach = 0.2f + std::abs(player_body.right_arm_radius.x) + sim.sword_tip_length + player_body.head_radius.x;
+		at_rest = (me.sword_arm == PLAYER_ONE ? me.right_arm_angle == -60 : me.left_arm_angle == 60);
+	}
+	player_info const &me;
+	player_info const &other;
+	uint8_t forward, back;
+	float gap;
+	float reach;
+	bool at_rest;
+};
+
+struct IdlePolicy : BotPolicy {
+	virtual uint8_t act(RewindSim const &, int) override {
+		return 0;
+	}
+};
+
+//Same held-button pattern as rewind-bench's random inputs:
+struct RandomPolicy : BotPolicy {
+	virtual void reset(uint32_t seed) override {
+		mt.seed(seed);
+		hold = 0;
+	}
+	virtual uint8_t act(RewindSim const &, int) override {
+		if (hold == 0) {
+			held = uint8_t(mt() & (INPUT_LEFT | INPUT_RIGHT | INPUT_ATTACK | INPUT_REWIND));
+			hold = 1 + mt() % 30;
+		}
+		hold -= 1;
+		return held;
+	}
+	std::mt19937 mt;
+	uint8_t held = 0;
+	uint32_t hold = 0;
+};
+
+struct RushPolicy : BotPolicy {
+	virtual uint8_t act(RewindSim const &sim, int player) override {
+		View view(sim, player);
+		if (view.gap > view.reach - 0.3f) return view.forward;
+		return view.forward | (view.at_rest ? INPUT_ATTACK : 0);
+	}
+};
+
+struct CounterPolicy : BotPolicy {
+	virtual uint8_t act(RewindSim const &sim, int player) override {
+		View view(sim, player);
+		bool threatened = (view.other.is_attacking == 1 && view.gap < view.reach + 0.5f);
+
+		//Rewind out of incoming swings (and keep rewinding until the swing is over):
+		if (threatened && (view.me.is_rewinding == 1 || (view.me.is_cooling == 0 && !view.me.rewind_log.empty()))) {
+			return INPUT_REWIND;
+		}
+
+		if (view.at_rest && view.gap <= view.reach + 0.1f) return INPUT_ATTACK; //(early, for anyone walking in)
+		//Otherwise hover just out of reach:
+		if (view.gap > view.reach + 0.6f) return view.forward;
+		if (view.gap < view.reach + 0.2f) return view.back;
+		return 0;
+	}
+};
+
+struct MctsPolicy : BotPolicy {
+	MctsPolicy(float tick_rate) : bot(PLAYER_ONE, tick_rate, 1) { }
+	virtual void reset(uint32_t seed) override {
+		bot.reset();
+		bot.rollout_counter = uint64_t(seed) << 32;
+	}
+	virtual uint8_t act(RewindSim const &sim, int player) override {
+		if (bot.player != player) {
+			bot.player = player;
+			bot.reset();
+		}
+		return bot.act(sim, 0.0); //(one batch of rollouts per tick)
+	}
+	MctsBot bot;
+};
+
+}
+
+std::vector< std::string > policy_names() {
+	return { "idle", "random", "rush", "counter", "mcts" };
+}
+
+std::unique_ptr< BotPolicy > make_policy(std::string const &name, float tick_rate) {
+	if (name == "idle") return std::unique_ptr< BotPolicy >(new IdlePolicy());
+	if (name == "random") return std::unique_ptr< BotPolicy >(new RandomPolicy());
+	if (name == "rush") return std::unique_ptr< BotPolicy >(new RushPolicy());
+	if (name == "counter") return std::unique_ptr< BotPolicy >(new CounterPolicy());
+	if (name == "mcts") return std::unique_ptr< BotPolicy >(new MctsPolicy(tick_rate));
+	throw std::runtime_error("Unknown policy '" + name + "'.");
+}
+
+MatchResult play_match(RewindSim &sim, BotPolicy &one, BotPolicy &two, uint32_t rounds) {
+	uint32_t const max_ticks = uint32_t(MAX_MATCH_SECONDS * sim.tick_rate);
+
+	sim.left_score = 0;
+	sim.right_score = 0;
+	sim.reset_players();
+	uint32_t round_at_start = sim.round;
+
+	MatchResult result;
+	while (sim.left_score < rounds && sim.right_score < rounds && result.ticks < max_ticks) {
+		int one_was_rewinding = sim.playerOne().is_rewinding, two_was_rewinding = sim.playerTwo().is_rewinding;
+		uint32_t left_before = sim.left_score, right_before = sim.right_score;
+		uint32_t round = sim.round;
+		uint8_t one_input = one.act(sim, PLAYER_ONE);
+		uint8_t two_input = two.act(sim, PLAYER_TWO);
+		sim.step(one_input, two_input);
+		result.ticks += 1;
+		if (sim.round != round) result.round_ticks = result.ticks;
+		if (!one_was_rewinding && sim.playerOne().is_rewinding) result.rewinds += 1;
+		if (!two_was_rewinding && sim.playerTwo().is_rewinding) result.rewinds += 1; //(with RewindSim::two_rewinders, both can start at once)
+		if (sim.left_score != left_before && sim.right_score != right_before) result.double_hits += 1;
+	}
+
+	result.rounds = sim.round - round_at_start;
+	result.left_score = sim.left_score;
+	result.right_score = sim.right_score;
+	result.timed_out = (result.ticks >= max_ticks);
+	return result;
+}
+
+void MatchTally::add(MatchResult const &result, bool swapped) {
+	matches += 1;
+	timeouts += (result.timed_out ? 1 : 0);
+	rounds += result.rounds;
+	left_rounds += result.left_score;
+	right_rounds += result.right_score;
+	double_hits += result.double_hits;
+	rewinds += result.rewinds;
+	ticks += result.ticks;
+	round_ticks += result.round_ticks;
+	uint32_t a_score = (swapped ? result.right_score : result.left_score);
+	uint32_t b_score = (swapped ? result.left_score : result.right_score);
+	if (a_score > b_score) a_wins += 1;
+	else if (b_score > a_score) b_wins += 1;
+	else draws += 1;
+}
+
+void MatchTally::add(MatchTally const &other) {
+	matches += other.matches;
+	a_wins += other.a_wins;
+	b_wins += other.b_wins;
+	draws += other.draws;
+	timeouts += other.timeouts;
+	rounds += other.rounds;
+	left_rounds += other.left_rounds;
+	right_rounds += other.right_rounds;
+	double_hits += other.double_hits;
+	rewinds += other.rewinds;
+	ticks += other.ticks;
+	round_ticks += other.round_ticks;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+//Computer players for headless matches (self-play tournaments, tests).
+// Each policy looks at the match and returns the buttons to hold for the
+// next tick, so any policy can play either side. play_match() plays a whole
+// match between two of them (shared by rewind-tournament and rewind-sweep).
+//
+//  idle     holds nothing
+//  random   random buttons, changed every few ticks
+//  rush     walks straight in and swings as soon as the sword can reach
+//  counter  keeps just out of reach, swings at anyone who steps in, and rewinds away from swings
+//  mcts     MctsBot (one thread, one batch of rollouts per tick)
+
+#include "RewindSim.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct BotPolicy {
+	virtual ~BotPolicy() { }
+	//Called before each match, with a seed for any randomness (so a match plays out
+	// the same way whichever thread runs it):
+	virtual void reset(uint32_t /*seed*/) { }
+	//Buttons for 'player' (PLAYER_ONE or PLAYER_TWO) to hold for the next step of 'sim':
+	virtual uint8_t act(RewindSim const &sim, int player) = 0;
+};
+
+//Names accepted by make_policy:
+std::vector< std::string > policy_names();
+
+//Makes a policy by name (throws if there is no such policy):
+std::unique_ptr< BotPolicy > make_policy(std::string const &name, float tick_rate);
+
+//Matches still going after this long are decided by score (or drawn, if tied):
+#define MAX_MATCH_SECONDS 120.0f
+
+//What happened in one match:
+struct MatchResult {
+	uint32_t ticks = 0;
+	uint32_t round_ticks = 0; //ticks up to the end of the last round that finished
+	uint32_t rounds = 0; //rounds that finished
+	uint32_t left_score = 0;
+	uint32_t right_score = 0;
+	uint32_t double_hits = 0; //rounds both players won at once
+	uint32_t rewinds = 0; //rewinds started
+	bool timed_out = false; //hit MAX_MATCH_SECONDS
+};
+
+//Plays a match in 'sim' (starting from a new round and no score) between policy 'one'
+// on the left and 'two' on the right, until one of them has won 'rounds' rounds or
+// MAX_MATCH_SECONDS have gone by:
+MatchResult play_match(RewindSim &sim, BotPolicy &one, BotPolicy &two, uint32_t rounds);
+
+//Outcomes of many matches between policy 'a' and policy 'b' (who may be on either side):
+struct MatchTally {
+	uint64_t matches = 0;
+	uint64_t a_wins = 0;
+	uint64_t b_wins = 0;
+	uint64_t draws = 0;
+	uint64_t timeouts = 0; //matches that hit MAX_MATCH_SECONDS
+	uint64_t rounds = 0;
+	uint64_t left_rounds = 0; //rounds won by the player on the left (whichever policy that was)
+	uint64_t right_rounds = 0;
+	uint64_t double_hits = 0;
+	uint64_t rewinds = 0;
+	uint64_t ticks = 0;
+	uint64_t round_ticks = 0; //ticks of rounds that finished (not the unfinished end of a timed-out match)
+
+	//Counts a match ('swapped' if 'a' played on the right):
+	void add(MatchResult const &result, bool swapped);
+	void add(MatchTally const &other);
+};
@@ -0,0 +1,341 @@
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static char const HEADER_MAGIC[4] = {'R', 'W', 'R', 'P'};
+static char const FOOTER_MAGIC[4] = {'R', 'W', 'R', 'E'};
+static uint32_t const VERSION = 6; //(2: get_sin/get_cos moved to DegreeTrig, which changes results slightly; 3: fractional-speed rewinds; 4: rules constants in snapshots; 5: hot/cold player_state; 6: rewind rules in snapshots)
+//Set in the version of replays recorded by fixed point builds (SimScalar.hpp), whose matches play out differently:
+static uint32_t const FIXED_POINT_VERSION = 0x10000;
+static uint32_t const BUILD_VERSION = VERSION | (SIM_FIXED_POINT ? FIXED_POINT_VERSION : 0);
+static size_t const HEADER_SIZE = 4 + 4 + 4 + 4;
+static size_t const INDEX_ENTRY_SIZE = 4 + 4 + 8;
+static size_t const FOOTER_SIZE = 8 + 4 + 4 + 4;
+static size_t const STATE_SIZE = sizeof(RewindSnapshot::State);
+
+template< typename T >
+static void append(std::vector< uint8_t > *to, T const &value) {
+	uint8_t const *bytes = reinterpret_cast< uint8_t const * >(&value);
+	to->insert(to->end(), bytes, bytes + sizeof(T));
+}
+
+template< typename T >
+static T read(uint8_t const *at) {
+	T value;
+	std::memcpy(&value, at, sizeof(T));
+	return value;
+}
+
+//----------------------------------------------------------
+
+ReplayWriter::ReplayWriter(std::string const &filename_, RewindSim const &sim)
+	: filename(filename_), file(filename_.c_str(), std::ios::binary),
+	  keyframe_interval(std::max(1u, uint32_t(REPLAY_KEYFRAME_SECONDS * sim.tick_rate))) {
+	if (!file) {
+		throw std::runtime_error("Failed to open replay file '" + filename + "' for writing.");
+	}
+	std::vector< uint8_t > header;
+	header.insert(header.end(), HEADER_MAGIC, HEADER_MAGIC + 4);
+	append(&header, BUILD_VERSION);
+	append(&header, uint32_t(STATE_SIZE));
+	append(&header, sim.tick_rate);
+	assert(header.size() == HEADER_SIZE);
+	file.write(reinterpret_cast< char const * >(header.data()), header.size());
+}
+
+ReplayWriter::~ReplayWriter() {
+	try {
+		finish();
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+	}
+}
+
+void ReplayWriter::record(RewindSim const &sim, uint8_t player_one_input, uint8_t player_two_input) {
+	assert(!finished);
+
+	bool keyframe_due = keyframes.empty();
+	if (!keyframe_due) {
+		uint32_t since = tick - keyframes.back().tick;
+		bool small = sim.playerOne().rewind_log.empty() && sim.playerTwo().rewind_log.empty();
+		keyframe_due = (since >= keyframe_interval && small) || since >= 2 * keyframe_interval;
+	}
+
+	if (keyframe_due) {
+		end_segment();
+		keyframes.emplace_back();
+		keyframes.back().tick = tick;
+		keyframes.back().offset = uint64_t(file.tellp());
+
+		sim.save(&snapshot);
+		file.write(reinterpret_cast< char const * >(&tick), 4);
+		file.write(reinterpret_cast< char const * >(&snapshot.state), STATE_SIZE);
+		file.write(reinterpret_cast< char const * >(snapshot.tail.data()), snapshot.tail.size() * sizeof(glm::vec4));
+	}
+
+	uint8_t input = uint8_t((player_one_input & 0xf) | ((player_two_input & 0xf) << 4));
+	if (run_length > 0 && input == run_input) {
+		run_length += 1;
+	} else {
+		end_run();
+		run_input = input;
+		run_length = 1;
+	}
+	tick += 1;
+}
+
+void ReplayWriter::end_run() {
+	if (run_length == 0) return;
+	segment.emplace_back(uint8_t(run_input ^ segment_previous));
+	segment_previous = run_input;
+	//varint: seven bits per byte, high bit set if more bytes follow:
+	uint32_t length = run_length;
+	while (length >= 0x80) {
+		segment.emplace_back(uint8_t(length | 0x80));
+		length >>= 7;
+	}
+	segment.emplace_back(uint8_t(length));
+	run_length = 0;
+}
+
+void ReplayWriter::end_segment() {
+	end_run();
+	file.write(reinterpret_cast< char const * >(segment.data()), segment.size());
+	segment.clear();
+	segment_previous = 0;
+}
+
+void ReplayWriter::finish() {
+	if (finished) return;
+	finished = true;
+
+	end_segment();
+
+	std::vector< uint8_t > footer;
+	uint64_t index_offset = uint64_t(file.tellp());
+	for (auto const &keyframe : keyframes) {
+		append(&footer, keyframe.tick);
+		append(&footer, uint32_t(0));
+		append(&footer, keyframe.offset);
+	}
+	append(&footer, index_offset);
+	append(&footer, uint32_t(keyframes.size()));
+	append(&footer, tick);
+	footer.insert(footer.end(), FOOTER_MAGIC, FOOTER_MAGIC + 4);
+	file.write(reinterpret_cast< char const * >(footer.data()), footer.size());
+
+	file.close();
+	if (!file) {
+		throw std::runtime_error("Failed to write replay file '" + filename + "'.");
+	}
+}
+
+//----------------------------------------------------------
+
+ReplayReader::ReplayReader(std::string const &filename) {
+	std::string error;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open replay file '" + filename + "'.");
+	}
+	file_handle = file;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		error = "is empty";
+	} else {
+		size = size_t(file_size.QuadPart);
+		mapping_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping_handle) data = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+		if (!data) error = "could not be mapped";
+	}
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open replay file '" + filename + "'.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		error = "is empty";
+	} else {
+		size = size_t(info.st_size);
+		void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) data = reinterpret_cast< uint8_t const * >(mapped);
+		else error = "could not be mapped";
+	}
+	close(fd); //(the mapping stays valid)
+#endif
+
+	if (error.empty()) {
+		if (size < HEADER_SIZE + FOOTER_SIZE
+		 || std::memcmp(data, HEADER_MAGIC, 4) != 0
+		 || std::memcmp(data + size - 4, FOOTER_MAGIC, 4) != 0) {
+			error = "is not a replay";
+		} else if ((read< uint32_t >(data + 4) ^ BUILD_VERSION) == FIXED_POINT_VERSION) {
+			error = (SIM_FIXED_POINT ? "was recorded by a build that simulates in floats" : "was recorded by a build that simulates in fixed point");
+		} else if (read< uint32_t >(data + 4) != BUILD_VERSION || read< uint32_t >(data + 8) != STATE_SIZE) {
+			error = "was written by a different version of the game";
+		} else {
+			tick_rate = read< float >(data + 12);
+			uint8_t const *footer = data + size - FOOTER_SIZE;
+			index_offset = read< uint64_t >(footer);
+			keyframe_count = read< uint32_t >(footer + 8);
+			tick_count = read< uint32_t >(footer + 12);
+			if (index_offset < HEADER_SIZE || index_offset > size - FOOTER_SIZE
+			 || index_offset + uint64_t(keyframe_count) * INDEX_ENTRY_SIZE != size - FOOTER_SIZE) {
+				error = "has a damaged index";
+			} else {
+				index = data + index_offset;
+				if ((keyframe_count == 0 && tick_count != 0)
+				 || (keyframe_count > 0 && keyframe_tick(0) != 0)) {
+					error = "has a damaged index";
+				}
+			}
+		}
+	}
+
+	if (!error.empty()) {
+		unmap();
+		throw std::runtime_error("Replay file '" + filename + "' " + error + ".");
+	}
+}
+
+ReplayReader::~ReplayReader() {
+	unmap();
+}
+
+void ReplayReader::unmap() {
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+#else
+	if (data) munmap(const_cast< uint8_t * >(data), size);
+#endif
+	data = nullptr;
+	index = nullptr;
+}
+
+uint32_t ReplayReader::keyframe_tick(uint32_t k) const {
+	assert(k < keyframe_count);
+	return read< uint32_t >(index + k * INDEX_ENTRY_SIZE);
+}
+
+uint64_t ReplayReader::keyframe_offset(uint32_t k) const {
+	assert(k < keyframe_count);
+	return read< uint64_t >(index + k * INDEX_ENTRY_SIZE + 8);
+}
+
+uint8_t const *ReplayReader::read_keyframe(uint32_t k, RewindSnapshot *into) {
+	uint64_t offset = keyframe_offset(k);
+	if (offset < HEADER_SIZE || offset + 4 + STATE_SIZE > index_offset) {
+		throw std::runtime_error("Replay keyframe is out of bounds.");
+	}
+	uint8_t const *at = data + offset + 4;
+
+	uint32_t log_size[2];
+	std::memcpy(log_size, at + offsetof(RewindSnapshot::State, log_size), sizeof(log_size));
+	uint64_t tail_size = (uint64_t(log_size[0]) + log_size[1]) * sizeof(glm::vec4);
+	if (offset + 4 + STATE_SIZE + tail_size > index_offset) {
+		throw std::runtime_error("Replay keyframe is out of bounds.");
+	}
+
+	if (into) {
+		std::memcpy(&into->state, at, STATE_SIZE);
+		into->tail.resize(size_t(log_size[0]) + log_size[1]);
+		std::memcpy(into->tail.data(), at + STATE_SIZE, size_t(tail_size));
+	}
+	return at + STATE_SIZE + tail_size;
+}
+
+void ReplayReader::start_segment(uint32_t k, uint8_t const *inputs) {
+	keyframe = k;
+	tick = keyframe_tick(k);
+	at = inputs;
+	segment_end = data + (k + 1 < keyframe_count ? keyframe_offset(k + 1) : index_offset);
+	if (segment_end < at) {
+		throw std::runtime_error("Replay segment is out of bounds.");
+	}
+	input = 0;
+	run_left = 0;
+}
+
+void ReplayReader::seek(RewindSim *sim, uint32_t to) {
+	assert(sim);
+	to = std::min(to, tick_count);
+	if (keyframe_count == 0) {
+		tick = 0;
+		return;
+	}
+
+	//last keyframe at or before 'to':
+	uint32_t begin = 0, end = keyframe_count;
+	while (end - begin > 1) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (keyframe_tick(mid) <= to) begin = mid;
+		else end = mid;
+	}
+
+	start_segment(begin, read_keyframe(begin, &snapshot));
+	sim->restore(snapshot);
+
+	uint8_t player_one_input, player_two_input;
+	while (tick < to && next_input(&player_one_input, &player_two_input)) {
+		sim->step(player_one_input, player_two_input);
+	}
+}
+
+bool ReplayReader::next_input(uint8_t *player_one_input, uint8_t *player_two_input) {
+	if (tick >= tick_count || at == nullptr) return false;
+
+	if (run_left == 0) {
+		if (at == segment_end) {
+			//the sim is already in the next keyframe's state, so only its inputs are needed:
+			if (keyframe + 1 >= keyframe_count || keyframe_tick(keyframe + 1) != tick) {
+				throw std::runtime_error("Replay segment has the wrong number of ticks.");
+			}
+			start_segment(keyframe + 1, read_keyframe(keyframe + 1, nullptr));
+			if (at == segment_end) {
+				throw std::runtime_error("Replay segment is empty.");
+			}
+		}
+		input ^= *at;
+		at += 1;
+		for (uint32_t shift = 0; ; shift += 7) {
+			if (at == segment_end || shift > 28) {
+				throw std::runtime_error("Replay input run is damaged.");
+			}
+			uint8_t byte = *at;
+			at += 1;
+			run_left |= uint32_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) break;
+		}
+		if (run_left == 0) {
+			throw std::runtime_error("Replay input run is empty.");
+		}
+	}
+
+	run_left -= 1;
+	*player_one_input = input & 0xf;
+	*player_two_input = input >> 4;
+	tick += 1;
+	return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+//Recording and playing back matches.
+//
+// A replay stores the inputs of every tick plus occasional keyframes
+// (full RewindSnapshots), so playback can start anywhere by restoring the
+// nearest earlier keyframe and re-simulating from there.
+//
+// File layout (all values little-endian, as written by the host):
+//  header:   "RWRP", uint32 version, uint32 sizeof(RewindSnapshot::State), float tick rate
+//  segments: one per keyframe:
+//            uint32 tick, RewindSnapshot::State, rewind log tail (glm::vec4 x log sizes),
+//            then the inputs from that tick up to the next keyframe, as runs of
+//            equal input: one byte (new input XOR previous input, where each
+//            tick's input is player_one | player_two << 4; the previous input
+//            starts at 0 in every segment) followed by a varint run length.
+//  index:    one { uint32 tick, uint32 (zero), uint64 file offset } per keyframe
+//  footer:   uint64 index offset, uint32 keyframe count, uint32 tick count, "RWRE"
+
+#include "RewindSim.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//Aim for a keyframe about this often (preferring ticks where the rewind logs are empty, since those keyframes are small):
+#define REPLAY_KEYFRAME_SECONDS 10.0f
+
+struct ReplayWriter {
+	//Starts writing a replay of the match in 'sim' (throws if the file can't be opened):
+	ReplayWriter(std::string const &filename, RewindSim const &sim);
+	~ReplayWriter(); //calls finish() if needed
+
+	//Records one tick; call just before sim.step() with the same inputs:
+	void record(RewindSim const &sim, uint8_t player_one_input, uint8_t player_two_input);
+
+	//Writes the index and closes the file:
+	void finish();
+
+	std::string filename;
+	std::ofstream file;
+	uint32_t keyframe_interval; //ticks
+	uint32_t tick = 0; //number of ticks recorded so far
+
+	struct Keyframe {
+		uint32_t tick;
+		uint64_t offset;
+	};
+	std::vector< Keyframe > keyframes;
+
+	//inputs of the current segment:
+	std::vector< uint8_t > segment;
+	uint8_t segment_previous = 0; //input of the last run written to 'segment'
+	uint8_t run_input = 0;
+	uint32_t run_length = 0;
+
+	RewindSnapshot snapshot; //(scratch space for keyframes)
+	bool finished = false;
+
+	void end_run();
+	void end_segment();
+};
+
+//Reads a replay through a read-only memory mapping of the file.
+struct ReplayReader {
+	//Opens and checks a replay (throws if it can't be opened or doesn't look right):
+	ReplayReader(std::string const &filename);
+	~ReplayReader();
+	ReplayReader(ReplayReader const &) = delete;
+	ReplayReader &operator=(ReplayReader const &) = delete;
+
+	float tick_rate = 0.0f;
+	uint32_t tick_count = 0;
+	uint32_t keyframe_count = 0;
+
+	//Puts 'sim' (which must have been made with 'tick_rate') in the state it was
+	// in just before tick 'to' (clamped to tick_count), and continues playback from there:
+	void seek(RewindSim *sim, uint32_t to);
+
+	//Inputs for the next tick of playback (returns false at the end of the replay):
+	// (the caller steps the sim; seek() must have been called first)
+	bool next_input(uint8_t *player_one_input, uint8_t *player_two_input);
+
+	//Ticks of playback so far (the tick next_input() will return the inputs for):
+	uint32_t tick = 0;
+
+	//--- internals ---
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+	uint8_t const *index = nullptr;
+	uint64_t index_offset = 0;
+
+	//playback position:
+	uint32_t keyframe = 0; //segment being played
+	uint8_t const *at = nullptr; //next run in the segment
+	uint8_t const *segment_end = nullptr;
+	uint8_t input = 0;
+	uint32_t run_left = 0;
+
+	RewindSnapshot snapshot; //(scratch space for keyframes)
+
+	//mapping handles (only used on Windows):
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+
+	uint32_t keyframe_tick(uint32_t k) const;
+	uint64_t keyframe_offset(uint32_t k) const;
+	//reads keyframe k into 'into' (if not null) and returns a pointer to its inputs:
+	uint8_t const *read_keyframe(uint32_t k, RewindSnapshot *into);
+	void start_segment(uint32_t k, uint8_t const *inputs);
+	void unmap();
+};
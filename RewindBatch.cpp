@@ -0,0 +1,242 @@
+#include "RewindBatch.hpp"
+#include "RewindBatchKernels.hpp"
+#include "RewindSim.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+//One match at a time; masks are 0 or -1 (all bits set), just like the SIMD versions:
+struct LanesScalar {
+	enum { N = 1 };
+	typedef float F;
+	typedef int32_t I;
+	typedef double D;
+
+	static F loadf(float const *at) { return *at; }
+	static void storef(float *at, F v) { *at = v; }
+	static F setf(float v) { return v; }
+	static F add(F a, F b) { return a + b; }
+	static F sub(F a, F b) { return a - b; }
+	static F mul(F a, F b) { return a * b; }
+	static F absf(F a) { return std::fabs(a); }
+	static I lt(F a, F b) { return a < b ? -1 : 0; }
+	static I le(F a, F b) { return a <= b ? -1 : 0; }
+	static I eq(F a, F b) { return a == b ? -1 : 0; }
+	static F selectf(I m, F a, F b) { return m ? a : b; }
+	static F tofloat(I a) { return float(a); }
+	static I truncate(F a) { return int32_t(a); }
+
+	static I loadi(int32_t const *at) { return *at; }
+	static void storei(int32_t *at, I v) { *at = v; }
+	static I seti(int32_t v) { return v; }
+	static I load_u8(uint8_t const *at) { return *at; }
+	static I iadd(I a, I b) { return int32_t(uint32_t(a) + uint32_t(b)); }
+	static I isub(I a, I b) { return int32_t(uint32_t(a) - uint32_t(b)); }
+	static I shl2(I a) { return a * 4; }
+	static I ieq(I a, I b) { return a == b ? -1 : 0; }
+	static I igt(I a, I b) { return a > b ? -1 : 0; }
+	static I ilt(I a, I b) { return a < b ? -1 : 0; }
+	static I and_(I a, I b) { return a & b; }
+	static I or_(I a, I b) { return a | b; }
+	static I andnot_(I a, I b) { return a & ~b; }
+	static I not_(I a) { return ~a; }
+	static I select(I m, I a, I b) { return m ? a : b; }
+	static bool any(I m) { return m != 0; }
+
+	static F gather(float const *base, I index) { return base[index]; }
+	static void scatter(float *base, I index, F v, I m) { if (m) base[index] = v; }
+
+	static D setd(double v) { return v; }
+	static D loadd(double const *at) { return *at; }
+	static D gatherd(double const *base, I index) { return base[index]; }
+	static D dadd(D a, D b) { return a + b; }
+	static D dsub(D a, D b) { return a - b; }
+	static D dmul(D a, D b) { return a * b; }
+	static D widen(F a) { return double(a); }
+	static F narrow(D a) { return float(a); }
+};
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+}
+
+//defined in RewindBatch_avx2.cpp:
+BatchKernels const *batch_kernels_avx2_unchecked();
+
+BatchKernels const *batch_kernels_scalar() {
+	return BatchKernelsT< LanesScalar >::kernels("scalar");
+}
+
+BatchKernels const *batch_kernels_avx2() {
+	static bool const supported = cpu_has_avx2();
+	return supported ? batch_kernels_avx2_unchecked() : nullptr;
+}
+
+RewindBatch::RewindBatch(size_t matches_, float tick_rate, RewindParams const &rules, BatchKernels const *kernels_)
+	: matches(matches_), count((matches_ + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES), kernels(kernels_) {
+
+	if (!kernels) kernels = batch_kernels_avx2();
+	if (!kernels) kernels = batch_kernels_sse();
+	if (!kernels) kernels = batch_kernels_scalar();
+
+	//take everything from a default match, so the two can't drift apart:
+	RewindSim sim(tick_rate, rules);
+	player_info const *players[2] = { &sim.playerOne(), &sim.playerTwo() };
+
+	float ticks = sim.tick * TICK_RATE;
+	params.elapsed = sim.tick;
+	params.walk = sim.params.walk_speed * ticks;
+	params.swing = ticks * sim.params.attack_speed;
+	params.retract = ticks * sim.params.attack_cooldown;
+	params.court_x = sim.court_radius.x;
+	params.head_radius_x = player_body.head_radius.x;
+	params.head_radius_y = player_body.head_radius.y;
+	params.torso_radius_x = player_body.torso_radius.x;
+	params.torso_radius_y = player_body.torso_radius.y;
+	params.sword_tip_length = sim.sword_tip_length;
+	params.sword_arm_radius[0] = player_body.right_arm_radius.x;
+	params.sword_arm_radius[1] = player_body.left_arm_radius.x;
+	params.back_arm_reach[0] = player_body.left_arm_radius.x * get_cos(sim.playerOne().left_arm_angle);
+	params.back_arm_reach[1] = player_body.right_arm_radius.x * get_cos(sim.playerTwo().right_arm_angle);
+	params.rewind_speed = sim.params.rewind_speed;
+	params.max_rewind = sim.params.max_rewind;
+	params.rewind_cooldown = sim.params.rewind_cooldown;
+	params.max_dist = sim.params.max_dist;
+	params.overlap_dist = sim.params.overlap_dist;
+	params.log_capacity = int32_t(sim.playerOne().rewind_log.capacity());
+
+	for (int p = 0; p < 2; ++p) {
+		player_info const &player = *players[p];
+		float sword_angle = (p == 0 ? player.right_arm_angle : player.left_arm_angle);
+		params.init_x[p] = player.head.x;
+		params.init_y[p] = player.head.y;
+
+		input[p].assign(count, 0);
+		head_x[p].assign(count, player.head.x);
+		head_y[p].assign(count, player.head.y);
+		angle[p].assign(count, sword_angle);
+		is_attacking[p].assign(count, 0);
+		is_rewinding[p].assign(count, 0);
+		is_cooling[p].assign(count, 0);
+		seconds_passed[p].assign(count, 0.0f);
+		rewind_offset[p].assign(count, 0.0f);
+		seconds_cooldown[p].assign(count, 0.0f);
+
+		log[p].assign(count * params.log_capacity * 4, 0.0f);
+		log_first[p].assign(count, 0);
+		log_count[p].assign(count, 0);
+	}
+
+	log_base.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		log_base[i] = int32_t(i * params.log_capacity * 4);
+	}
+
+	left_score.assign(count, 0);
+	right_score.assign(count, 0);
+	round.assign(count, 0);
+	round_over.assign(count, 0);
+}
+
+BatchArrays RewindBatch::arrays() {
+	BatchArrays a;
+	a.count = count;
+	a.params = params;
+	for (int p = 0; p < 2; ++p) {
+		a.input[p] = input[p].data();
+		a.head_x[p] = head_x[p].data();
+		a.head_y[p] = head_y[p].data();
+		a.angle[p] = angle[p].data();
+		a.is_attacking[p] = is_attacking[p].data();
+		a.is_rewinding[p] = is_rewinding[p].data();
+		a.is_cooling[p] = is_cooling[p].data();
+		a.seconds_passed[p] = seconds_passed[p].data();
+		a.rewind_offset[p] = rewind_offset[p].data();
+		a.seconds_cooldown[p] = seconds_cooldown[p].data();
+		a.log[p] = log[p].data();
+		a.log_first[p] = log_first[p].data();
+		a.log_count[p] = log_count[p].data();
+	}
+	a.log_base = log_base.data();
+	a.left_score = left_score.data();
+	a.right_score = right_score.data();
+	a.round = round.data();
+	a.round_over = round_over.data();
+	return a;
+}
+
+void RewindBatch::step() {
+	BatchArrays a = arrays();
+
+	kernels->input(a);
+
+	for (int p = 0; p < 2; ++p) {
+		kernels->swing(a, p);
+		kernels->move(a, p);
+		kernels->log(a, p);
+		kernels->rewind(a, p);
+	}
+
+	kernels->resolve(a);
+	kernels->reset(a);
+}
+
+char const *RewindBatch::compare(size_t i, RewindSim const &sim) const {
+	//floats are compared bit for bit:
+	auto same = [](float a, float b) {
+		return std::memcmp(&a, &b, sizeof(float)) == 0;
+	};
+
+	if (left_score[i] != sim.left_score) return "left_score";
+	if (right_score[i] != sim.right_score) return "right_score";
+	if (round[i] != sim.round) return "round";
+
+	player_info const *players[2] = { &sim.playerOne(), &sim.playerTwo() };
+	for (int p = 0; p < 2; ++p) {
+		player_info const &player = *players[p];
+		float sword_angle = (p == 0 ? player.right_arm_angle : player.left_arm_angle);
+		if (!same(head_x[p][i], player.head.x)) return "head.x";
+		if (!same(head_y[p][i], player.head.y)) return "head.y";
+		if (!same(angle[p][i], sword_angle)) return "sword arm angle";
+		if (is_attacking[p][i] != player.is_attacking) return "is_attacking";
+		if (is_rewinding[p][i] != player.is_rewinding) return "is_rewinding";
+		if (is_cooling[p][i] != player.is_cooling) return "is_cooling";
+		if (!same(seconds_passed[p][i], player.seconds_passed)) return "seconds_passed";
+		if (!same(rewind_offset[p][i], player.rewind_offset)) return "rewind_offset";
+		if (!same(seconds_cooldown[p][i], player.seconds_cooldown)) return "seconds_cooldown";
+
+		if (size_t(log_count[p][i]) != player.rewind_log.size()) return "rewind_log size";
+		for (size_t e = 0; e < player.rewind_log.size(); ++e) {
+			size_t slot = (log_first[p][i] + e) % params.log_capacity;
+			float const *entry = &log[p][log_base[i] + 4 * slot];
+			glm::vec4 const &expected = player.rewind_log[e];
+			if (!same(entry[0], expected.x) || !same(entry[1], expected.y)
+			 || !same(entry[2], expected.z) || !same(entry[3], expected.w)) {
+				return "rewind_log entry";
+			}
+		}
+	}
+
+	return nullptr;
+}
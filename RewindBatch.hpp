@@ -0,0 +1,126 @@
+#pragma once
+
+//Steps many independent RewindSim matches at once.
+// State is stored as structure-of-arrays (one array per field, one entry per
+// match) and each phase of RewindSim::step runs as a kernel over all matches.
+// Kernels exist for AVX2, SSE2 and plain scalar code; all of them produce
+// results bit-identical to RewindSim::step.
+
+#include "RewindConstants.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct RewindSim;
+
+//Matches are stored in multiples of this many (the widest kernel's lane count):
+#define BATCH_LANES 8
+
+//Rules constants used by the kernels, filled in from a RewindSim with the batch's RewindParams:
+struct BatchParams {
+	float elapsed; //seconds per tick
+	float walk; //distance walked per tick
+	float swing; //degrees the sword moves per tick while attacking
+	float retract; //degrees the sword moves back per tick after attacking
+	float rewind_speed; //log entries played back per tick while rewinding
+	float max_rewind; //seconds of history a rewind can go back
+	float rewind_cooldown; //seconds after a rewind before the next
+	float max_dist; //closest the players can walk to each other
+	float overlap_dist; //time rift distance
+	float court_x; //court_radius.x
+	float head_radius_x, head_radius_y;
+	float torso_radius_x, torso_radius_y;
+	float init_x[2], init_y[2]; //starting head positions
+	double sword_arm_radius[2]; //sword arm's *_arm_radius.x, as used by get_sword_points
+	double sword_tip_length;
+	double back_arm_reach[2]; //offset of the non-sword arm's end, used for the walking limits
+	int32_t log_capacity; //entries per rewind log
+};
+
+//Pointers into the state arrays, as handed to kernels; index [0] is player one, [1] player two:
+struct BatchArrays {
+	size_t count; //number of matches (a multiple of BATCH_LANES)
+	BatchParams params;
+
+	uint8_t *input[2]; //INPUT_* bits held this tick
+
+	float *head_x[2];
+	float *head_y[2];
+	float *angle[2]; //angle of the sword arm (the other arm never moves)
+	int32_t *is_attacking[2];
+	int32_t *is_rewinding[2];
+	int32_t *is_cooling[2];
+	float *seconds_passed[2];
+	float *rewind_offset[2];
+	float *seconds_cooldown[2];
+
+	//rewind logs: match i's entries are (x, y, angle, attacking) at log[p][log_base[i] + 4 * slot]
+	float *log[2];
+	int32_t *log_first[2];
+	int32_t *log_count[2];
+	int32_t *log_base;
+
+	uint32_t *left_score;
+	uint32_t *right_score;
+	uint32_t *round;
+	int32_t *round_over; //set for matches whose round ended this tick
+};
+
+//One implementation of each phase of RewindSim::step:
+struct BatchKernels {
+	char const *name;
+	void (*input)(BatchArrays const &); //apply_input for both players
+	void (*swing)(BatchArrays const &, int player); //rewind cooldown + sword swing
+	void (*move)(BatchArrays const &, int player); //walking
+	void (*log)(BatchArrays const &, int player); //record history
+	void (*rewind)(BatchArrays const &, int player); //play back history
+	void (*resolve)(BatchArrays const &); //time rifts, hits, scores
+	void (*reset)(BatchArrays const &); //start new rounds where round_over is set
+};
+
+//Available kernel sets (nullptr if not compiled in or not supported by this CPU):
+BatchKernels const *batch_kernels_scalar();
+BatchKernels const *batch_kernels_sse();
+BatchKernels const *batch_kernels_avx2();
+
+struct RewindBatch {
+	//Every match plays by 'rules'; 'kernels' defaults to the fastest set this CPU supports:
+	RewindBatch(size_t matches, float tick_rate, RewindParams const &rules = RewindParams(), BatchKernels const *kernels = nullptr);
+
+	//Advances every match by one tick, reading input[0][i] and input[1][i]:
+	void step();
+
+	//Compares match i with 'sim' field by field; returns the first differing field or nullptr:
+	char const *compare(size_t i, RewindSim const &sim) const;
+
+	size_t matches; //matches requested
+	size_t count; //matches stored (rounded up to BATCH_LANES)
+	BatchKernels const *kernels;
+	BatchParams params;
+
+	std::vector< uint8_t > input[2];
+
+	std::vector< float > head_x[2];
+	std::vector< float > head_y[2];
+	std::vector< float > angle[2];
+	std::vector< int32_t > is_attacking[2];
+	std::vector< int32_t > is_rewinding[2];
+	std::vector< int32_t > is_cooling[2];
+	std::vector< float > seconds_passed[2];
+	std::vector< float > rewind_offset[2];
+	std::vector< float > seconds_cooldown[2];
+
+	std::vector< float > log[2];
+	std::vector< int32_t > log_first[2];
+	std::vector< int32_t > log_count[2];
+	std::vector< int32_t > log_base;
+
+	std::vector< uint32_t > left_score;
+	std::vector< uint32_t > right_score;
+	std::vector< uint32_t > round;
+	std::vector< int32_t > round_over;
+
+	//(helpers for step)
+	BatchArrays arrays();
+};
@@ -0,0 +1,336 @@
+#pragma once
+
+//The RewindBatch kernels, written once against a "lanes" type L which
+// provides L::N lanes of float (L::F), int32 / comparison masks (L::I) and
+// double (L::D), along with the operations used below.
+//Each RewindBatch_*.cpp defines a lanes type and instantiates BatchKernelsT.
+//
+//These follow RewindSim.cpp step for step; in particular the sword geometry
+// is done in double precision exactly as get_sword_points does it, so that
+// results stay bit-identical to RewindSim::step.
+//
+//NOTE: this header is compiled with wider instruction sets enabled (e.g.
+// -mavx2), so it must not instantiate any inline code shared with the rest
+// of the program (no glm, no standard containers).
+
+#include "RewindBatch.hpp"
+#include "RewindConstants.hpp"
+#include "DegreeTrig.hpp"
+
+template< typename L >
+struct BatchKernelsT {
+	typedef typename L::F F;
+	typedef typename L::I I;
+	typedef typename L::D D;
+
+	//flags are stored as 0/1, masks are all-bits-set:
+	static I flag(int32_t const *at) {
+		return L::not_(L::ieq(L::loadi(at), L::seti(0)));
+	}
+	static void store_flag(int32_t *at, I mask) {
+		L::storei(at, L::and_(mask, L::seti(1)));
+	}
+	static I held(uint8_t const *at, int32_t bit) {
+		return L::not_(L::ieq(L::and_(L::load_u8(at), L::seti(bit)), L::seti(0)));
+	}
+	static I in_court(BatchParams const &pr, F x) {
+		return L::and_(L::le(x, L::setf(pr.court_x)), L::le(L::setf(-pr.court_x), x));
+	}
+
+	//get_sin/get_cos of 'angle', bit for bit: lanes on a table step within +-270 degrees
+	// (every angle the rules produce at the default tick rate) are looked up in
+	// DegreeTrig's table in-lane; if any lane isn't, the whole block goes through sin_degrees/cos_degrees:
+	static void sincos(F angle, D *s, D *c) {
+		F scaled = L::mul(angle, L::setf(float(DEGREE_TABLE_STEPS_PER_DEGREE))); //(exact, a power of two)
+		I steps = L::truncate(scaled);
+		I on_table = L::and_(L::eq(L::tofloat(steps), scaled), L::le(L::absf(scaled), L::setf(270.0f * DEGREE_TABLE_STEPS_PER_DEGREE)));
+		if (!L::any(L::not_(on_table))) {
+			double const *table = sin_degrees_table();
+			I at = L::iadd(steps, L::seti(DEGREE_TABLE_TURN));
+			*s = L::gatherd(table, at);
+			*c = L::gatherd(table, L::iadd(at, L::seti(DEGREE_TABLE_TURN / 4)));
+			return;
+		}
+		float angles[L::N];
+		double sines[L::N], cosines[L::N];
+		L::storef(angles, angle);
+		for (int l = 0; l < L::N; ++l) {
+			sines[l] = sin_degrees(angles[l]);
+			cosines[l] = cos_degrees(angles[l]);
+		}
+		*s = L::loadd(sines);
+		*c = L::loadd(cosines);
+	}
+
+	//get_sword_points(...)[1] (the sword tip) for 'player' with head at (x, y) and sword arm at 'angle':
+	static void sword_tip(BatchParams const &pr, int player, F x, F y, F angle, F *tip_x, F *tip_y) {
+		D s, c;
+		sincos(angle, &s, &c);
+
+		//arm position, as in player_state::right_arm and left_arm:
+		F arm_x = (player == 0 ? L::add(x, L::setf(0.2f)) : L::sub(x, L::setf(0.2f)));
+		F arm_y = L::add(L::sub(y, L::setf(1.50f)), L::setf(0.4f));
+
+		D radius = L::setd(pr.sword_arm_radius[player]);
+		F hilt_x = L::narrow(L::dadd(L::widen(arm_x), L::dmul(radius, c)));
+		F hilt_y = L::narrow(L::dsub(L::widen(arm_y), L::dmul(radius, s)));
+
+		D length = L::setd(pr.sword_tip_length);
+		if (player == 0) {
+			*tip_x = L::narrow(L::dadd(L::widen(hilt_x), L::dmul(length, c)));
+			*tip_y = L::narrow(L::dsub(L::widen(hilt_y), L::dmul(length, s)));
+		} else {
+			*tip_x = L::narrow(L::dsub(L::widen(hilt_x), L::dmul(length, c)));
+			*tip_y = L::narrow(L::dadd(L::widen(hilt_y), L::dmul(length, s)));
+		}
+	}
+
+	//apply_input() for player one, then player two:
+	static void input(BatchArrays const &a) {
+		for (size_t i = 0; i < a.count; i += L::N) {
+			for (int p = 0; p < 2; ++p) {
+				int o = 1 - p;
+
+				//Attacks can only start when the sword is at rest:
+				I attacking = flag(a.is_attacking[p] + i);
+				I at_rest = L::eq(L::loadf(a.angle[p] + i), L::setf(p == 0 ? -60.0f : 60.0f));
+				attacking = L::or_(attacking, L::and_(held(a.input[p] + i, INPUT_ATTACK), at_rest));
+				store_flag(a.is_attacking[p] + i, attacking);
+
+				I rewinding = flag(a.is_rewinding[p] + i);
+				I cooling = flag(a.is_cooling[p] + i);
+				I other_rewinding = flag(a.is_rewinding[o] + i);
+				I rewind_held = held(a.input[p] + i, INPUT_REWIND);
+
+				I start = L::andnot_(L::andnot_(L::andnot_(rewind_held, rewinding), cooling), other_rewinding);
+				I stop = L::andnot_(rewinding, rewind_held);
+
+				store_flag(a.is_rewinding[p] + i, L::andnot_(L::or_(rewinding, start), stop));
+				store_flag(a.is_cooling[p] + i, L::or_(cooling, stop));
+				L::storef(a.seconds_passed[p] + i, L::selectf(stop, L::setf(0.0f), L::loadf(a.seconds_passed[p] + i)));
+				L::storef(a.rewind_offset[p] + i, L::selectf(stop, L::setf(0.0f), L::loadf(a.rewind_offset[p] + i)));
+			}
+		}
+	}
+
+	//Rewind cooldown and sword swing for players that aren't rewinding:
+	static void swing(BatchArrays const &a, int p) {
+		BatchParams const &pr = a.params;
+		for (size_t i = 0; i < a.count; i += L::N) {
+			I active = L::not_(flag(a.is_rewinding[p] + i));
+
+			I cooling = L::and_(active, flag(a.is_cooling[p] + i));
+			F cooldown = L::loadf(a.seconds_cooldown[p] + i);
+			I cooled = L::and_(cooling, L::le(L::setf(pr.rewind_cooldown), cooldown));
+			cooldown = L::selectf(cooled, L::setf(0.0f), cooldown);
+			cooldown = L::selectf(cooling, L::add(cooldown, L::setf(pr.elapsed)), cooldown);
+			L::storef(a.seconds_cooldown[p] + i, cooldown);
+			store_flag(a.is_cooling[p] + i, L::andnot_(flag(a.is_cooling[p] + i), cooled));
+
+			I attacking = flag(a.is_attacking[p] + i);
+			F angle = L::loadf(a.angle[p] + i);
+			F swung, retracted;
+			I swinging, finished, retracting;
+			if (p == 0) {
+				swinging = L::and_(L::and_(active, attacking), L::le(angle, L::setf(0.0f)));
+				swung = L::add(angle, L::setf(pr.swing));
+				finished = L::and_(swinging, L::le(L::setf(0.0f), swung));
+				retracting = L::and_(L::andnot_(active, attacking), L::lt(L::setf(-60.0f), angle));
+				retracted = L::sub(angle, L::setf(pr.retract));
+				retracted = L::selectf(L::le(retracted, L::setf(-60.0f)), L::setf(-60.0f), retracted);
+			} else {
+				swinging = L::and_(L::and_(active, attacking), L::le(angle, L::setf(60.0f)));
+				swung = L::sub(angle, L::setf(pr.swing));
+				finished = L::and_(swinging, L::le(swung, L::setf(0.0f)));
+				retracting = L::and_(L::andnot_(active, attacking), L::lt(angle, L::setf(60.0f)));
+				retracted = L::add(angle, L::setf(pr.retract));
+				retracted = L::selectf(L::le(L::setf(60.0f), retracted), L::setf(60.0f), retracted);
+			}
+			swung = L::selectf(finished, L::setf(0.0f), swung);
+			angle = L::selectf(swinging, swung, L::selectf(retracting, retracted, angle));
+			L::storef(a.angle[p] + i, angle);
+			store_flag(a.is_attacking[p] + i, L::andnot_(attacking, finished));
+		}
+	}
+
+	//update_movements() for players that aren't rewinding:
+	static void move(BatchArrays const &a, int p) {
+		BatchParams const &pr = a.params;
+		int o = 1 - p;
+		for (size_t i = 0; i < a.count; i += L::N) {
+			I active = L::not_(flag(a.is_rewinding[p] + i));
+			I left = held(a.input[p] + i, INPUT_LEFT);
+			I right = held(a.input[p] + i, INPUT_RIGHT);
+			I go_left = L::andnot_(L::and_(active, left), right);
+			I go_right = L::andnot_(L::and_(active, right), left);
+			if (!L::any(L::or_(go_left, go_right))) continue;
+
+			F x = L::loadf(a.head_x[p] + i);
+			F y = L::loadf(a.head_y[p] + i);
+			I apart = L::not_(L::le(L::absf(L::sub(x, L::loadf(a.head_x[o] + i))), L::setf(pr.max_dist)));
+
+			//walking towards the other player: the sword tip has to stay in the court
+			F tip_x, tip_y;
+			sword_tip(pr, p, x, y, L::loadf(a.angle[p] + i), &tip_x, &tip_y);
+			I forward = L::and_(L::and_(p == 0 ? go_right : go_left, in_court(pr, tip_x)), apart);
+
+			//walking away: the end of the other arm has to stay in the court
+			F arm_x = (p == 0 ? L::sub(x, L::setf(0.2f)) : L::add(x, L::setf(0.2f)));
+			F reach_x = L::narrow(L::dadd(L::widen(arm_x), L::setd(pr.back_arm_reach[p])));
+			I backward = L::and_(p == 0 ? go_left : go_right, in_court(pr, reach_x));
+
+			F towards = (p == 0 ? L::add(x, L::setf(pr.walk)) : L::sub(x, L::setf(pr.walk)));
+			F away = (p == 0 ? L::sub(x, L::setf(pr.walk)) : L::add(x, L::setf(pr.walk)));
+			L::storef(a.head_x[p] + i, L::selectf(forward, towards, L::selectf(backward, away, x)));
+			L::storef(a.head_y[p] + i, L::selectf(L::or_(forward, backward), L::setf(0.0f), y));
+		}
+	}
+
+	//Pushes the current state onto the rewind log of players that aren't rewinding:
+	static void log(BatchArrays const &a, int p) {
+		I capacity = L::seti(a.params.log_capacity);
+		for (size_t i = 0; i < a.count; i += L::N) {
+			I active = L::not_(flag(a.is_rewinding[p] + i));
+
+			I first = L::loadi(a.log_first[p] + i);
+			I count = L::loadi(a.log_count[p] + i);
+			first = L::isub(L::select(L::ieq(first, L::seti(0)), capacity, first), L::seti(1));
+			count = L::select(L::ilt(count, capacity), L::iadd(count, L::seti(1)), count);
+
+			I at = L::iadd(L::loadi(a.log_base + i), L::shl2(first));
+			L::scatter(a.log[p], at, L::loadf(a.head_x[p] + i), active);
+			L::scatter(a.log[p], L::iadd(at, L::seti(1)), L::loadf(a.head_y[p] + i), active);
+			L::scatter(a.log[p], L::iadd(at, L::seti(2)), L::loadf(a.angle[p] + i), active);
+			L::scatter(a.log[p], L::iadd(at, L::seti(3)), L::tofloat(L::loadi(a.is_attacking[p] + i)), active);
+
+			L::storei(a.log_first[p] + i, L::select(active, first, L::loadi(a.log_first[p] + i)));
+			L::storei(a.log_count[p] + i, L::select(active, count, L::loadi(a.log_count[p] + i)));
+		}
+	}
+
+	//update_rewind() for players that are rewinding:
+	static void rewind(BatchArrays const &a, int p) {
+		BatchParams const &pr = a.params;
+		I capacity = L::seti(pr.log_capacity);
+		for (size_t i = 0; i < a.count; i += L::N) {
+			I rewinding = flag(a.is_rewinding[p] + i);
+			if (!L::any(rewinding)) continue;
+
+			F passed = L::loadf(a.seconds_passed[p] + i);
+			F offset_before = L::loadf(a.rewind_offset[p] + i);
+			I first = L::loadi(a.log_first[p] + i);
+			I count = L::loadi(a.log_count[p] + i);
+
+			//'rewind_speed' entries further back: 'skip' entries are passed entirely, then
+			//playback blends 'offset' of the way from the new front entry to the next older one;
+			//running out of entries or time stops the rewind:
+			F position = L::add(offset_before, L::setf(pr.rewind_speed));
+			I skip = L::truncate(position);
+			F offset = L::sub(position, L::tofloat(skip));
+			I between = L::lt(L::setf(0.0f), offset);
+			I in_time = L::and_(rewinding, L::lt(passed, L::setf(pr.max_rewind)));
+			I plays = L::and_(in_time, L::igt(count, L::iadd(skip, L::and_(between, L::seti(1)))));
+			I stop = L::andnot_(rewinding, plays);
+			I pops = L::select(plays, skip, L::seti(0));
+
+			I slot = L::iadd(first, skip);
+			slot = L::select(L::ilt(slot, capacity), slot, L::isub(slot, capacity));
+			I older_slot = L::iadd(slot, L::seti(1));
+			older_slot = L::select(L::ilt(older_slot, capacity), older_slot, L::isub(older_slot, capacity));
+			I at = L::iadd(L::loadi(a.log_base + i), L::shl2(slot));
+			I older_at = L::iadd(L::loadi(a.log_base + i), L::shl2(older_slot));
+
+			F blended[3];
+			for (int c = 0; c < 3; ++c) {
+				F newer = L::gather(a.log[p], L::iadd(at, L::seti(c)));
+				F older = L::gather(a.log[p], L::iadd(older_at, L::seti(c)));
+				blended[c] = L::selectf(between, L::add(newer, L::mul(L::sub(older, newer), offset)), newer);
+			}
+			F attacking = L::selectf(L::lt(offset, L::setf(0.5f)), L::gather(a.log[p], L::iadd(at, L::seti(3))), L::gather(a.log[p], L::iadd(older_at, L::seti(3))));
+
+			L::storef(a.head_x[p] + i, L::selectf(plays, blended[0], L::loadf(a.head_x[p] + i)));
+			L::storef(a.head_y[p] + i, L::selectf(plays, blended[1], L::loadf(a.head_y[p] + i)));
+			L::storef(a.angle[p] + i, L::selectf(plays, blended[2], L::loadf(a.angle[p] + i)));
+			L::storei(a.is_attacking[p] + i, L::select(plays, L::truncate(attacking), L::loadi(a.is_attacking[p] + i)));
+
+			passed = L::selectf(plays, L::add(passed, L::setf(pr.rewind_speed * pr.elapsed)), L::selectf(stop, L::setf(0.0f), passed));
+			L::storef(a.seconds_passed[p] + i, passed);
+			L::storef(a.rewind_offset[p] + i, L::selectf(plays, offset, L::selectf(stop, L::setf(0.0f), offset_before)));
+
+			first = L::iadd(first, pops);
+			first = L::select(L::ilt(first, capacity), first, L::isub(first, capacity));
+			L::storei(a.log_first[p] + i, first);
+			L::storei(a.log_count[p] + i, L::isub(count, pops));
+
+			store_flag(a.is_rewinding[p] + i, L::andnot_(rewinding, stop));
+			store_flag(a.is_cooling[p] + i, L::or_(flag(a.is_cooling[p] + i), stop));
+		}
+	}
+
+	//Time rifts and sword hits; sets round_over for matches that need a new round:
+	static void resolve(BatchArrays const &a) {
+		BatchParams const &pr = a.params;
+		for (size_t i = 0; i < a.count; i += L::N) {
+			F x0 = L::loadf(a.head_x[0] + i);
+			F y0 = L::loadf(a.head_y[0] + i);
+			F x1 = L::loadf(a.head_x[1] + i);
+			F y1 = L::loadf(a.head_y[1] + i);
+			I rewinding0 = flag(a.is_rewinding[0] + i);
+			I rewinding1 = flag(a.is_rewinding[1] + i);
+
+			//the rewinding player loses if they overlap the other one:
+			I overlap = L::le(L::absf(L::sub(x0, x1)), L::setf(pr.overlap_dist));
+			I rift0 = L::and_(rewinding0, overlap);
+			I rift1 = L::andnot_(L::and_(rewinding1, overlap), rewinding0);
+			I rift = L::or_(rift0, rift1);
+
+			//sword tips against the other player's head and torso:
+			F tip_x, tip_y;
+			sword_tip(pr, 0, x0, y0, L::loadf(a.angle[0] + i), &tip_x, &tip_y);
+			I hit_head = L::and_(L::le(L::sub(x1, L::setf(pr.head_radius_x)), tip_x), L::le(tip_y, L::add(y1, L::setf(pr.head_radius_y))));
+			I hit_torso = L::and_(L::le(L::sub(x1, L::setf(pr.torso_radius_x)), tip_x), L::le(tip_y, L::add(L::sub(y1, L::setf(1.50f)), L::setf(pr.torso_radius_y))));
+			I wins0 = L::andnot_(L::and_(flag(a.is_attacking[0] + i), L::or_(hit_head, hit_torso)), rift);
+
+			sword_tip(pr, 1, x1, y1, L::loadf(a.angle[1] + i), &tip_x, &tip_y);
+			hit_head = L::and_(L::le(tip_x, L::add(x0, L::setf(pr.head_radius_x))), L::le(tip_y, L::add(y0, L::setf(pr.head_radius_y))));
+			hit_torso = L::and_(L::le(tip_x, L::add(x0, L::setf(pr.torso_radius_x))), L::le(tip_y, L::add(L::sub(y0, L::setf(1.50f)), L::setf(pr.torso_radius_y))));
+			I wins1 = L::andnot_(L::and_(flag(a.is_attacking[1] + i), L::or_(hit_head, hit_torso)), rift);
+
+			I left = L::and_(L::or_(rift1, wins0), L::seti(1));
+			I right = L::and_(L::or_(rift0, wins1), L::seti(1));
+			L::storei((int32_t *)a.left_score + i, L::iadd(L::loadi((int32_t *)a.left_score + i), left));
+			L::storei((int32_t *)a.right_score + i, L::iadd(L::loadi((int32_t *)a.right_score + i), right));
+			store_flag(a.round_over + i, L::or_(rift, L::or_(wins0, wins1)));
+		}
+	}
+
+	//player_info::reset() for both players where round_over is set:
+	static void reset(BatchArrays const &a) {
+		BatchParams const &pr = a.params;
+		for (size_t i = 0; i < a.count; i += L::N) {
+			I over = flag(a.round_over + i);
+			if (!L::any(over)) continue;
+			for (int p = 0; p < 2; ++p) {
+				L::storef(a.head_x[p] + i, L::selectf(over, L::setf(pr.init_x[p]), L::loadf(a.head_x[p] + i)));
+				L::storef(a.head_y[p] + i, L::selectf(over, L::setf(pr.init_y[p]), L::loadf(a.head_y[p] + i)));
+				L::storef(a.angle[p] + i, L::selectf(over, L::setf(p == 0 ? -60.0f : 60.0f), L::loadf(a.angle[p] + i)));
+				L::storef(a.seconds_passed[p] + i, L::selectf(over, L::setf(0.0f), L::loadf(a.seconds_passed[p] + i)));
+				L::storef(a.rewind_offset[p] + i, L::selectf(over, L::setf(0.0f), L::loadf(a.rewind_offset[p] + i)));
+				L::storef(a.seconds_cooldown[p] + i, L::selectf(over, L::setf(0.0f), L::loadf(a.seconds_cooldown[p] + i)));
+				L::storei(a.is_attacking[p] + i, L::select(over, L::seti(0), L::loadi(a.is_attacking[p] + i)));
+				L::storei(a.is_rewinding[p] + i, L::select(over, L::seti(0), L::loadi(a.is_rewinding[p] + i)));
+				L::storei(a.is_cooling[p] + i, L::select(over, L::seti(0), L::loadi(a.is_cooling[p] + i)));
+				L::storei(a.log_first[p] + i, L::select(over, L::seti(0), L::loadi(a.log_first[p] + i)));
+				L::storei(a.log_count[p] + i, L::select(over, L::seti(0), L::loadi(a.log_count[p] + i)));
+			}
+			L::storei((int32_t *)a.round + i, L::isub(L::loadi((int32_t *)a.round + i), over));
+		}
+	}
+
+	static BatchKernels const *kernels(char const *name) {
+		static BatchKernels const ret = {
+			name, input, swing, move, log, rewind, resolve, reset
+		};
+		return &ret;
+	}
+};
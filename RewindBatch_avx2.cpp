@@ -0,0 +1,101 @@
+//AVX2 kernels for RewindBatch (eight matches per instruction).
+// This file is compiled with AVX2 enabled (see AVX2_FLAGS in the Jamfile), so
+// nothing in it may run before batch_kernels_avx2() has checked the CPU.
+
+#include "RewindBatchKernels.hpp"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace {
+
+struct LanesAVX2 {
+	enum { N = 8 };
+	typedef __m256 F;
+	typedef __m256i I;
+	struct D { __m256d lo, hi; };
+
+	static F loadf(float const *at) { return _mm256_loadu_ps(at); }
+	static void storef(float *at, F v) { _mm256_storeu_ps(at, v); }
+	static F setf(float v) { return _mm256_set1_ps(v); }
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F absf(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static I lt(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+	static I le(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+	static I eq(F a, F b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+	static F selectf(I m, F a, F b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(m)); }
+	static F tofloat(I a) { return _mm256_cvtepi32_ps(a); }
+	static I truncate(F a) { return _mm256_cvttps_epi32(a); }
+
+	static I loadi(int32_t const *at) { return _mm256_loadu_si256((__m256i const *)at); }
+	static void storei(int32_t *at, I v) { _mm256_storeu_si256((__m256i *)at, v); }
+	static I seti(int32_t v) { return _mm256_set1_epi32(v); }
+	static I load_u8(uint8_t const *at) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *)at)); }
+	static I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+	static I isub(I a, I b) { return _mm256_sub_epi32(a, b); }
+	static I shl2(I a) { return _mm256_slli_epi32(a, 2); }
+	static I ieq(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+	static I igt(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+	static I ilt(I a, I b) { return _mm256_cmpgt_epi32(b, a); }
+	static I and_(I a, I b) { return _mm256_and_si256(a, b); }
+	static I or_(I a, I b) { return _mm256_or_si256(a, b); }
+	static I andnot_(I a, I b) { return _mm256_andnot_si256(b, a); }
+	static I not_(I a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+	static I select(I m, I a, I b) { return _mm256_blendv_epi8(b, a, m); }
+	static bool any(I m) { return _mm256_movemask_epi8(m) != 0; }
+
+	static F gather(float const *base, I index) { return _mm256_i32gather_ps(base, index, 4); }
+	//(AVX2 has no scatter)
+	static void scatter(float *base, I index, F v, I m) {
+		alignas(32) int32_t at[8];
+		alignas(32) float val[8];
+		_mm256_store_si256((__m256i *)at, index);
+		_mm256_store_ps(val, v);
+		int bits = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+		for (int l = 0; l < 8; ++l) {
+			if (bits & (1 << l)) base[at[l]] = val[l];
+		}
+	}
+
+	static D setd(double v) { D r; r.lo = r.hi = _mm256_set1_pd(v); return r; }
+	static D loadd(double const *at) { D r; r.lo = _mm256_loadu_pd(at); r.hi = _mm256_loadu_pd(at + 4); return r; }
+	//(the masked form, since GCC warns that the plain one's undefined starting value "may be used uninitialized")
+	static D gatherd(double const *base, I index) {
+		__m256d zero = _mm256_setzero_pd(), all = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+		D r;
+		r.lo = _mm256_mask_i32gather_pd(zero, base, _mm256_castsi256_si128(index), all, 8);
+		r.hi = _mm256_mask_i32gather_pd(zero, base, _mm256_extracti128_si256(index, 1), all, 8);
+		return r;
+	}
+	//(explicit mul and add -- never fused -- to match the scalar rounding)
+	static D dadd(D a, D b) { D r; r.lo = _mm256_add_pd(a.lo, b.lo); r.hi = _mm256_add_pd(a.hi, b.hi); return r; }
+	static D dsub(D a, D b) { D r; r.lo = _mm256_sub_pd(a.lo, b.lo); r.hi = _mm256_sub_pd(a.hi, b.hi); return r; }
+	static D dmul(D a, D b) { D r; r.lo = _mm256_mul_pd(a.lo, b.lo); r.hi = _mm256_mul_pd(a.hi, b.hi); return r; }
+	static D widen(F a) {
+		D r;
+		r.lo = _mm256_cvtps_pd(_mm256_castps256_ps128(a));
+		r.hi = _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1));
+		return r;
+	}
+	static F narrow(D a) {
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(a.lo)), _mm256_cvtpd_ps(a.hi), 1);
+	}
+};
+
+}
+
+//(batch_kernels_avx2() in RewindBatch.cpp checks the CPU before calling this)
+BatchKernels const *batch_kernels_avx2_unchecked() {
+	return BatchKernelsT< LanesAVX2 >::kernels("avx2");
+}
+
+#else
+
+BatchKernels const *batch_kernels_avx2_unchecked() {
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,104 @@
+//SSE2 kernels for RewindBatch (four matches per instruction).
+
+#include "RewindBatchKernels.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+#include <cstring>
+
+namespace {
+
+struct LanesSSE {
+	enum { N = 4 };
+	typedef __m128 F;
+	typedef __m128i I;
+	struct D { __m128d lo, hi; };
+
+	static F loadf(float const *at) { return _mm_loadu_ps(at); }
+	static void storef(float *at, F v) { _mm_storeu_ps(at, v); }
+	static F setf(float v) { return _mm_set1_ps(v); }
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F absf(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static I lt(F a, F b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+	static I le(F a, F b) { return _mm_castps_si128(_mm_cmple_ps(a, b)); }
+	static I eq(F a, F b) { return _mm_castps_si128(_mm_cmpeq_ps(a, b)); }
+	static F selectf(I m, F a, F b) {
+		F mf = _mm_castsi128_ps(m);
+		return _mm_or_ps(_mm_and_ps(mf, a), _mm_andnot_ps(mf, b));
+	}
+	static F tofloat(I a) { return _mm_cvtepi32_ps(a); }
+	static I truncate(F a) { return _mm_cvttps_epi32(a); }
+
+	static I loadi(int32_t const *at) { return _mm_loadu_si128((__m128i const *)at); }
+	static void storei(int32_t *at, I v) { _mm_storeu_si128((__m128i *)at, v); }
+	static I seti(int32_t v) { return _mm_set1_epi32(v); }
+	static I load_u8(uint8_t const *at) {
+		int32_t bytes;
+		std::memcpy(&bytes, at, 4);
+		__m128i zero = _mm_setzero_si128();
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+	}
+	static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+	static I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+	static I shl2(I a) { return _mm_slli_epi32(a, 2); }
+	static I ieq(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+	static I igt(I a, I b) { return _mm_cmpgt_epi32(a, b); }
+	static I ilt(I a, I b) { return _mm_cmplt_epi32(a, b); }
+	static I and_(I a, I b) { return _mm_and_si128(a, b); }
+	static I or_(I a, I b) { return _mm_or_si128(a, b); }
+	static I andnot_(I a, I b) { return _mm_andnot_si128(b, a); }
+	static I not_(I a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+	static I select(I m, I a, I b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+	static bool any(I m) { return _mm_movemask_epi8(m) != 0; }
+
+	//SSE2 has no gather/scatter, so go through memory:
+	static F gather(float const *base, I index) {
+		alignas(16) int32_t at[4];
+		_mm_store_si128((__m128i *)at, index);
+		return _mm_setr_ps(base[at[0]], base[at[1]], base[at[2]], base[at[3]]);
+	}
+	static void scatter(float *base, I index, F v, I m) {
+		alignas(16) int32_t at[4];
+		alignas(16) float val[4];
+		_mm_store_si128((__m128i *)at, index);
+		_mm_store_ps(val, v);
+		int bits = _mm_movemask_ps(_mm_castsi128_ps(m));
+		for (int l = 0; l < 4; ++l) {
+			if (bits & (1 << l)) base[at[l]] = val[l];
+		}
+	}
+
+	static D setd(double v) { D r; r.lo = r.hi = _mm_set1_pd(v); return r; }
+	static D loadd(double const *at) { D r; r.lo = _mm_loadu_pd(at); r.hi = _mm_loadu_pd(at + 2); return r; }
+	static D gatherd(double const *base, I index) {
+		alignas(16) int32_t at[4];
+		_mm_store_si128((__m128i *)at, index);
+		D r;
+		r.lo = _mm_setr_pd(base[at[0]], base[at[1]]);
+		r.hi = _mm_setr_pd(base[at[2]], base[at[3]]);
+		return r;
+	}
+	static D dadd(D a, D b) { D r; r.lo = _mm_add_pd(a.lo, b.lo); r.hi = _mm_add_pd(a.hi, b.hi); return r; }
+	static D dsub(D a, D b) { D r; r.lo = _mm_sub_pd(a.lo, b.lo); r.hi = _mm_sub_pd(a.hi, b.hi); return r; }
+	static D dmul(D a, D b) { D r; r.lo = _mm_mul_pd(a.lo, b.lo); r.hi = _mm_mul_pd(a.hi, b.hi); return r; }
+	static D widen(F a) { D r; r.lo = _mm_cvtps_pd(a); r.hi = _mm_cvtps_pd(_mm_movehl_ps(a, a)); return r; }
+	static F narrow(D a) { return _mm_movelh_ps(_mm_cvtpd_ps(a.lo), _mm_cvtpd_ps(a.hi)); }
+};
+
+}
+
+BatchKernels const *batch_kernels_sse() {
+	return BatchKernelsT< LanesSSE >::kernels("sse2");
+}
+
+#else
+
+BatchKernels const *batch_kernels_sse() {
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+//Gameplay constants and input bits, kept free of includes so that they can
+//be used anywhere (including the batch kernels, which avoid glm).
+//The rules constants below are defaults: matches read them from RewindParams,
+//which can be changed at run time (see RewindSim::params).
+
+#define RIGHT 1
+#define LEFT 2
+#define PLAYER_ONE 1
+#define PLAYER_TWO 2
+#define MAX_DIST 1.25f
+#define OVERLAP_DIST 1.0f
+#define ATTACK_SPEED 10.0f
+#define ATTACK_COOLDOWN 1.75f
+#define REWIND_SPEED 3.0f //Seconds of history played back per second of rewinding (the default; any positive factor works)
+#define WALK_SPEED 0.15f
+#define MAX_REWIND 4.5f //Seconds of history a rewind can go back (1.5 seconds of rewinding at REWIND_SPEED)
+#define REWIND_COOLDOWN 6.0f
+#define TICK_RATE 60.0f //Default ticks per second; WALK_SPEED, ATTACK_SPEED and ATTACK_COOLDOWN are per tick at this rate
+
+//The rules constants of a match (defaults as above):
+struct RewindParams {
+	float walk_speed = WALK_SPEED; //distance walked per tick (at TICK_RATE)
+	float attack_speed = ATTACK_SPEED; //degrees the sword swings per tick (at TICK_RATE)
+	float attack_cooldown = ATTACK_COOLDOWN; //degrees the sword moves back per tick after a swing (at TICK_RATE)
+	float rewind_speed = REWIND_SPEED; //seconds of history played back per second of rewinding
+	float max_rewind = MAX_REWIND; //seconds of history a rewind can go back
+	float rewind_cooldown = REWIND_COOLDOWN; //seconds after a rewind before the next
+	float max_dist = MAX_DIST; //closest two players can walk to each other
+	float overlap_dist = OVERLAP_DIST; //a rewinding player this close to the other causes a time rift (and loses)
+};
+
+//Per-tick input for one player, as a bitset of held buttons:
+#define INPUT_LEFT 0x1
+#define INPUT_RIGHT 0x2
+#define INPUT_ATTACK 0x4
+#define INPUT_REWIND 0x8
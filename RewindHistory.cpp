@@ -0,0 +1,313 @@
+#include "RewindHistory.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+typedef RewindHistory::Quantized Quantized;
+typedef RewindHistory::Block Block;
+
+uint8_t const TAG_RUN = 0x00;
+uint8_t const TAG_NUDGE = 0x40;
+uint8_t const TAG_SMALL = 0x80;
+uint8_t const TAG_DELTA = 0xc0;
+uint8_t const TAG_KIND = 0xc0;
+uint32_t const RUN_MAX = 64;
+int32_t const NUDGE_MIN = -32;
+int32_t const NUDGE_MAX = 31;
+
+inline Quantized quantize(glm::vec4 const &entry) {
+	Quantized q;
+	q.x = int32_t(std::lround(entry.x * HISTORY_POSITION_STEPS));
+	q.y = int32_t(std::lround(entry.y * HISTORY_POSITION_STEPS));
+	q.angle = int16_t(std::lround(entry.z * HISTORY_ANGLE_STEPS));
+	q.attacking = (entry.w != 0.0f ? 1 : 0);
+	q.padding = 0;
+	return q;
+}
+
+inline glm::vec4 dequantize(Quantized const &q) {
+	return glm::vec4(q.x / HISTORY_POSITION_STEPS, q.y / HISTORY_POSITION_STEPS, q.angle / HISTORY_ANGLE_STEPS, float(q.attacking));
+}
+
+inline Quantized zero() {
+	Quantized q;
+	q.x = q.y = 0;
+	q.angle = 0;
+	q.attacking = 0;
+	q.padding = 0;
+	return q;
+}
+
+inline void add(Quantized *to, Quantized const &d) {
+	to->x += d.x;
+	to->y += d.y;
+	to->angle = int16_t(to->angle + d.angle);
+}
+inline void subtract(Quantized *from, Quantized const &d) {
+	from->x -= d.x;
+	from->y -= d.y;
+	from->angle = int16_t(from->angle - d.angle);
+}
+
+inline uint32_t record_size(uint8_t tag) {
+	uint8_t kind = tag & TAG_KIND;
+	return kind == TAG_SMALL ? 4 : (kind == TAG_DELTA ? 11 : 1);
+}
+
+//Delta records set 'repeat' (and the attacking flag); nudges adjust it; runs don't change it:
+inline bool is_delta(uint8_t tag) {
+	return (tag & TAG_SMALL) != 0;
+}
+
+//x offset of a nudge record's entry:
+inline int32_t nudge(uint8_t tag) {
+	return int32_t(tag & 0x3f) - ((tag & 0x20) ? 64 : 0);
+}
+//...and the change it makes to 'repeat' x afterward:
+inline int32_t steer(uint8_t tag) {
+	int32_t n = nudge(tag);
+	return (n > 0) - (n < 0);
+}
+
+inline uint32_t read_u32(uint8_t const *at) {
+	return uint32_t(at[0]) | (uint32_t(at[1]) << 8) | (uint32_t(at[2]) << 16) | (uint32_t(at[3]) << 24);
+}
+inline uint16_t read_u16(uint8_t const *at) {
+	return uint16_t(at[0] | (at[1] << 8));
+}
+
+//Difference stored in the delta record that ends just before 'end':
+inline Quantized read_delta(uint8_t const *end) {
+	uint8_t tag = end[-1];
+	Quantized d = zero();
+	if ((tag & TAG_KIND) == TAG_SMALL) {
+		d.x = int16_t(read_u16(end - 4));
+		d.angle = int8_t(end[-2]);
+	} else {
+		d.x = int32_t(read_u32(end - 11));
+		d.y = int32_t(read_u32(end - 7));
+		d.angle = int16_t(read_u16(end - 3));
+	}
+	return d;
+}
+
+//Sets 'repeat' and the newest entry's attacking flag from the newest delta record
+// (or the key, if none) and the nudges since:
+void restore_repeat(Block *block) {
+	int32_t nudged = 0;
+	uint32_t at = block->used;
+	while (at > 0) {
+		uint8_t tag = block->records[at - 1];
+		if (!is_delta(tag)) {
+			if ((tag & TAG_KIND) == TAG_NUDGE) nudged += steer(tag);
+			at -= 1;
+			continue;
+		}
+		block->repeat = read_delta(block->records + at);
+		block->repeat.x += nudged;
+		block->last.attacking = tag & 1;
+		return;
+	}
+	block->repeat = zero();
+	block->repeat.x = nudged;
+	block->last.attacking = block->key.attacking;
+}
+
+//Calls 'emit' with each of a block's entries, newest first (the key last), until it returns false:
+template< typename Emit >
+void unpack(Block const &block, Emit const &emit) {
+	//Find where each record ends (reading back from the newest), then work out
+	// the difference and attacking flag in effect for each (from the oldest):
+	uint32_t ends[HISTORY_BLOCK_BYTES];
+	uint32_t records = 0;
+	for (uint32_t at = block.used; at > 0; at -= record_size(block.records[at - 1])) {
+		ends[records++] = at;
+	}
+	Quantized repeats[HISTORY_BLOCK_BYTES];
+	uint8_t attacking[HISTORY_BLOCK_BYTES];
+	Quantized repeat = zero();
+	uint8_t flag = block.key.attacking;
+	for (uint32_t r = records; r > 0; --r) {
+		uint8_t tag = block.records[ends[r - 1] - 1];
+		if (is_delta(tag)) {
+			repeat = read_delta(block.records + ends[r - 1]);
+			flag = tag & 1;
+		}
+		repeats[r - 1] = repeat;
+		attacking[r - 1] = flag;
+		if ((tag & TAG_KIND) == TAG_NUDGE) repeat.x += steer(tag);
+	}
+
+	//Then step back from the newest entry:
+	Quantized entry = block.last;
+	for (uint32_t r = 0; r < records; ++r) {
+		uint8_t tag = block.records[ends[r] - 1];
+		uint32_t steps = ((tag & TAG_KIND) == TAG_RUN ? (tag & 0x3fu) + 1u : 1u);
+		entry.attacking = attacking[r];
+		for (uint32_t s = 0; s < steps; ++s) {
+			if (!emit(dequantize(entry))) return;
+			subtract(&entry, repeats[r]);
+		}
+		if ((tag & TAG_KIND) == TAG_NUDGE) entry.x -= nudge(tag);
+	}
+	emit(dequantize(block.key));
+}
+
+}
+
+RewindHistory::RewindHistory(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {
+}
+
+void RewindHistory::push_front(glm::vec4 const &entry) {
+	Quantized q = quantize(entry);
+
+	count += 1;
+
+	if (!blocks.empty()) {
+		Block &block = blocks.back();
+
+		//Does repeating the latest difference land (close enough to) here?
+		Quantized predicted = block.last;
+		add(&predicted, block.repeat);
+		int32_t off = q.x - predicted.x;
+		if (predicted.y == q.y && predicted.angle == q.angle && q.attacking == block.last.attacking) {
+			if (off >= -HISTORY_POSITION_TOLERANCE && off <= HISTORY_POSITION_TOLERANCE) {
+				uint8_t *tag = (block.used > 0 ? &block.records[block.used - 1] : nullptr);
+				if (tag && (*tag & TAG_KIND) == TAG_RUN && (*tag & 0x3fu) + 1u < RUN_MAX) {
+					*tag += 1;
+					block.last = predicted;
+					block.entries += 1;
+					return;
+				} else if (block.used + 1 <= HISTORY_BLOCK_BYTES) {
+					block.records[block.used++] = TAG_RUN;
+					block.last = predicted;
+					block.entries += 1;
+					return;
+				}
+			} else if (off >= NUDGE_MIN && off <= NUDGE_MAX && block.used + 1 <= HISTORY_BLOCK_BYTES) {
+				//back on track, and steer the repeated difference a step the same way (so drift builds up slower):
+				block.records[block.used++] = uint8_t(TAG_NUDGE | (uint32_t(off) & 0x3f));
+				block.repeat.x += (off > 0) - (off < 0);
+				block.last = q;
+				block.entries += 1;
+				return;
+			}
+		}
+
+		//Otherwise, store the difference:
+		Quantized d = q;
+		subtract(&d, block.last);
+		if (d.y == 0 && d.x >= -32768 && d.x <= 32767 && d.angle >= -128 && d.angle <= 127
+		 && block.used + 4 <= HISTORY_BLOCK_BYTES) {
+			uint8_t *r = block.records + block.used;
+			r[0] = uint8_t(uint32_t(d.x));
+			r[1] = uint8_t(uint32_t(d.x) >> 8);
+			r[2] = uint8_t(int8_t(d.angle));
+			r[3] = TAG_SMALL | q.attacking;
+			block.used += 4;
+			block.last = q;
+			block.repeat = d;
+			block.entries += 1;
+			return;
+		} else if (block.used + 11 <= HISTORY_BLOCK_BYTES) {
+			uint8_t *r = block.records + block.used;
+			for (uint32_t i = 0; i < 4; ++i) r[i] = uint8_t(uint32_t(d.x) >> (8 * i));
+			for (uint32_t i = 0; i < 4; ++i) r[4 + i] = uint8_t(uint32_t(d.y) >> (8 * i));
+			r[8] = uint8_t(uint16_t(d.angle));
+			r[9] = uint8_t(uint16_t(d.angle) >> 8);
+			r[10] = TAG_DELTA | q.attacking;
+			block.used += 11;
+			block.last = q;
+			block.repeat = d;
+			block.entries += 1;
+			return;
+		}
+	}
+
+	//Start a new block, with this entry as its key:
+	blocks.emplace_back();
+	Block &block = blocks.back();
+	block.key = q;
+	block.last = q;
+	block.repeat = zero();
+	block.entries = 1;
+	block.used = 0;
+	block.padding = 0;
+
+	//Drop old blocks that aren't needed any more:
+	while (blocks.size() > 1 && count - blocks.front().entries >= capacity_) {
+		count -= blocks.front().entries;
+		blocks.pop_front();
+	}
+}
+
+void RewindHistory::pop_front() {
+	assert(count > 0);
+	count -= 1;
+
+	Block &block = blocks.back();
+	if (block.used == 0) { //(just the key; the block before ends with the new newest entry)
+		blocks.pop_back();
+		return;
+	}
+
+	block.entries -= 1;
+	uint8_t tag = block.records[block.used - 1];
+	if ((tag & TAG_KIND) == TAG_RUN) {
+		subtract(&block.last, block.repeat);
+		if (tag == TAG_RUN) block.used -= 1;
+		else block.records[block.used - 1] = tag - 1;
+	} else if ((tag & TAG_KIND) == TAG_NUDGE) {
+		block.repeat.x -= steer(tag);
+		subtract(&block.last, block.repeat);
+		block.last.x -= nudge(tag);
+		block.used -= 1;
+	} else {
+		subtract(&block.last, read_delta(block.records + block.used));
+		block.used -= record_size(tag);
+		restore_repeat(&block);
+	}
+}
+
+glm::vec4 RewindHistory::front() const {
+	assert(count > 0);
+	return dequantize(blocks.back().last);
+}
+
+glm::vec4 RewindHistory::operator[](size_t i) const {
+	assert(i < count);
+	glm::vec4 found(0.0f);
+	for (auto b = blocks.rbegin(); b != blocks.rend(); ++b) {
+		if (i >= b->entries) {
+			i -= b->entries;
+			continue;
+		}
+		unpack(*b, [&](glm::vec4 const &entry){
+			if (i == 0) {
+				found = entry;
+				return false;
+			}
+			i -= 1;
+			return true;
+		});
+		break;
+	}
+	return found;
+}
+
+void RewindHistory::copy_to(glm::vec4 *out) const {
+	for (auto b = blocks.rbegin(); b != blocks.rend(); ++b) {
+		unpack(*b, [&](glm::vec4 const &entry){
+			*(out++) = entry;
+			return true;
+		});
+	}
+}
+
+void RewindHistory::clear() {
+	blocks.clear();
+	count = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+//Compressed rewind log, for rewind windows far longer than MAX_REWIND.
+// Holds the same entries as player_info::rewind_log (head x, head y, sword
+// arm angle, attacking), newest first, with the same push_front / pop_front /
+// front / [] interface, so update_rewind() can step back through it.
+//
+// Entries are quantized (positions to 1/HISTORY_POSITION_STEPS, angles to
+// 1/HISTORY_ANGLE_STEPS of a degree) and stored in 128-byte blocks. Each block
+// starts with a keyframe (its first entry, in full); later entries are stored
+// as deltas from the entry before, and runs of entries that repeat the latest
+// delta -- standing still, walking, or swinging at a steady speed -- as a
+// single byte per 64 entries. Stored positions may be up to
+// HISTORY_POSITION_TOLERANCE steps off (with a one-byte nudge back on track,
+// which also steers the repeated delta, when they drift further); angles and the attacking flag are exact (in
+// steps), so a sword at rest stays exactly at rest.
+//
+// push_front and pop_front are O(1) (amortized). When the history is over
+// capacity, whole blocks are dropped from the oldest end, so it always holds
+// at least the newest 'capacity' entries (and a block's worth more, at most).
+
+#include <glm/glm.hpp>
+
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+#define HISTORY_POSITION_STEPS 4096.0f //per unit
+#define HISTORY_POSITION_TOLERANCE 16 //steps (1/256 of a unit)
+#define HISTORY_ANGLE_STEPS 8.0f //per degree
+#define HISTORY_BLOCK_BYTES 88 //bytes of records per block
+
+struct RewindHistory {
+	RewindHistory(size_t capacity = 1);
+
+	//Adds a new entry; drops the oldest block once it is no longer needed to hold 'capacity' entries:
+	void push_front(glm::vec4 const &entry);
+	//Removes the newest entry:
+	void pop_front();
+	//Newest entry (as stored, i.e., quantized):
+	glm::vec4 front() const;
+	//i'th newest entry (0 is the same as front()); this unpacks a whole block, so it is meant for the newest few:
+	glm::vec4 operator[](size_t i) const;
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+	size_t capacity() const { return capacity_; }
+
+	//Copies all entries to 'out', newest first ('out' must have room for size() entries):
+	void copy_to(glm::vec4 *out) const;
+
+	//Forgets all entries:
+	void clear();
+
+	//Memory holding entries:
+	size_t bytes_used() const { return blocks.size() * sizeof(Block); }
+
+	//An entry (or the difference between two), in steps:
+	struct Quantized {
+		int32_t x, y;
+		int16_t angle;
+		uint8_t attacking; //(unused in differences)
+		uint8_t padding;
+	};
+	struct Block {
+		Quantized key; //first entry
+		Quantized last; //newest entry
+		Quantized repeat; //difference repeated by run records (that of the newest delta record, plus any nudges since)
+		uint16_t entries; //number of entries, counting the key
+		uint8_t used; //bytes of 'records' in use
+		uint8_t padding;
+		//Records, each ending in a tag byte (so they can be read back newest first):
+		// 00nnnnnn  run: n+1 entries, each 'repeat' past the one before (same attacking flag)
+		// 01nnnnnn  nudge: one entry, 'repeat' plus n (-32..31) in x past the one before; then 'repeat' x moves a step toward n
+		// [dx:s16 dangle:s8] 1000000a  small delta (dy is 0), then attacking = a
+		// [dx:s32 dy:s32 dangle:s16] 1100000a  delta, then attacking = a
+		uint8_t records[HISTORY_BLOCK_BYTES];
+	};
+	static_assert(sizeof(Block) == 128, "history blocks should be two cache lines");
+
+	std::deque< Block > blocks; //oldest first
+	size_t count = 0;
+	size_t capacity_;
+};
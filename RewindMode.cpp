@@ -1,4 +1,6 @@
 #include "RewindMode.hpp"
+#include "DegreeTrig.hpp"
+#include "PhaseTimers.hpp"
 
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
@@ -6,159 +8,30 @@
 //for glm::value_ptr() :
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <random>
 
-//Returns sin(angle) in degrees.
-double get_sin(float angle) 
-{
-	double pi = 3.14159265;
-	return sin(angle * pi / 180);
-}
-
-//Returns cos(angle) in degrees.
-double get_cos(float angle)
-{
-	double pi = 3.14159265;
-	return cos(angle * pi / 180);
-}
-
-//Calculates the vertices of the sword of the given player.
-//Note that the sword is basically a triangle.
-void get_sword_points(player_info& player, float sword_tip_length, glm::vec2 points[]) {
-	double sin_angle;
-	double cos_angle;
-	glm::vec2 pos_1;
-	glm::vec2 pos_2;
-	glm::vec2 pos_3;
-
-	if (player.sword_arm == PLAYER_ONE) { //Left player
-
-		sin_angle = get_sin(player.right_arm_angle);
-		cos_angle = get_cos(player.right_arm_angle);
-
-		pos_1 = glm::vec2(player.right_arm.x + player.right_arm_radius.x * cos_angle,
-						  player.right_arm.y - player.right_arm_radius.x * sin_angle);
-		pos_2 = glm::vec2(pos_1.x + sword_tip_length * cos_angle, pos_1.y - sword_tip_length * sin_angle);
-		pos_3 = glm::vec2(player.right_arm.x + player.right_arm_radius.x * cos_angle,
-						  player.right_arm.y - player.right_arm_radius.x * sin_angle - player.right_arm_radius.y);
-	}
-	else if (player.sword_arm == PLAYER_TWO) { //Right player
-
-		sin_angle = get_sin(player.left_arm_angle);
-		cos_angle = get_cos(player.left_arm_angle);
-
-		pos_1 = glm::vec2(player.left_arm.x + player.left_arm_radius.x * cos_angle,
-						  player.left_arm.y - player.left_arm_radius.x * sin_angle);
-		pos_2 = glm::vec2(pos_1.x - sword_tip_length * cos_angle, pos_1.y + sword_tip_length * sin_angle);
-		pos_3 = glm::vec2(player.left_arm.x + player.left_arm_radius.x * cos_angle,
-						  player.left_arm.y - player.left_arm_radius.x * sin_angle - player.left_arm_radius.y);
-	}
-
-	points[0] = pos_1;
-	points[1] = pos_2;
-	points[2] = pos_3;
-}
-
-//When a player is rewinding time, this function checks whether
-//time's up (lol) and determines their new position/state.
-void update_rewind(player_info& player, float elapsed) {
-
-	int skipped = 0;
-
-	//The way I boost the speed of the player while they're rewinding time is by
-	//dropping past coordinates and moving on to the next; that's exactly what 
-	//I do in this loop
-	while (skipped < REWIND_SPEEDUP) {
-		if (!player.rewind_log.empty() && player.seconds_passed < MAX_REWIND) {
-			player.rewind_log.pop_front();
-		} else {
-			player.is_rewinding = 0;
-			player.is_cooling = 1;
-			player.seconds_passed = 0;
-			player.update_colors(2);
-			return;
-		}
-		skipped += 1;
-	}
-
-	if (!player.rewind_log.empty()) {
-			glm::vec4 past_info = player.rewind_log.front();
-			player.update_coords(glm::vec2(past_info.x, past_info.y));
-			if (player.sword_arm == PLAYER_ONE) {
-				player.right_arm_angle = past_info.z;
-			} else {
-				player.left_arm_angle = past_info.z;
-			}
-			player.is_attacking = (int)past_info.w;
-			player.seconds_passed += elapsed;
-			player.rewind_log.pop_front();
-	} else {
-			player.is_rewinding = 0;
-			player.is_cooling = 1;
-			player.seconds_passed = 0;
-			player.update_colors(2);
-	}
-}
-
-//Determines the player's (not the other player!) new position, and ensures 
-//that the two players don't collide with each other - there's an invisble
-//wall seperating them. Also makes sure that the players can't go through the
-//walls of the arena.
-void update_movements(int right_or_left, int one_or_two, player_info& player,
-					  player_info& other_player, glm::vec2 court_radius, float sword_tip_length) {
-	if (one_or_two == PLAYER_ONE) {
-		if (right_or_left == RIGHT) {
-
-			glm::vec2 points[3];
-			get_sword_points(player, sword_tip_length, points);
-			glm::vec2 pos = points[1];
-
-			if (pos.x <= court_radius.x && pos.x >= -court_radius.x &&
-				!(abs(player.head.x - other_player.head.x) <= MAX_DIST)) {
-				player.update_coords(glm::vec2(player.head.x + WALK_SPEED, 0.0f));
-			}
-		}
-
-		else if (right_or_left == LEFT) {
+//how far ',' and '.' jump when watching a replay:
+#define REPLAY_SEEK_SECONDS 5.0f
 
-			double sin_angle = get_sin(player.left_arm_angle);
-			double cos_angle = get_cos(player.left_arm_angle);
-			glm::vec2 pos = glm::vec2(player.left_arm.x + player.left_arm_radius.x * cos_angle,
-									  player.left_arm.y - player.left_arm_radius.x * sin_angle);
+//how far '[' and ']' jump when scrubbing through the timeline:
+#define TIMELINE_SCRUB_SECONDS 1.0f
 
-			if (pos.x <= court_radius.x && pos.x >= -court_radius.x) {
-				player.update_coords(glm::vec2(player.head.x - WALK_SPEED, 0.0f));
-			}
-		}
-	} else if (one_or_two == PLAYER_TWO){
-		if (right_or_left == RIGHT) {
+//how often to print rollback statistics during online play:
+#define ROLLBACK_REPORT_SECONDS 5.0f
 
-			double sin_angle = get_sin(player.right_arm_angle);
-			double cos_angle = get_cos(player.right_arm_angle);
+//longest the arena's computer fighters hold one set of buttons:
+#define ARENA_HOLD_SECONDS 0.5f
 
-			glm::vec2 pos = glm::vec2(player.right_arm.x + player.right_arm_radius.x * cos_angle,
-									  player.right_arm.y - player.right_arm_radius.x * sin_angle);
-
-			if (pos.x <= court_radius.x && pos.x >= -court_radius.x) {
-				player.update_coords(glm::vec2(player.head.x + WALK_SPEED, 0.0f));
-			}
-		}
-
-		else if (right_or_left == LEFT) {
-
-			glm::vec2 points[3];
-			get_sword_points(player, sword_tip_length, points);
-			glm::vec2 pos = points[1];
-
-			if (pos.x <= court_radius.x && pos.x >= -court_radius.x &&
-				!(abs(player.head.x - other_player.head.x) <= MAX_DIST)) {
-				player.update_coords(glm::vec2(player.head.x - WALK_SPEED, 0.0f));
-			}
-		}
+RewindMode::RewindMode(float tick_rate, size_t arena_fighters, RewindParams const &params) : sim(tick_rate, params) {
+	if (arena_fighters) {
+		arena.reset(new RewindArena(arena_fighters, tick_rate, params));
+		holds.assign(arena_fighters, 0);
 	}
-}
-
-RewindMode::RewindMode() {
+	inputs.assign(fighter_count(), 0);
+	remember_poses();
 
 	//----- allocate OpenGL resources -----
 	{ //vertex buffer:
@@ -261,6 +134,23 @@ RewindMode::~RewindMode() {
 	white_tex = 0;
 }
 
+size_t RewindMode::fighter_count() const {
+	if (arena) return arena->fighters.size();
+	return sizeof(sim.fighters) / sizeof(sim.fighters[0]);
+}
+
+player_info &RewindMode::fighter(size_t i) {
+	if (arena) return arena->fighters[i];
+	return *sim.world.get< player_info >(sim.fighters[i]);
+}
+
+void RewindMode::remember_poses() {
+	previous_poses.resize(fighter_count());
+	for (size_t i = 0; i < previous_poses.size(); ++i) {
+		previous_poses[i] = fighter(i).get_pose();
+	}
+}
+
 bool RewindMode::handle_event(SDL_Event const& evt, glm::uvec2 const& window_size) {
 
 	if (evt.type == SDL_MOUSEMOTION) {
@@ -269,269 +159,197 @@ bool RewindMode::handle_event(SDL_Event const& evt, glm::uvec2 const& window_siz
 			(evt.motion.x + 0.5f) / window_size.x * 2.0f - 1.0f,
 			(evt.motion.y + 0.5f) / window_size.y * -2.0f + 1.0f
 		);
-	} else if (evt.type == SDL_KEYDOWN) {
+	} else if (timeline && evt.type == SDL_KEYDOWN && (evt.key.keysym.sym == SDLK_p || (paused && (
+		evt.key.keysym.sym == SDLK_COMMA || evt.key.keysym.sym == SDLK_PERIOD
+		|| evt.key.keysym.sym == SDLK_LEFTBRACKET || evt.key.keysym.sym == SDLK_RIGHTBRACKET
+		|| evt.key.keysym.sym == SDLK_HOME || evt.key.keysym.sym == SDLK_END)))) {
+		//Time-travel debugging:
+		uint32_t to = timeline->tick;
+		uint32_t jump = uint32_t(TIMELINE_SCRUB_SECONDS * sim.tick_rate);
+		if (evt.key.keysym.sym == SDLK_p) {
+			paused = !paused;
+			if (paused) {
+				std::cout << "Paused at tick " << to << "." << std::endl;
+				return true;
+			}
+			if (recording) to = timeline->tick_count(); //(the replay already has the ticks after this one)
+		} else if (evt.key.keysym.sym == SDLK_COMMA) {
+			to = (to > 0 ? to - 1 : 0);
+		} else if (evt.key.keysym.sym == SDLK_PERIOD) {
+			to += 1;
+		} else if (evt.key.keysym.sym == SDLK_LEFTBRACKET) {
+			to = (to > jump ? to - jump : 0);
+		} else if (evt.key.keysym.sym == SDLK_RIGHTBRACKET) {
+			to += jump;
+		} else if (evt.key.keysym.sym == SDLK_HOME) {
+			to = 0;
+		} else if (evt.key.keysym.sym == SDLK_END) {
+			to = timeline->tick_count();
+		}
+		timeline->seek(&sim, to);
+		previous_round = sim.round;
+		remember_poses();
+
+		if (paused) {
+			uint32_t t = timeline->tick;
+			std::cout << "Tick " << t << " of " << timeline->tick_count() << " (round " << sim.round << ", " << sim.left_score << " - " << sim.right_score << ")";
+			if (t < timeline->tick_count()) {
+				std::cout << ", inputs " << int(timeline->player_one_input(t)) << " / " << int(timeline->player_two_input(t));
+			}
+			std::cout << "." << std::endl;
+		} else {
+			if (timeline->tick < timeline->tick_count()) {
+				std::cout << "Resuming from tick " << timeline->tick << " (dropping " << timeline->tick_count() - timeline->tick << " ticks after it)." << std::endl;
+				timeline->truncate(timeline->tick);
+			}
+			if (bot) bot->reset(); //(its search tree is for a match that's gone)
+		}
+		return true;
+	} else if (playback && (evt.type == SDL_KEYDOWN || evt.type == SDL_KEYUP)) {
+		//Watching a replay; the only controls are seeking (except while writing a hash log, which needs every tick in order):
+		if (!hash_log && evt.type == SDL_KEYDOWN && (evt.key.keysym.sym == SDLK_COMMA || evt.key.keysym.sym == SDLK_PERIOD)) {
+			uint32_t jump = uint32_t(REPLAY_SEEK_SECONDS * sim.tick_rate);
+			uint32_t to = playback->tick;
+			if (evt.key.keysym.sym == SDLK_COMMA) to = (to > jump ? to - jump : 0);
+			else to += jump;
+			playback->seek(&sim, to);
+			previous_round = sim.round;
+			remember_poses();
+			return true;
+		}
+	} else if (evt.type == SDL_KEYDOWN || evt.type == SDL_KEYUP) {
+		//Keys just track which buttons are held; RewindSim::step decides what they do.
+		uint8_t *input = nullptr;
+		uint8_t bit = 0;
+
 		// Left Player stuff
 		if (evt.key.keysym.sym == SDLK_d) { //Walk right
-
-			playerOne.right_walk = 1;
-		}
-
-		if (evt.key.keysym.sym == SDLK_a) { //Walk left
-
-			playerOne.left_walk = 1;
-		}
-
-		if (evt.key.keysym.sym == SDLK_w && playerOne.right_arm_angle == -60) { //Attack
-			playerOne.is_attacking = 1;
-		}
-
-		if (evt.key.keysym.sym == SDLK_s && playerOne.is_cooling == 0 && playerTwo.is_rewinding == 0) { //Rewind
-			playerOne.update_colors(1);
-			playerOne.is_rewinding = 1;
+			input = &inputs[0];
+			bit = INPUT_RIGHT;
+		} else if (evt.key.keysym.sym == SDLK_a) { //Walk left
+			input = &inputs[0];
+			bit = INPUT_LEFT;
+		} else if (evt.key.keysym.sym == SDLK_w) { //Attack
+			input = &inputs[0];
+			bit = INPUT_ATTACK;
+		} else if (evt.key.keysym.sym == SDLK_s) { //Rewind
+			input = &inputs[0];
+			bit = INPUT_REWIND;
 		}
 
 		//Right player stuff
-		if (evt.key.keysym.sym == SDLK_LEFT) { //Walk left
-
-			playerTwo.left_walk = 1;
-		}
-
-		if (evt.key.keysym.sym == SDLK_RIGHT) { //Walk right
-
-			playerTwo.right_walk = 1;
-		}
-
-		if (evt.key.keysym.sym == SDLK_UP && playerTwo.left_arm_angle == 60) { //Attack
-			playerTwo.is_attacking = 1;
-		}
-
-		if (evt.key.keysym.sym == SDLK_DOWN && playerTwo.is_cooling == 0 && playerOne.is_rewinding == 0) { //Rewind
-			playerTwo.update_colors(1);
-			playerTwo.is_rewinding = 1;
-		}
-
-	} else if (evt.type == SDL_KEYUP) {
-
-		//Left Player
-
-		if (evt.key.keysym.sym == SDLK_d) {
-
-			playerOne.right_walk = 0;
-		}
-
-		if (evt.key.keysym.sym == SDLK_a) {
-
-			playerOne.left_walk = 0;
-		}
-
-		if (evt.key.keysym.sym == SDLK_s && playerOne.is_rewinding == 1) {
-			playerOne.is_rewinding = 0;
-			playerOne.is_cooling = 1;
-			playerOne.seconds_passed = 0;
-			playerOne.update_colors(2);
-		}
-
-		// Right player
-		if (evt.key.keysym.sym == SDLK_LEFT) {
-
-			playerTwo.left_walk = 0;
-		}
-
-		if (evt.key.keysym.sym == SDLK_RIGHT) {
-
-			playerTwo.right_walk = 0;
-		}
-
-		if (evt.key.keysym.sym == SDLK_DOWN && playerTwo.is_rewinding == 1) {
-			playerTwo.is_rewinding = 0;
-			playerTwo.is_cooling = 1;
-			playerTwo.seconds_passed = 0;
-			playerTwo.update_colors(2);
+		else if (evt.key.keysym.sym == SDLK_LEFT) { //Walk left
+			input = &inputs[1];
+			bit = INPUT_LEFT;
+		} else if (evt.key.keysym.sym == SDLK_RIGHT) { //Walk right
+			input = &inputs[1];
+			bit = INPUT_RIGHT;
+		} else if (evt.key.keysym.sym == SDLK_UP) { //Attack
+			input = &inputs[1];
+			bit = INPUT_ATTACK;
+		} else if (evt.key.keysym.sym == SDLK_DOWN) { //Rewind
+			input = &inputs[1];
+			bit = INPUT_REWIND;
+		}
+
+		if (input) {
+			if (evt.type == SDL_KEYDOWN) {
+				*input |= bit;
+			} else {
+				*input &= ~bit;
+			}
+			return true;
 		}
-
 	}
 
 	return false;
 }
 
 void RewindMode::update(float elapsed) {
+	PHASE_TIMER(PHASE_UPDATE);
+	remember_poses();
 
-	//It is not possible for both players to rewind at the same time
-	assert((playerOne.is_rewinding == 1 && playerTwo.is_rewinding == 0) ||
-			(playerOne.is_rewinding == 0 && playerTwo.is_rewinding == 1) ||
-			(playerOne.is_rewinding == 0 && playerTwo.is_rewinding == 0));
-
-	/* --------------- MOVEMENT AND ATTACKS  --------------- */
-
-	//For the player on the left
-	if (playerOne.is_rewinding == 0) {
-		if (playerOne.is_cooling == 1) {
-			if (playerOne.seconds_cooldown >= REWIND_COOLDOWN) {
-				playerOne.update_colors(0);
-				playerOne.is_cooling = 0;
-				playerOne.seconds_cooldown = 0;
-			}
-			playerOne.seconds_cooldown += elapsed;
-		}
-
-		if (playerOne.is_attacking == 1 && playerOne.right_arm_angle <= 0) {
-			playerOne.right_arm_angle += elapsed + ATTACK_SPEED;
-			if (playerOne.right_arm_angle >= 0) {
-				playerOne.is_attacking = 0;
-				playerOne.right_arm_angle = 0;
-			}
-		}
-		else if (playerOne.is_attacking == 0 && playerOne.right_arm_angle > -60) {
-			playerOne.right_arm_angle += elapsed - ATTACK_COOLDOWN;
-			if (playerOne.right_arm_angle <= -60) {
-				playerOne.right_arm_angle = -60;
-			}
-		}
-
-		//If you're holding both keys down, you don't move
-		if (playerOne.left_walk == 1 && playerOne.right_walk == 0) {
-			update_movements(LEFT, PLAYER_ONE, playerOne, playerTwo,
-							court_radius, sword_tip_length);
-		}
-		else if (playerOne.left_walk == 0 && playerOne.right_walk == 1) {
-			update_movements(RIGHT, PLAYER_ONE, playerOne, playerTwo,
-							court_radius, sword_tip_length);
-		}
-
-		//For later if the player decides to rewind time
-		playerOne.rewind_log.push_front(glm::vec4(playerOne.head.x, playerOne.head.y, 
-								playerOne.right_arm_angle, playerOne.is_attacking));
-
-	} else if (playerOne.is_rewinding == 1) {
-		update_rewind(playerOne, elapsed);
-	}
+	if (paused) return; //(scrubbing through the timeline)
 
-	//For the player on the right
-	if (playerTwo.is_rewinding == 0) {
-		if (playerTwo.is_cooling == 1) {
-			if (playerTwo.seconds_cooldown >= REWIND_COOLDOWN) {
-				playerTwo.update_colors(0);
-				playerTwo.is_cooling = 0;
-				playerTwo.seconds_cooldown = 0;
+	if (arena) {
+		//(the same sort of button mashing as rewind-bench arena)
+		for (size_t i = 2; i < inputs.size(); ++i) {
+			if (holds[i] == 0) {
+				inputs[i] = uint8_t(mt() & (INPUT_LEFT | INPUT_RIGHT | INPUT_ATTACK | INPUT_REWIND));
+				holds[i] = 1 + mt() % std::max(1u, uint32_t(ARENA_HOLD_SECONDS * arena->tick_rate));
 			}
-			playerTwo.seconds_cooldown += elapsed;
+			holds[i] -= 1;
 		}
-
-		if (playerTwo.is_attacking == 1 && playerTwo.left_arm_angle <= 60) {
-			playerTwo.left_arm_angle -= elapsed + ATTACK_SPEED;
-			if (playerTwo.left_arm_angle <= 0) {
-				playerTwo.is_attacking = 0;
-				playerTwo.left_arm_angle = 0;
-			}
+		arena->step(inputs.data());
+		//A fighter who respawned shouldn't be blended with where they died:
+		for (size_t i = 0; i < previous_poses.size(); ++i) {
+			if (arena->dead[i]) previous_poses[i] = arena->fighters[i].get_pose();
 		}
-		else if (playerTwo.is_attacking == 0 && playerTwo.left_arm_angle < 60) {
-			playerTwo.left_arm_angle += elapsed + ATTACK_COOLDOWN;
-			if (playerTwo.left_arm_angle >= 60) {
-				playerTwo.left_arm_angle = 60;
-			}
-		}
-
-		if (playerTwo.left_walk == 1 && playerTwo.right_walk == 0) {
-			update_movements(LEFT, PLAYER_TWO, playerTwo, playerOne,
-				court_radius, sword_tip_length);
-		}
-		else if (playerTwo.left_walk == 0 && playerTwo.right_walk == 1) {
-			update_movements(RIGHT, PLAYER_TWO, playerTwo, playerOne,
-				court_radius, sword_tip_length);
-		}
-
-		playerTwo.rewind_log.push_front(glm::vec4(playerTwo.head.x, playerTwo.head.y,
-			playerTwo.left_arm_angle, playerTwo.is_attacking));
-
-	} else if (playerTwo.is_rewinding == 1) {
-		update_rewind(playerTwo, elapsed);
+		return;
 	}
 
-	/* ---------------- COLLISION DETECTION ---------------- */
-
-	//Check for temporal collisions in case someone is rewinding:
-	//In case of a collision, the rewinding player loses. 
-	if (playerOne.is_rewinding == 1) {
-		if (abs(playerOne.head.x - playerTwo.head.x) <= OVERLAP_DIST) {
-			right_score += 1;
-			playerOne = player_info(player_one_init, 1, playerOneColors,
-									playerOneRColors, playerOneCColors);
-
-			playerTwo = player_info(player_two_init, 2, playerTwoColors,
-									playerTwoRColors, playerTwoCColors);
-			return;
-		}
-	} else if (playerTwo.is_rewinding == 1) {
-		if (abs(playerOne.head.x - playerTwo.head.x) <= OVERLAP_DIST) {
-			left_score += 1;
-			playerOne = player_info(player_one_init, 1, playerOneColors,
-									playerOneRColors, playerOneCColors);
-
-			playerTwo = player_info(player_two_init, 2, playerTwoColors,
-									playerTwoRColors, playerTwoCColors);
+	if (rollback) {
+		double now = std::chrono::duration< double >(std::chrono::steady_clock::now().time_since_epoch()).count();
+		while (link->receive(&packet, now)) {
+			rollback->read_packet(packet.data(), packet.size());
+		}
+		if (!rollback->refused.empty()) {
+			//(one last hello, so the other side finds out too)
+			rollback->write_packet(&packet);
+			link->send(packet.data(), packet.size(), now);
+			std::cerr << rollback->refused << std::endl;
+			Mode::set_current(nullptr); //(quits; nothing of this mode may be touched after this)
 			return;
 		}
-	}
-
-	/* -------------------- HIT DETECTION -------------------- */
-
-	int player_one_wins = 0;
-	int player_two_wins = 0;
-
-	if (playerOne.is_attacking == 1) {
-		glm::vec2 points[3];
-		get_sword_points(playerOne, sword_tip_length, points);
-		
-		//Check if the sword hit the head
-		if (points[1].x >= playerTwo.head.x - playerTwo.head_radius.x &&
-			points[1].y <= playerTwo.head.y + playerTwo.head_radius.y){
-			player_one_wins = 1;
-		}
-		//Check if the sword hit the torso
-		if (points[1].x >= playerTwo.torso.x - playerTwo.torso_radius.x &&
-			points[1].y <= playerTwo.torso.y + playerTwo.torso_radius.y) {
-			player_one_wins = 1;
-		}
-	}
-
-	if (playerTwo.is_attacking == 1) {
-		glm::vec2 points[3];
-		get_sword_points(playerTwo, sword_tip_length, points);
-
-		//Check if the sword hit the head
-		if (points[1].x <= playerOne.head.x + playerOne.head_radius.x &&
-			points[1].y <= playerOne.head.y + playerOne.head_radius.y) {
-			player_two_wins = 1;
-		}
-		//Check if the sword hit the torso
-		if (points[1].x <= playerOne.torso.x + playerOne.torso_radius.x &&
-			points[1].y <= playerOne.torso.y + playerOne.torso_radius.y) {
-			player_two_wins = 1;
+		bool advanced = rollback->advance(inputs[0] | inputs[1]);
+		if (hash_log) {
+			while (RewindSnapshot const *state = rollback->final_state(hash_log->ticks + 1)) {
+				hash_log->record(*state);
+			}
 		}
+		rollback->write_packet(&packet);
+		link->send(packet.data(), packet.size(), now);
+
+		if (advanced && rollback->tick % uint32_t(ROLLBACK_REPORT_SECONDS * sim.tick_rate) == 0) {
+			RollbackStats const &stats = rollback->stats;
+			std::cout << "Rollback: " << stats.rollbacks << " rollbacks, depth "
+				<< (stats.rollbacks ? double(stats.total_depth) / stats.rollbacks : 0.0) << " avg / " << stats.max_depth << " max ticks, "
+				<< (stats.rollbacks ? stats.total_resimulate_seconds / stats.rollbacks * 1e6 : 0.0) << "us avg re-simulation, "
+				<< stats.stalls << " stalls." << std::endl;
+		}
+		//(sim was stepped by the session, if it could be)
+	} else if (playback) {
+		if (!playback->next_input(&inputs[0], &inputs[1])) return; //(hold on the last tick)
+		sim.step(inputs[0], inputs[1]);
+		if (hash_log) hash_log->record(sim);
+	} else {
+		if (bot) {
+			//(unused time isn't saved up, so a stall can't be followed by a burst of searching)
+			bot_credit = std::min(bot_credit + bot_budget, bot_budget);
+			double searched = bot->stats.search_seconds;
+			inputs[1] = bot->act(sim, bot_credit > 0.0 ? bot_credit : -1.0);
+			bot_credit -= bot->stats.search_seconds - searched;
+		}
+		if (recording) recording->record(sim, inputs[0], inputs[1]);
+		if (timeline) timeline->record(sim, inputs[0], inputs[1]);
+		sim.step(inputs[0], inputs[1]);
+		if (hash_log) hash_log->record(sim);
 	}
 
-	/* -------------------- END ROUND -------------------- */
-
-	if (player_one_wins == 0 && player_two_wins == 0) {
-		return;
-	}
-
-	if (player_one_wins == 1) {
-		left_score += 1;
-	} 
-	if (player_two_wins == 1) {
-		right_score += 1;
+	//A new round starting shouldn't be blended with the end of the previous one:
+	if (sim.round != previous_round) {
+		previous_round = sim.round;
+		remember_poses();
 	}
-
-	playerOne = player_info(player_one_init, 1, playerOneColors,
-							playerOneRColors, playerOneCColors);
-
-	playerTwo = player_info(player_two_init, 2, playerTwoColors,
-							playerTwoRColors, playerTwoCColors);
-
 }
 
-void RewindMode::draw(glm::uvec2 const& drawable_size) {
+void RewindMode::draw(glm::uvec2 const& drawable_size, float alpha) {
+	PHASE_TIMER(PHASE_DRAW);
+	//the match (or arena) being drawn:
+	size_t const count = fighter_count();
+	glm::vec2 const &court_radius = (arena ? arena->court_radius : sim.court_radius);
+	float const sword_tip_length = (arena ? arena->sword_tip_length : sim.sword_tip_length);
+
 	//some nice colors from the course web page:
 	const glm::u8vec4 bg_color = HEX_TO_U8VEC4(0xf3ffc6ff);
 	const glm::u8vec4 fg_color = HEX_TO_U8VEC4(0x000000ff);
@@ -557,10 +375,8 @@ void RewindMode::draw(glm::uvec2 const& drawable_size) {
 
 	//For angling those pesky rectangles (given two fixed points).
 	//Used when drawing the arms.
-	auto draw_angle_rectangle = [&vertices](glm::vec2 const& arm, glm::vec2 const arm_radius, glm::u8vec4 const& color, float angle) {
-
-		double sin_angle = get_sin(angle);
-		double cos_angle = get_cos(angle);
+	//(the sines and cosines of all four arm angles are computed together, below)
+	auto draw_angle_rectangle = [&vertices](glm::vec2 const& arm, glm::vec2 const arm_radius, glm::u8vec4 const& color, float sin_angle, float cos_angle) {
 
 		glm::vec2 pos_1 = glm::vec2(arm.x, arm.y);
 		glm::vec2 pos_2 = glm::vec2(arm.x, arm.y - arm_radius.y);
@@ -577,16 +393,17 @@ void RewindMode::draw(glm::uvec2 const& drawable_size) {
 
 	};
 
-	auto draw_sword = [&vertices](player_info& player, float sword_tip_length) {
+	auto draw_sword = [&vertices](player_info const &player, float sword_tip_length) {
 
 		glm::vec2 points[3];
 		get_sword_points(player, sword_tip_length, points);
 		glm::vec2 pos_1 = points[0];
 		glm::vec2 pos_2 = points[1];
 		glm::vec2 pos_3 = points[2];
-		vertices.emplace_back(glm::vec3(pos_1.x, pos_1.y, 0.0f), player.sword_color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(pos_2.x, pos_2.y, 0.0f), player.sword_color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(pos_3.x, pos_3.y, 0.0f), player.sword_color, glm::vec2(0.5f, 0.5f));
+		glm::u8vec4 sword_color = player.colors()[4];
+		vertices.emplace_back(glm::vec3(pos_1.x, pos_1.y, 0.0f), sword_color, glm::vec2(0.5f, 0.5f));
+		vertices.emplace_back(glm::vec3(pos_2.x, pos_2.y, 0.0f), sword_color, glm::vec2(0.5f, 0.5f));
+		vertices.emplace_back(glm::vec3(pos_3.x, pos_3.y, 0.0f), sword_color, glm::vec2(0.5f, 0.5f));
 	};
 
 	//walls:
@@ -596,25 +413,52 @@ void RewindMode::draw(glm::uvec2 const& drawable_size) {
 	draw_rectangle(glm::vec2(0.0f, court_radius.y + wall_radius), glm::vec2(court_radius.x, wall_radius), fg_color);
 
 
-	//Player One
-	draw_rectangle(playerOne.head, playerOne.head_radius, playerOne.head_color);
-	draw_rectangle(playerOne.torso, playerOne.torso_radius, playerOne.torso_color);
-	draw_angle_rectangle(playerOne.left_arm, playerOne.left_arm_radius, playerOne.left_arm_color, playerOne.left_arm_angle);
-	draw_angle_rectangle(playerOne.right_arm, playerOne.right_arm_radius, playerOne.right_arm_color, playerOne.right_arm_angle);
-	draw_rectangle(playerOne.left_leg, playerOne.left_leg_radius, playerOne.left_leg_color);
-	draw_rectangle(playerOne.right_leg, playerOne.right_leg_radius, playerOne.right_leg_color);
-	draw_sword(playerOne, sword_tip_length);
-
-	//Player Two
-	draw_rectangle(playerTwo.head, playerTwo.head_radius, playerTwo.head_color);
-	draw_rectangle(playerTwo.torso, playerTwo.torso_radius, playerTwo.torso_color);
-	draw_angle_rectangle(playerTwo.left_arm, playerTwo.left_arm_radius, playerTwo.left_arm_color, playerTwo.left_arm_angle);
-	draw_angle_rectangle(playerTwo.right_arm, playerTwo.right_arm_radius, playerTwo.right_arm_color, playerTwo.right_arm_angle);
-	draw_rectangle(playerTwo.left_leg, playerTwo.left_leg_radius, playerTwo.left_leg_color);
-	draw_rectangle(playerTwo.right_leg, playerTwo.right_leg_radius, playerTwo.right_leg_color);
-	draw_sword(playerTwo, sword_tip_length);
-
-	//scores:
+	//Show players partway between their previous and current tick poses, so motion
+	//stays smooth when frames are presented faster than the simulation ticks:
+	auto blend_pose = [alpha](player_info::Pose const &previous, player_info::Pose const &current) {
+		player_info::Pose pose;
+		pose.head = previous.head + (current.head - previous.head) * alpha;
+		pose.left_arm_angle = previous.left_arm_angle + (current.left_arm_angle - previous.left_arm_angle) * alpha;
+		pose.right_arm_angle = previous.right_arm_angle + (current.right_arm_angle - previous.right_arm_angle) * alpha;
+		return pose;
+	};
+
+	std::vector< player_info::Pose > current_poses(count);
+	for (size_t i = 0; i < count; ++i) {
+		player_info &player = fighter(i);
+		current_poses[i] = player.get_pose();
+		player.set_pose(blend_pose(previous_poses[i], current_poses[i]));
+	}
+
+	//(two arm angles per fighter)
+	std::vector< float > arm_angles(2 * count);
+	for (size_t i = 0; i < count; ++i) {
+		arm_angles[2 * i + 0] = fighter(i).left_arm_angle;
+		arm_angles[2 * i + 1] = fighter(i).right_arm_angle;
+	}
+	std::vector< float > arm_sines(2 * count), arm_cosines(2 * count);
+	sincos_degrees(arm_angles.data(), arm_angles.size(), arm_sines.data(), arm_cosines.data());
+
+	for (size_t i = 0; i < count; ++i) {
+		player_info const &player = fighter(i);
+		glm::u8vec4 const *colors = player.colors(); //head, torso, arms, legs, sword
+		draw_rectangle(player.head, player_body.head_radius, colors[0]);
+		draw_rectangle(player.torso(), player_body.torso_radius, colors[1]);
+		draw_angle_rectangle(player.left_arm(), player_body.left_arm_radius, colors[2], arm_sines[2 * i + 0], arm_cosines[2 * i + 0]);
+		draw_angle_rectangle(player.right_arm(), player_body.right_arm_radius, colors[2], arm_sines[2 * i + 1], arm_cosines[2 * i + 1]);
+		draw_rectangle(player.left_leg(), player_body.left_leg_radius, colors[3]);
+		draw_rectangle(player.right_leg(), player_body.right_leg_radius, colors[3]);
+		draw_sword(player, sword_tip_length);
+	}
+
+	//(put back the actual simulation state)
+	for (size_t i = 0; i < count; ++i) {
+		fighter(i).set_pose(current_poses[i]);
+	}
+
+	//scores (in the arena, the kills of the two fighters on the keyboard):
+	uint32_t left_score = (arena ? arena->kills[0] : sim.left_score);
+	uint32_t right_score = (arena ? arena->kills[1] : sim.right_score);
 	glm::vec2 score_radius = glm::vec2(0.1f, 0.1f);
 	for (uint32_t i = 0; i < left_score; ++i) {
 		draw_rectangle(glm::vec2(-court_radius.x + (2.0f + 3.0f * i) * score_radius.x, court_radius.y + 2.0f * wall_radius + 2.0f * score_radius.y), score_radius, fg_color);
@@ -623,6 +467,15 @@ void RewindMode::draw(glm::uvec2 const& drawable_size) {
 		draw_rectangle(glm::vec2(court_radius.x - (2.0f + 3.0f * i) * score_radius.x, court_radius.y + 2.0f * wall_radius + 2.0f * score_radius.y), score_radius, fg_color);
 	}
 
+	//timeline position, while paused for time-travel debugging:
+	if (paused && timeline) {
+		float fraction = (timeline->tick_count() ? timeline->tick / float(timeline->tick_count()) : 1.0f);
+		glm::vec2 bar_radius = glm::vec2(court_radius.x, 0.5f * wall_radius);
+		glm::vec2 bar_center = glm::vec2(0.0f, -court_radius.y + 2.0f * bar_radius.y);
+		draw_rectangle(bar_center, bar_radius, HEX_TO_U8VEC4(0x00000040));
+		draw_rectangle(glm::vec2(-court_radius.x + fraction * 2.0f * court_radius.x, bar_center.y), glm::vec2(wall_radius, 3.0f * bar_radius.y), fg_color);
+	}
+
 	//------ compute court-to-window transform ------
 
 	//compute area that should be visible:
@@ -2,193 +2,82 @@
 
 #include "Mode.hpp"
 #include "GL.hpp"
+#include "RewindSim.hpp"
+#include "Arena.hpp"
+#include "Replay.hpp"
+#include "Rollback.hpp"
+#include "UdpLink.hpp"
+#include "MctsBot.hpp"
+#include "Timeline.hpp"
+#include "StateHash.hpp"
 
 #include <vector>
-#include <deque>
-#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
-#define RIGHT 1
-#define LEFT 2
-#define PLAYER_ONE 1
-#define PLAYER_TWO 2
-#define MAX_DIST 1.25f
-#define OVERLAP_DIST 1.0f
-#define ATTACK_SPEED 10.0f
-#define ATTACK_COOLDOWN 1.75f
-#define REWIND_SPEEDUP 2
-#define WALK_SPEED 0.15f
-#define MAX_REWIND 1.5f
-#define REWIND_COOLDOWN 6.0f
-
-struct player_info {
-
-	glm::u8vec4 normal_colors[5]; //Colors to show normally
-	glm::u8vec4 rewind_colors[5]; //Colors to show when rewinding
-	glm::u8vec4 cooldown_colors[5]; //Colors to show when cooling down
-
-	glm::vec2 head; //Coordinates
-	glm::vec2 head_radius = glm::vec2(0.5f, 0.5f);
-	glm::vec4 head_color;
-
-	glm::vec2 torso; //Coordinates
-	glm::vec2 torso_radius = glm::vec2(0.20, 1.0f);
-	glm::vec4 torso_color;
-
-	glm::vec2 left_arm; //Coordinates
-	glm::vec2 left_arm_radius = glm::vec2(-1.25f, 0.4f);
-	glm::u8vec4 left_arm_color;
-	float left_arm_angle; //The current angle of the left arm
-
-	glm::vec2 right_arm; //Coordinates
-	glm::vec2 right_arm_radius = glm::vec2(1.25f, 0.4f);
-	glm::u8vec4 right_arm_color;
-	float right_arm_angle; //The current angle of the right arm
-
-	glm::vec2 left_leg; //Coordinates
-	glm::vec2 left_leg_radius = glm::vec2(0.10f, 1.0f);
-	glm::u8vec4 left_leg_color;
-
-	glm::vec2 right_leg; //Coordinates
-	glm::vec2 right_leg_radius = glm::vec2(0.10f, 1.0f);
-	glm::u8vec4 right_leg_color;
-
-	glm::u8vec4 sword_color;
-
-	//Handles keyboard inputs and state. 0 if false, 1 if true
-	int sword_arm = 0; 	//1 if the left player, 2 if the right player
-	int left_walk = 0; //1 if holding down the left key, 0 otherwise
-	int right_walk = 0; //1 if holding down the right key, 0 otherwise
-	int is_attacking = 0; //1 if the sword will kill the other player, 0 otherwise
-	int is_rewinding = 0; //1 if rewinding time, 0 otherwise
-	int is_cooling; //1 if the player cannot rewind time, 0 otherwise
-	float seconds_passed = 0; //Used to limit the amount that the player can rewind
-	float seconds_cooldown = 0; //Used to keep track of the cooldown of the move
-	std::deque<glm::vec4> rewind_log; //Stores the position of the head, the current angle of the sword arm, and
-									  //whether or not the player was attacking
-
-	player_info(glm::vec2 head_coord, int one_or_two, glm::u8vec4* colors, 
-				glm::u8vec4* r_colors, glm::u8vec4* c_colors) {
-
-		std::copy(colors, colors + 5, normal_colors);
-		std::copy(r_colors, r_colors + 5, rewind_colors);
-		std::copy(c_colors, c_colors + 5, cooldown_colors);
-
-		head = head_coord;
-		head_color = colors[0];
-
-		torso = glm::vec2(head.x, head.y - 1.50f);
-		torso_color = colors[1];
-
-		left_leg = glm::vec2(torso.x - 0.2, torso.y - 2.0f);
-		left_leg_color = colors[3];
-
-		right_leg = glm::vec2(torso.x + 0.2, torso.y - 2.0f);
-		right_leg_color = colors[3];
-
-		left_arm = glm::vec2(torso.x - 0.2f, torso.y + 0.4f);
-		left_arm_color = colors[2];
-		left_arm_angle = 60;
-
-		right_arm = glm::vec2(torso.x + 0.2f, torso.y + 0.4f);
-		right_arm_color = colors[2];
-		right_arm_angle = -60;
-
-		sword_color = colors[4];
-
-		if (one_or_two == PLAYER_ONE) {
-			sword_arm = PLAYER_ONE;
-		} else if(one_or_two == PLAYER_TWO){
-			sword_arm = PLAYER_TWO;
-		}
-
-		left_walk = 0;
-	    right_walk = 0;
-		is_attacking = 0;
-		is_rewinding = 0;
-		is_cooling = 0;
-		seconds_passed = 0; 
-		seconds_cooldown = 0;
-		rewind_log.clear(); 
-	
-	}
-
-	void update_coords(glm::vec2 head_coord) {
-		head = head_coord;
-		torso = glm::vec2(head.x, head.y - 1.50f);
-		left_arm = glm::vec2(torso.x - 0.2f, torso.y + 0.4f);
-		right_arm = glm::vec2(torso.x + 0.2f, torso.y + 0.4f);
-		left_leg = glm::vec2(torso.x - 0.2, torso.y - 2.0f);
-		right_leg = glm::vec2(torso.x + 0.2, torso.y - 2.0f);
-	}
-
-	void update_colors(int to_update) {
-
-		glm::u8vec4 colors[5];
-
-		if (to_update == 0) { //Normal colors
-			std::copy(normal_colors, normal_colors + 5, colors);
-		} else if (to_update == 1) { //Rewind colors
-			std::copy(rewind_colors, rewind_colors + 5, colors);
-		} else if (to_update == 2) { //Cooldown colors
-			std::copy(cooldown_colors, cooldown_colors + 5, colors);
-		}
-
-		head_color = colors[0];
-		torso_color = colors[1];
-		left_arm_color = colors[2];
-		right_arm_color = colors[2];
-		left_leg_color = colors[3];
-		right_leg_color = colors[3];
-		sword_color = colors[4];
-	}
-
-};
+#include <memory>
+#include <random>
 
+//Draws a RewindSim match (or, with 'arena_fighters', a RewindArena) and feeds it keyboard input:
 struct RewindMode : Mode {
-	RewindMode();
+	RewindMode(float tick_rate = TICK_RATE, size_t arena_fighters = 0, RewindParams const &params = RewindParams());
 	virtual ~RewindMode();
 
 	//functions called by main loop:
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
 	virtual void update(float elapsed) override;
-	virtual void draw(glm::uvec2 const &drawable_size) override;
-
-	glm::vec2 court_radius = glm::vec2(10.0f, 5.0f); 
-	uint32_t left_score = 0;
-	uint32_t right_score = 0;
-
-	glm::u8vec4 playerOneColors[5] = { HEX_TO_U8VEC4(0x0066ffff), HEX_TO_U8VEC4(0x0066ffff),
-									   HEX_TO_U8VEC4(0x0066ffff), HEX_TO_U8VEC4(0x0066ffff),
-									   HEX_TO_U8VEC4(0x0066ffff) };
-
-	glm::u8vec4 playerOneRColors[5] = { HEX_TO_U8VEC4(0x006699ff), HEX_TO_U8VEC4(0x006699ff),
-									   HEX_TO_U8VEC4(0x006699ff), HEX_TO_U8VEC4(0x006699ff),
-									   HEX_TO_U8VEC4(0x006699ff) };
-
-	glm::u8vec4 playerOneCColors[5] = { HEX_TO_U8VEC4(0x00666666), HEX_TO_U8VEC4(0x00666666),
-									   HEX_TO_U8VEC4(0x00666666), HEX_TO_U8VEC4(0x00666666),
-									   HEX_TO_U8VEC4(0x00666666) };
-
-	glm::u8vec4 playerTwoColors[5] = { HEX_TO_U8VEC4(0xff6600ff), HEX_TO_U8VEC4(0xff6600ff),
-									   HEX_TO_U8VEC4(0xff6600ff), HEX_TO_U8VEC4(0xff6600ff),
-									   HEX_TO_U8VEC4(0xff6600ff) };
-
-	glm::u8vec4 playerTwoRColors[5] = { HEX_TO_U8VEC4(0x996600ff), HEX_TO_U8VEC4(0x996600ff),
-									   HEX_TO_U8VEC4(0x996600ff), HEX_TO_U8VEC4(0x996600ff),
-									   HEX_TO_U8VEC4(0x996600ff) };
-
-	glm::u8vec4 playerTwoCColors[5] = { HEX_TO_U8VEC4(0x66660066), HEX_TO_U8VEC4(0x66660066),
-									   HEX_TO_U8VEC4(0x66660066), HEX_TO_U8VEC4(0x66660066),
-									   HEX_TO_U8VEC4(0x66660066) };
-
-	float sword_tip_length = 2.0f;
-	glm::vec2 player_one_init = glm::vec2(-court_radius.x + 2.0f, 0.0f);
-	glm::vec2 player_two_init = glm::vec2(court_radius.x - 2.0f, 0.0f);
-
-	player_info playerOne = player_info(player_one_init, 1, playerOneColors, 
-										playerOneRColors, playerOneCColors);
-
-	player_info playerTwo = player_info(player_two_init, 2, playerTwoColors, 
-										playerTwoRColors, playerTwoCColors);
+	virtual void draw(glm::uvec2 const &drawable_size, float alpha) override;
+
+	//The match itself; update() is expected to be called with sim.tick:
+	RewindSim sim;
+
+	//If set, this is party mode instead: every fighter in the arena is drawn, the keyboard
+	// controls the first two (who start next to each other, facing), and the rest mash
+	// random buttons. (sim is left alone, and none of the options below apply.)
+	std::unique_ptr< RewindArena > arena;
+	std::mt19937 mt; //(for the arena's computer fighters)
+	std::vector< uint32_t > holds; //ticks left before each computer fighter changes buttons
+
+	//The fighters being drawn and fed input (the match's two players, or the arena's fighters):
+	size_t fighter_count() const;
+	player_info &fighter(size_t i);
+
+	//Buttons currently held by each fighter (INPUT_* bits; the keyboard sets the first two):
+	std::vector< uint8_t > inputs;
+
+	//If set, every tick's inputs are written here:
+	std::unique_ptr< ReplayWriter > recording;
+
+	//If set, the state after every tick is hashed here (during online play, once no rollback can change it):
+	std::unique_ptr< StateHashWriter > hash_log;
+
+	//If set, inputs come from here instead of the keyboard (',' and '.' seek back and forward):
+	std::unique_ptr< ReplayReader > playback;
+
+	//If set, this is an online match: the local player is controlled with either
+	// set of keys, and the other player's inputs arrive over 'link':
+	std::unique_ptr< UdpLink > link;
+	std::unique_ptr< RollbackSession > rollback;
+	std::vector< uint8_t > packet; //(scratch space for sending and receiving)
+
+	//If set, the computer plays player two (searching for 'bot_budget' seconds per tick, on average):
+	// the search runs on this thread, so a tick that goes over its budget (a batch of
+	// rollouts can take longer than a short tick) is paid back by searching less on the
+	// next ones, and the game keeps up with real time.
+	std::unique_ptr< MctsBot > bot;
+	double bot_budget = 0.0;
+	double bot_credit = 0.0; //search time still allowed (negative while paying back an overrun)
+
+	//If set (time-travel debugging), every tick is kept here; 'p' pauses the match,
+	// then ',' / '.' step a tick, '[' / ']' a second, and Home / End jump to the
+	// ends of the session. 'p' again resumes from the tick shown (dropping the ticks
+	// after it), or from the end if the match is being recorded to a replay:
+	std::unique_ptr< Timeline > timeline;
+	bool paused = false;
+
+	//Round that previous_poses belong to:
+	uint32_t previous_round = 0;
+
+	//Each fighter's pose as of the start of the latest tick, blended with the current ones in draw():
+	std::vector< player_info::Pose > previous_poses;
+	void remember_poses();
 
 	//----- opengl assets / helpers ------
 
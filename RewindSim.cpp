@@ -0,0 +1,635 @@
+#include "RewindSim.hpp"
+#include "DegreeTrig.hpp"
+#include "Collision.hpp"
+#include "PhaseTimers.hpp"
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+PlayerBody const player_body;
+
+PlayerPalette const player_palettes[PALETTES] = {
+	{{ //PALETTE_PLAYER_ONE
+		{ HEX_TO_U8VEC4(0x0066ffff), HEX_TO_U8VEC4(0x0066ffff), HEX_TO_U8VEC4(0x0066ffff), HEX_TO_U8VEC4(0x0066ffff), HEX_TO_U8VEC4(0x0066ffff) },
+		{ HEX_TO_U8VEC4(0x006699ff), HEX_TO_U8VEC4(0x006699ff), HEX_TO_U8VEC4(0x006699ff), HEX_TO_U8VEC4(0x006699ff), HEX_TO_U8VEC4(0x006699ff) },
+		{ HEX_TO_U8VEC4(0x00666666), HEX_TO_U8VEC4(0x00666666), HEX_TO_U8VEC4(0x00666666), HEX_TO_U8VEC4(0x00666666), HEX_TO_U8VEC4(0x00666666) },
+	}},
+	{{ //PALETTE_PLAYER_TWO
+		{ HEX_TO_U8VEC4(0xff6600ff), HEX_TO_U8VEC4(0xff6600ff), HEX_TO_U8VEC4(0xff6600ff), HEX_TO_U8VEC4(0xff6600ff), HEX_TO_U8VEC4(0xff6600ff) },
+		{ HEX_TO_U8VEC4(0x996600ff), HEX_TO_U8VEC4(0x996600ff), HEX_TO_U8VEC4(0x996600ff), HEX_TO_U8VEC4(0x996600ff), HEX_TO_U8VEC4(0x996600ff) },
+		{ HEX_TO_U8VEC4(0x66660066), HEX_TO_U8VEC4(0x66660066), HEX_TO_U8VEC4(0x66660066), HEX_TO_U8VEC4(0x66660066), HEX_TO_U8VEC4(0x66660066) },
+	}},
+};
+
+//Returns sin(angle) in degrees.
+double get_sin(float angle) 
+{
+	return sin_degrees(angle);
+}
+
+//Returns cos(angle) in degrees.
+double get_cos(float angle)
+{
+	return cos_degrees(angle);
+}
+
+//Calculates the vertices of the sword of the given player.
+//Note that the sword is basically a triangle.
+void get_sword_points(player_state const &player, float sword_tip_length, glm::vec2 points[]) {
+	double sin_angle;
+	double cos_angle;
+	glm::vec2 pos_1;
+	glm::vec2 pos_2;
+	glm::vec2 pos_3;
+
+	if (player.sword_arm == PLAYER_ONE) { //Left player
+
+		sin_angle = get_sin(player.right_arm_angle);
+		cos_angle = get_cos(player.right_arm_angle);
+		glm::vec2 right_arm = player.right_arm();
+		glm::vec2 const &right_arm_radius = player_body.right_arm_radius;
+
+		pos_1 = glm::vec2(right_arm.x + right_arm_radius.x * cos_angle,
+						  right_arm.y - right_arm_radius.x * sin_angle);
+		pos_2 = glm::vec2(pos_1.x + sword_tip_length * cos_angle, pos_1.y - sword_tip_length * sin_angle);
+		pos_3 = glm::vec2(right_arm.x + right_arm_radius.x * cos_angle,
+						  right_arm.y - right_arm_radius.x * sin_angle - right_arm_radius.y);
+	}
+	else if (player.sword_arm == PLAYER_TWO) { //Right player
+
+		sin_angle = get_sin(player.left_arm_angle);
+		cos_angle = get_cos(player.left_arm_angle);
+		glm::vec2 left_arm = player.left_arm();
+		glm::vec2 const &left_arm_radius = player_body.left_arm_radius;
+
+		pos_1 = glm::vec2(left_arm.x + left_arm_radius.x * cos_angle,
+						  left_arm.y - left_arm_radius.x * sin_angle);
+		pos_2 = glm::vec2(pos_1.x - sword_tip_length * cos_angle, pos_1.y + sword_tip_length * sin_angle);
+		pos_3 = glm::vec2(left_arm.x + left_arm_radius.x * cos_angle,
+						  left_arm.y - left_arm_radius.x * sin_angle - left_arm_radius.y);
+	}
+
+	points[0] = pos_1;
+	points[1] = pos_2;
+	points[2] = pos_3;
+}
+
+//Rewinds a player through their own rewind log:
+void update_rewind(player_info& player, float elapsed, RewindParams const &params) {
+	PHASE_TIMER(PHASE_REWIND);
+	update_rewind(player, player.rewind_log, elapsed, params.rewind_speed, params.max_rewind);
+}
+
+//The rules that do arithmetic are written once against the scalar type S
+// (see SimScalar.hpp), reading and writing the players' float fields through
+// ScalarTraits< S >; the float versions declared in RewindSim.hpp call them with S = float.
+namespace {
+
+template< typename S >
+S scalar(float value) {
+	return ScalarTraits< S >::from_float(value);
+}
+
+//The length of a tick in seconds; for floats, that's 'tick' (1 / tick_rate, worked out once):
+template< typename S >
+S seconds_per_tick(float tick_rate, float) {
+	return S(1) / scalar< S >(tick_rate);
+}
+template< >
+float seconds_per_tick< float >(float, float tick) {
+	return tick;
+}
+
+//Counts down a player's rewind cooldown by one tick:
+template< typename S >
+void update_cooldown_as(player_state& player, S elapsed, S rewind_cooldown) {
+	PHASE_TIMER(PHASE_COOLDOWN);
+	if (player.is_cooling == 1) {
+		S seconds_cooldown = scalar< S >(player.seconds_cooldown);
+		if (seconds_cooldown >= rewind_cooldown) {
+			player.is_cooling = 0;
+			seconds_cooldown = S(0);
+		}
+		player.seconds_cooldown = ScalarTraits< S >::to_float(seconds_cooldown + elapsed);
+	}
+}
+
+//Swings a player's sword arm forward while attacking, and back to rest otherwise.
+//'swing' and 'retract' are how far it moves this tick each way.
+template< typename S >
+inline void update_swing_as(player_state& player, S swing, S retract) {
+	PHASE_TIMER(PHASE_SWING);
+	S angle = scalar< S >(player.sword_angle());
+	if (player.sword_arm == PLAYER_ONE) { //Swings clockwise, from -60 up to 0
+		if (player.is_attacking == 1 && angle <= S(0)) {
+			angle += swing;
+			if (angle >= S(0)) {
+				player.is_attacking = 0;
+				angle = S(0);
+			}
+		}
+		else if (player.is_attacking == 0 && angle > S(-60)) {
+			angle -= retract;
+			if (angle <= S(-60)) {
+				angle = S(-60);
+			}
+		}
+	} else { //Swings counter-clockwise, from 60 down to 0
+		if (player.is_attacking == 1 && angle <= S(60)) {
+			angle -= swing;
+			if (angle <= S(0)) {
+				player.is_attacking = 0;
+				angle = S(0);
+			}
+		}
+		else if (player.is_attacking == 0 && angle < S(60)) {
+			angle += retract;
+			if (angle >= S(60)) {
+				angle = S(60);
+			}
+		}
+	}
+	player.set_sword_angle(ScalarTraits< S >::to_float(angle));
+}
+
+//get_sword_points(...)[1], the sword tip, computed in S:
+template< typename S >
+void sword_tip_as(player_state const &player, typename ScalarTraits< S >::Wide sword_tip_length, S *x, S *y) {
+	typedef ScalarTraits< S > T;
+	typename T::Wide sin_angle = T::sin(scalar< S >(player.sword_angle()));
+	typename T::Wide cos_angle = T::cos(scalar< S >(player.sword_angle()));
+	//(the shoulder, as in player_state::right_arm() and left_arm())
+	S torso_y = scalar< S >(player.head.y) - scalar< S >(1.50f);
+	S arm_y = torso_y + scalar< S >(0.4f);
+	if (player.sword_arm == PLAYER_ONE) {
+		S arm_x = scalar< S >(player.head.x) + scalar< S >(0.2f);
+		typename T::Wide radius = T::widen(scalar< S >(player_body.right_arm_radius.x));
+		S hilt_x = T::narrow(T::widen(arm_x) + radius * cos_angle);
+		S hilt_y = T::narrow(T::widen(arm_y) - radius * sin_angle);
+		*x = T::narrow(T::widen(hilt_x) + sword_tip_length * cos_angle);
+		*y = T::narrow(T::widen(hilt_y) - sword_tip_length * sin_angle);
+	} else {
+		S arm_x = scalar< S >(player.head.x) - scalar< S >(0.2f);
+		typename T::Wide radius = T::widen(scalar< S >(player_body.left_arm_radius.x));
+		S hilt_x = T::narrow(T::widen(arm_x) + radius * cos_angle);
+		S hilt_y = T::narrow(T::widen(arm_y) - radius * sin_angle);
+		*x = T::narrow(T::widen(hilt_x) - sword_tip_length * cos_angle);
+		*y = T::narrow(T::widen(hilt_y) + sword_tip_length * sin_angle);
+	}
+}
+
+//Determines the player's (not the other player!) new position, and ensures 
+//that the two players don't collide with each other - there's an invisble
+//wall seperating them. Also makes sure that the players can't go through the
+//walls of the arena.
+//'walk' is the distance to move this tick, and 'max_dist' the closest the players may get.
+template< typename S >
+void update_movements_as(int right_or_left, int one_or_two, player_state& player,
+					  player_state const& other_player, S court_x, typename ScalarTraits< S >::Wide sword_tip_length, S walk, S max_dist) {
+	PHASE_TIMER(PHASE_MOVEMENT);
+	typedef ScalarTraits< S > T;
+	//Walking toward the other player is limited by the sword tip (and 'max_dist'),
+	//walking away by the end of the other arm; both by the walls:
+	bool forward = (one_or_two == PLAYER_ONE ? right_or_left == RIGHT : right_or_left == LEFT);
+	S head_x = scalar< S >(player.head.x);
+	S x, y;
+	if (forward) {
+		S distance = head_x - scalar< S >(other_player.head.x);
+		if (distance < S(0)) distance = -distance;
+		if (distance <= max_dist) return; //(checked first, as it's cheaper than finding the sword tip)
+		sword_tip_as< S >(player, sword_tip_length, &x, &y);
+	} else {
+		float back_angle = (one_or_two == PLAYER_ONE ? player.left_arm_angle : player.right_arm_angle);
+		S arm_x = (one_or_two == PLAYER_ONE ? scalar< S >(player.head.x) - scalar< S >(0.2f) : scalar< S >(player.head.x) + scalar< S >(0.2f));
+		typename T::Wide radius = T::widen(scalar< S >(one_or_two == PLAYER_ONE ? player_body.left_arm_radius.x : player_body.right_arm_radius.x));
+		x = T::narrow(T::widen(arm_x) + radius * T::cos(scalar< S >(back_angle)));
+	}
+	if (!(x <= court_x && x >= -court_x)) return;
+	head_x = (right_or_left == RIGHT ? head_x + walk : head_x - walk);
+	player.update_coords(glm::vec2(T::to_float(head_x), 0.0f));
+}
+
+//The original hit test: the sword tip against the front edges of the other player's head and torso:
+template< typename S >
+int sword_tip_hits_as(player_state const &player, player_state const &other_player, typename ScalarTraits< S >::Wide sword_tip_length) {
+	S x, y;
+	sword_tip_as< S >(player, sword_tip_length, &x, &y);
+	S head_x = scalar< S >(other_player.head.x);
+	S head_y = scalar< S >(other_player.head.y);
+	S torso_y = head_y - scalar< S >(1.50f); //(other_player.torso().y)
+
+	int hit = 0;
+	if (player.sword_arm == PLAYER_ONE) { //(facing right, so the front edges are on the left)
+		//Check if the sword hit the head
+		if (x >= head_x - scalar< S >(player_body.head_radius.x) &&
+			y <= head_y + scalar< S >(player_body.head_radius.y)) {
+			hit = 1;
+		}
+		//Check if the sword hit the torso
+		if (x >= head_x - scalar< S >(player_body.torso_radius.x) &&
+			y <= torso_y + scalar< S >(player_body.torso_radius.y)) {
+			hit = 1;
+		}
+	} else {
+		//Check if the sword hit the head
+		if (x <= head_x + scalar< S >(player_body.head_radius.x) &&
+			y <= head_y + scalar< S >(player_body.head_radius.y)) {
+			hit = 1;
+		}
+		//Check if the sword hit the torso
+		if (x <= head_x + scalar< S >(player_body.torso_radius.x) &&
+			y <= torso_y + scalar< S >(player_body.torso_radius.y)) {
+			hit = 1;
+		}
+	}
+	return hit;
+}
+
+}
+
+void update_cooldown(player_state& player, float elapsed, RewindParams const &params) {
+	update_cooldown_as< float >(player, elapsed, params.rewind_cooldown);
+}
+
+//'ticks' is the length of this tick in TICK_RATE ticks:
+void update_swing(player_state& player, float ticks, RewindParams const &params) {
+	update_swing_as< float >(player, ticks * params.attack_speed, ticks * params.attack_cooldown);
+}
+
+void update_movements(int right_or_left, int one_or_two, player_state& player,
+					  player_state const& other_player, glm::vec2 court_radius, float sword_tip_length, float walk, float max_dist) {
+	update_movements_as< float >(right_or_left, one_or_two, player, other_player, court_radius.x, sword_tip_length, walk, max_dist);
+}
+
+int sword_tip_hits(player_state const &player, player_state const &other_player, float sword_tip_length) {
+	return sword_tip_hits_as< float >(player, other_player, sword_tip_length);
+}
+
+int sword_hits(player_state const &player, player_state const &other_player, float sword_tip_length) {
+	ConvexShape sword = sword_shape(player, sword_tip_length);
+	ConvexShape body[BodyPartCount];
+	body_shapes(other_player, body);
+	Contact contacts[BodyPartCount];
+	collide_one(sword, body, BodyPartCount, contacts);
+	for (auto const &contact : contacts) {
+		if (contact.hit) return 1;
+	}
+	return 0;
+}
+
+int sword_sweep_hits(player_state const &player, float swing_from, uint32_t was_attacking, player_state const &other_player, float sword_tip_length, float *time) {
+	float from_angle = swing_from;
+	if (player.is_rewinding == 1) {
+		//(playback jumps the sword around rather than swinging it, so just test where it is)
+		if (player.is_attacking != 1) return 0;
+		from_angle = player.sword_angle();
+	} else if (was_attacking != 1) {
+		return 0; //(the swing that ends this tick still counts, for the stretch up to its end)
+	}
+	ConvexShape body[BodyPartCount];
+	body_shapes(other_player, body);
+	return sweep_sword(player, from_angle, sword_tip_length, body, BodyPartCount, time) ? 1 : 0;
+}
+
+//Translates the buttons a player is holding into their state for this tick.
+//Holding a button behaves like the key repeat of the original keyboard controls.
+//A rewind can only start if 'others_rewinding' is 0.
+void apply_input(uint8_t input, player_state& player, int others_rewinding) {
+	PHASE_TIMER(PHASE_INPUT);
+	player.left_walk = (input & INPUT_LEFT) ? 1 : 0;
+	player.right_walk = (input & INPUT_RIGHT) ? 1 : 0;
+
+	//Attacks can only start when the sword is at rest:
+	if (input & INPUT_ATTACK) {
+		if ((player.sword_arm == PLAYER_ONE && player.right_arm_angle == -60) ||
+			(player.sword_arm == PLAYER_TWO && player.left_arm_angle == 60)) {
+			player.is_attacking = 1;
+		}
+	}
+
+	if (input & INPUT_REWIND) {
+		if (player.is_rewinding == 0 && player.is_cooling == 0 && others_rewinding == 0) {
+			player.is_rewinding = 1;
+		}
+	} else if (player.is_rewinding == 1) { //Released rewind
+		player.is_rewinding = 0;
+		player.is_cooling = 1;
+		player.seconds_passed = 0;
+		player.rewind_offset = 0;
+	}
+}
+
+std::vector< RewindParamInfo > const &rewind_param_info() {
+	static std::vector< RewindParamInfo > info = {
+		{"walk_speed", &RewindParams::walk_speed},
+		{"attack_speed", &RewindParams::attack_speed},
+		{"attack_cooldown", &RewindParams::attack_cooldown},
+		{"rewind_speed", &RewindParams::rewind_speed},
+		{"max_rewind", &RewindParams::max_rewind},
+		{"rewind_cooldown", &RewindParams::rewind_cooldown},
+		{"max_dist", &RewindParams::max_dist},
+		{"overlap_dist", &RewindParams::overlap_dist},
+	};
+	return info;
+}
+
+void set_rewind_param(RewindParams *params, std::string const &assignment) {
+	size_t equals = assignment.find('=');
+	std::string name = assignment.substr(0, equals);
+	for (auto const &info : rewind_param_info()) {
+		if (name != info.name) continue;
+		if (equals == std::string::npos) throw std::runtime_error("Expecting '" + name + "=<value>'.");
+		std::string value = assignment.substr(equals + 1);
+		size_t used = 0;
+		float parsed = 0.0f;
+		try {
+			parsed = std::stof(value, &used);
+		} catch (std::exception &) {
+			used = 0;
+		}
+		if (value.empty() || used != value.size()) throw std::runtime_error("'" + value + "' isn't a number (for " + name + ").");
+		params->*info.value = parsed;
+		return;
+	}
+	std::string names;
+	for (auto const &info : rewind_param_info()) names += std::string(" ") + info.name;
+	throw std::runtime_error("Unknown parameter '" + name + "'; there are:" + names + ".");
+}
+
+void check_rewind_params(RewindParams const &params) {
+	for (auto const &info : rewind_param_info()) {
+		float value = params.*info.value;
+		if (!(value > 0.0f && value < 1e6f)) {
+			throw std::runtime_error(std::string(info.name) + " must be positive (and not enormous); it is " + std::to_string(value) + ".");
+		}
+	}
+}
+
+//----- systems -----
+// The rules, as systems over the fighters' components. Fighters are created in
+// pairs, each pair a duel (the fighter on the left, then the one on the right),
+// and never destroyed, so rows 2d and 2d + 1 of an archetype fight each other.
+// RewindSim::step_as queries for the fighters once a tick and runs every system
+// on each duel in turn, so the systems are plain loops over a duel's rows.
+namespace {
+
+size_t const DUEL_SIZE = 2;
+
+//This tick's rules, worked out once for all the systems:
+template< typename S >
+struct TickRules {
+	typedef typename ScalarTraits< S >::Wide Wide;
+	S elapsed; //seconds
+	S rewind_cooldown, rewind_speed, max_rewind;
+	S swing, retract; //degrees the sword moves this tick each way
+	S walk; //distance a fighter walks this tick
+	S court_x, max_dist, overlap_dist;
+	float sword_tip_length;
+	Wide tip_length; //(sword_tip_length, in S's geometry)
+	uint32_t exact_hits;
+	uint32_t two_rewinders;
+};
+
+//One duel's rows of the arrays World::query hands over:
+struct Duel {
+	player_info *players; //(the left fighter, then the right)
+	Swing *swings;
+};
+
+#ifndef NDEBUG
+//Fighters rewinding right now (for step_as's assert):
+uint32_t count_rewinding(World &world) {
+	uint32_t rewinding = 0;
+	world.query< player_info >([&](size_t count, Entity const *, player_info *players) {
+		for (size_t i = 0; i < count; ++i) {
+			rewinding += players[i].is_rewinding;
+		}
+	});
+	return rewinding;
+}
+#endif
+
+//apply_input, given each fighter's buttons; a rewind can't start while the fighter's
+// rival is rewinding, unless the rules allow two rewinders:
+void input_system(Duel const &duel, uint8_t const *inputs, uint32_t two_rewinders) {
+	for (size_t i = 0; i < DUEL_SIZE; ++i) {
+		apply_input(inputs[i], duel.players[i], two_rewinders ? 0 : duel.players[i ^ 1].is_rewinding);
+	}
+}
+
+//Each fighter in turn: if they aren't rewinding, update_cooldown, update_swing, walk
+// (update_movements) and log where they are; if they are, play back their log
+// (update_rewind). This has to be one pass, since fighters stop each other walking:
+// each sees where their rival ended up if the rival went first. (For HITS_SWEPT, also
+// notes where each sword started this tick.)
+template< typename S >
+void movement_system(Duel const &duel, TickRules< S > const &rules) {
+	for (size_t i = 0; i < DUEL_SIZE; ++i) {
+		player_info &player = duel.players[i];
+		if (rules.exact_hits == HITS_SWEPT) {
+			duel.swings[i].from_angle = player.sword_angle();
+			duel.swings[i].was_attacking = player.is_attacking;
+		}
+		if (player.is_rewinding == 0) {
+			update_cooldown_as< S >(player, rules.elapsed, rules.rewind_cooldown);
+			update_swing_as< S >(player, rules.swing, rules.retract);
+
+			//If you're holding both keys down, you don't move
+			if (player.left_walk == 1 && player.right_walk == 0) {
+				update_movements_as< S >(LEFT, player.sword_arm, player, duel.players[i ^ 1], rules.court_x, rules.tip_length, rules.walk, rules.max_dist);
+			} else if (player.left_walk == 0 && player.right_walk == 1) {
+				update_movements_as< S >(RIGHT, player.sword_arm, player, duel.players[i ^ 1], rules.court_x, rules.tip_length, rules.walk, rules.max_dist);
+			}
+
+			//For later if the player decides to rewind time
+			PHASE_TIMER(PHASE_LOG);
+			player.rewind_log.push_front(glm::vec4(player.head.x, player.head.y, player.sword_angle(), player.is_attacking));
+		} else {
+			PHASE_TIMER(PHASE_REWIND);
+			update_rewind_as< S >(player, player.rewind_log, rules.elapsed, rules.rewind_speed, rules.max_rewind);
+		}
+	}
+}
+
+//A rewinding fighter who comes within overlap_dist of their rival causes a time rift,
+// which scores for the rival; true if there was one:
+template< typename S >
+bool rift_system(Duel const &duel, TickRules< S > const &rules, uint32_t *left_score, uint32_t *right_score) {
+	PHASE_TIMER(PHASE_RIFT);
+	player_info const &left = duel.players[0];
+	player_info const &right = duel.players[1];
+	S distance = scalar< S >(left.head.x) - scalar< S >(right.head.x);
+	if (distance < S(0)) distance = -distance;
+	if (distance > rules.overlap_dist) return false;
+	bool rift = false;
+	if (left.is_rewinding == 1) {
+		*right_score += 1;
+		rift = true;
+	}
+	if (right.is_rewinding == 1) {
+		*left_score += 1;
+		rift = true;
+	}
+	return rift;
+}
+
+//Fighters whose swords hit their rivals score (by the rules' exact_hits); true if there was a hit:
+template< typename S >
+bool hit_system(Duel const &duel, TickRules< S > const &rules, uint32_t *left_score, uint32_t *right_score) {
+	PHASE_TIMER(PHASE_HITS);
+	player_info const &left = duel.players[0];
+	player_info const &right = duel.players[1];
+	int left_wins = 0;
+	int right_wins = 0;
+	float sword_tip_length = rules.sword_tip_length;
+	if (rules.exact_hits == HITS_SWEPT) {
+		float left_time = 0.0f;
+		float right_time = 0.0f;
+		left_wins = sword_sweep_hits(left, duel.swings[0].from_angle, duel.swings[0].was_attacking, right, sword_tip_length, &left_time);
+		right_wins = sword_sweep_hits(right, duel.swings[1].from_angle, duel.swings[1].was_attacking, left, sword_tip_length, &right_time);
+		//If both swords land, the one that got there first wins:
+		if (left_wins == 1 && right_wins == 1) {
+			if (left_time < right_time) right_wins = 0;
+			else if (right_time < left_time) left_wins = 0;
+		}
+	} else if (rules.exact_hits == HITS_EXACT) {
+		if (left.is_attacking == 1) left_wins = sword_hits(left, right, sword_tip_length);
+		if (right.is_attacking == 1) right_wins = sword_hits(right, left, sword_tip_length);
+	} else {
+		if (left.is_attacking == 1) left_wins = sword_tip_hits_as< S >(left, right, rules.tip_length);
+		if (right.is_attacking == 1) right_wins = sword_tip_hits_as< S >(right, left, rules.tip_length);
+	}
+	if (left_wins == 1) *left_score += 1;
+	if (right_wins == 1) *right_score += 1;
+	return left_wins == 1 || right_wins == 1;
+}
+
+}
+
+RewindSim::RewindSim(float tick_rate_, RewindParams const &params_) : tick_rate(tick_rate_), tick(1.0f / tick_rate_), params(params_) {
+	glm::vec2 const heads[2] = { player_one_init, player_two_init };
+	for (uint32_t p = 0; p < 2; ++p) {
+		player_info player(heads[p], p == 0 ? PLAYER_ONE : PLAYER_TWO, p == 0 ? PALETTE_PLAYER_ONE : PALETTE_PLAYER_TWO);
+		//size rewind logs for the actual tick rate and rules:
+		player.rewind_log = RewindLog(rewind_log_size(params, tick_rate));
+		Spawn spawn;
+		spawn.head = heads[p];
+		fighters[p] = world.create(player, spawn, Swing());
+	}
+}
+
+void RewindSim::set_params(RewindParams const &params_) {
+	params = params_;
+	size_t size = rewind_log_size(params, tick_rate);
+	world.query< player_info >([&](size_t count, Entity const *, player_info *players) {
+		for (size_t i = 0; i < count; ++i) {
+			if (players[i].rewind_log.capacity() != size) players[i].rewind_log = RewindLog(size);
+		}
+	});
+}
+
+void RewindSim::step(uint8_t player_one_input, uint8_t player_two_input) {
+	step_as< SimScalar >(player_one_input, player_two_input);
+}
+
+template< typename S >
+void RewindSim::step_as(uint8_t player_one_input, uint8_t player_two_input) {
+	PHASE_TIMER(PHASE_STEP);
+
+	//It is not possible for two fighters to rewind at the same time (unless the rules allow it)
+	assert(two_rewinders == 1 || count_rewinding(world) <= 1);
+
+	TickRules< S > rules;
+	rules.elapsed = seconds_per_tick< S >(tick_rate, tick);
+	//Movement constants are per tick at TICK_RATE; scale them so that the
+	//game plays at the same speed whatever tick rate was chosen:
+	S ticks = rules.elapsed * scalar< S >(TICK_RATE);
+	rules.rewind_cooldown = scalar< S >(params.rewind_cooldown);
+	rules.rewind_speed = scalar< S >(params.rewind_speed);
+	rules.max_rewind = scalar< S >(params.max_rewind);
+	rules.swing = ticks * scalar< S >(params.attack_speed);
+	rules.retract = ticks * scalar< S >(params.attack_cooldown);
+	rules.walk = scalar< S >(params.walk_speed) * ticks;
+	rules.court_x = scalar< S >(court_radius.x);
+	rules.max_dist = scalar< S >(params.max_dist);
+	rules.overlap_dist = scalar< S >(params.overlap_dist);
+	rules.sword_tip_length = sword_tip_length;
+	rules.tip_length = ScalarTraits< S >::widen(scalar< S >(sword_tip_length));
+	rules.exact_hits = exact_hits;
+	rules.two_rewinders = two_rewinders;
+
+	uint8_t const inputs[DUEL_SIZE] = { player_one_input, player_two_input };
+	bool round_over = false;
+	world.query< player_info, Swing >([&](size_t count, Entity const *, player_info *players, Swing *swings) {
+		assert(count == DUEL_SIZE); //(player one, then player two: the one duel there is inputs for)
+		Duel duel = { players, swings };
+		input_system(duel, inputs, rules.two_rewinders);
+		movement_system< S >(duel, rules);
+		//A time rift (or a hit) ends the round:
+		round_over = rift_system< S >(duel, rules, &left_score, &right_score)
+			|| hit_system< S >(duel, rules, &left_score, &right_score);
+	});
+	if (round_over) reset_players();
+}
+
+template void RewindSim::step_as< float >(uint8_t player_one_input, uint8_t player_two_input);
+template void RewindSim::step_as< Fixed >(uint8_t player_one_input, uint8_t player_two_input);
+
+void RewindSim::reset_players() {
+	PHASE_TIMER(PHASE_ROUND);
+	world.query< player_info, Spawn >([&](size_t count, Entity const *, player_info *players, Spawn *spawns) {
+		for (size_t i = 0; i < count; ++i) {
+			players[i].reset(spawns[i].head);
+		}
+	});
+	round += 1;
+}
+
+static_assert(std::is_trivially_copyable< RewindSnapshot::State >::value, "snapshot state must be copyable as raw bytes");
+
+void RewindSim::save(RewindSnapshot *into) const {
+	RewindSnapshot::State &state = into->state;
+	state.tick_rate = tick_rate;
+	state.exact_hits = exact_hits;
+	state.params = params;
+	state.round = round;
+	state.left_score = left_score;
+	state.right_score = right_score;
+	state.two_rewinders = two_rewinders;
+	std::memcpy(&state.players[0], static_cast< player_state const * >(&playerOne()), sizeof(player_state));
+	std::memcpy(&state.players[1], static_cast< player_state const * >(&playerTwo()), sizeof(player_state));
+	state.log_size[0] = uint32_t(playerOne().rewind_log.size());
+	state.log_size[1] = uint32_t(playerTwo().rewind_log.size());
+
+	into->tail.resize(state.log_size[0] + state.log_size[1]);
+	playerOne().rewind_log.copy_to(into->tail.data());
+	playerTwo().rewind_log.copy_to(into->tail.data() + state.log_size[0]);
+}
+
+void RewindSim::restore(RewindSnapshot const &from) {
+	RewindSnapshot::State const &state = from.state;
+	if (state.tick_rate != tick_rate
+	 || state.log_size[0] > rewind_log_size(state.params, tick_rate)
+	 || state.log_size[1] > rewind_log_size(state.params, tick_rate)
+	 || from.tail.size() != size_t(state.log_size[0]) + state.log_size[1]
+	 || state.players[0].palette >= PALETTES || state.players[1].palette >= PALETTES
+	 || state.exact_hits > HITS_SWEPT || state.two_rewinders > 1) {
+		throw std::runtime_error("Snapshot does not match this simulation (saved at " + std::to_string(state.tick_rate) + " ticks/second).");
+	}
+
+	exact_hits = state.exact_hits;
+	two_rewinders = state.two_rewinders;
+	if (std::memcmp(&params, &state.params, sizeof(RewindParams)) != 0) set_params(state.params);
+	round = state.round;
+	left_score = state.left_score;
+	right_score = state.right_score;
+	std::memcpy(static_cast< player_state * >(&playerOne()), &state.players[0], sizeof(player_state));
+	std::memcpy(static_cast< player_state * >(&playerTwo()), &state.players[1], sizeof(player_state));
+
+	playerOne().rewind_log.assign(from.tail.data(), state.log_size[0]);
+	playerTwo().rewind_log.assign(from.tail.data() + state.log_size[0], state.log_size[1]);
+}
@@ -0,0 +1,393 @@
+#pragma once
+
+//The game rules, with no SDL or OpenGL dependencies, so that matches can
+//be simulated by headless tools as well as by RewindMode.
+
+#include "RewindConstants.hpp"
+#include "PersistentLog.hpp"
+#include "SimScalar.hpp"
+#include "World.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+
+#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
+
+//Hit rules (RewindSim::exact_hits):
+#define HITS_TIP 0 //the original sword-tip test
+#define HITS_EXACT 1 //the whole sword against the whole body
+#define HITS_SWEPT 2 //the whole sword, swept through the tick's swing
+
+//Rewind logs hold one entry per tick, and a rewind stops once it has gone back max_rewind seconds
+//(after overshooting by at most one tick's worth, plus the entry it is blending toward), so older
+//entries can never be reached and the log is capped at this many entries:
+inline size_t rewind_log_size(RewindParams const &params, float tick_rate) {
+	return size_t(params.max_rewind * tick_rate + params.rewind_speed + 2);
+}
+
+//Names of the RewindParams fields, for setting them from command lines (e.g. "--param walk_speed=0.2"):
+struct RewindParamInfo {
+	char const *name;
+	float RewindParams::*value;
+};
+std::vector< RewindParamInfo > const &rewind_param_info();
+//Sets one field from "name=value" (throws if there is no such field or the value isn't a number):
+void set_rewind_param(RewindParams *params, std::string const &assignment);
+//Throws if any field is out of range (they must all be positive):
+void check_rewind_params(RewindParams const &params);
+
+//Shared, read-only tables that players refer to instead of each carrying a copy
+// (the tick loop never touches them, so they stay out of its cache lines):
+
+//Sizes of the body parts, the same for every player. Each is a half-size
+// (x, y) about the part's center, except the arms, which are (length,
+// thickness) from the shoulder, with the left arm's length negative:
+struct PlayerBody {
+	glm::vec2 head_radius = glm::vec2(0.5f, 0.5f);
+	glm::vec2 torso_radius = glm::vec2(0.20, 1.0f);
+	glm::vec2 left_arm_radius = glm::vec2(-1.25f, 0.4f);
+	glm::vec2 right_arm_radius = glm::vec2(1.25f, 0.4f);
+	glm::vec2 left_leg_radius = glm::vec2(0.10f, 1.0f);
+	glm::vec2 right_leg_radius = glm::vec2(0.10f, 1.0f);
+};
+extern PlayerBody const player_body;
+
+//A player's colors for each state they can be in, each as head, torso, arms, legs, sword:
+#define PALETTE_NORMAL 0 //Colors to show normally
+#define PALETTE_REWIND 1 //Colors to show when rewinding
+#define PALETTE_COOLDOWN 2 //Colors to show when cooling down
+struct PlayerPalette {
+	glm::u8vec4 colors[3][5];
+};
+//Indexed by player_state::palette:
+#define PALETTE_PLAYER_ONE 0 //blue
+#define PALETTE_PLAYER_TWO 1 //orange
+#define PALETTES 2
+extern PlayerPalette const player_palettes[PALETTES];
+
+//Everything about a player that changes during a match, except the rewind log:
+// only what the tick loop reads and writes, packed into 32 bytes (16-byte
+// aligned, the most that vectors of players are guaranteed before C++17, so
+// an array of them packs two to a cache line). Limb positions follow from the
+// head, and sizes and colors come from the tables above. This is trivially
+// copyable, so snapshots can save and restore it as raw bytes:
+struct alignas(16) player_state {
+
+	glm::vec2 head; //Coordinates
+	float left_arm_angle; //The current angle of the left arm
+	float right_arm_angle; //The current angle of the right arm
+
+	float seconds_passed = 0; //Seconds of history rewound so far (limited to max_rewind)
+	float rewind_offset = 0; //While rewinding, how far playback is from the newest log entry toward the next older one (0 to 1)
+	float seconds_cooldown = 0; //Used to keep track of the cooldown of the move
+
+	uint8_t sword_arm = 0; //PLAYER_ONE if the left player, PLAYER_TWO if the right player
+	uint8_t palette = 0; //Index into player_palettes
+
+	//Handles keyboard inputs and state. 0 if false, 1 if true
+	uint8_t left_walk : 1; //1 if holding down the left key, 0 otherwise
+	uint8_t right_walk : 1; //1 if holding down the right key, 0 otherwise
+	uint8_t is_attacking : 1; //1 if the sword will kill the other player, 0 otherwise
+	uint8_t is_rewinding : 1; //1 if rewinding time, 0 otherwise
+	uint8_t is_cooling : 1; //1 if the player cannot rewind time, 0 otherwise
+	uint8_t unused_flags : 3; //always 0 (named, so that copies carry every bit of the byte)
+	uint8_t reserved = 0; //always 0 (a base class's tail padding isn't copied along with it, so player_info copies would leave this byte behind if it were padding)
+
+	void update_coords(glm::vec2 head_coord) {
+		head = head_coord;
+	}
+
+	//Coordinates of the other body parts (centers; shoulders for the arms):
+	glm::vec2 torso() const {
+		return glm::vec2(head.x, head.y - 1.50f);
+	}
+	glm::vec2 left_arm() const {
+		glm::vec2 at = torso();
+		return glm::vec2(at.x - 0.2f, at.y + 0.4f);
+	}
+	glm::vec2 right_arm() const {
+		glm::vec2 at = torso();
+		return glm::vec2(at.x + 0.2f, at.y + 0.4f);
+	}
+	glm::vec2 left_leg() const {
+		glm::vec2 at = torso();
+		return glm::vec2(at.x - 0.2, at.y - 2.0f);
+	}
+	glm::vec2 right_leg() const {
+		glm::vec2 at = torso();
+		return glm::vec2(at.x + 0.2, at.y - 2.0f);
+	}
+
+	//The colors to draw the player with right now (head, torso, arms, legs, sword):
+	glm::u8vec4 const *colors() const {
+		int state = (is_rewinding ? PALETTE_REWIND : (is_cooling ? PALETTE_COOLDOWN : PALETTE_NORMAL));
+		return player_palettes[palette].colors[state];
+	}
+
+	//The angle of the arm holding the sword (the right arm for PLAYER_ONE, the left for PLAYER_TWO):
+	float sword_angle() const {
+		return (sword_arm == PLAYER_ONE ? right_arm_angle : left_arm_angle);
+	}
+	void set_sword_angle(float angle) {
+		if (sword_arm == PLAYER_ONE) right_arm_angle = angle;
+		else left_arm_angle = angle;
+	}
+
+	//Sets up a new player, facing right (PLAYER_ONE) or left (PLAYER_TWO):
+	// (zeroes the padding and the unused flag bits too, so that saved states compare equal byte for byte)
+	void init(glm::vec2 head_coord, int one_or_two, int palette_) {
+		std::memset(static_cast< void * >(this), 0, sizeof(player_state));
+		palette = uint8_t(palette_);
+
+		if (one_or_two == PLAYER_ONE) {
+			sword_arm = PLAYER_ONE;
+		} else if(one_or_two == PLAYER_TWO){
+			sword_arm = PLAYER_TWO;
+		}
+
+		reset(head_coord);
+	}
+
+	//Puts the player back in their starting state for a new round (except for the rewind log):
+	void reset(glm::vec2 head_coord) {
+		update_coords(head_coord);
+		left_arm_angle = 60;
+		right_arm_angle = -60;
+
+		left_walk = 0;
+	    right_walk = 0;
+		is_attacking = 0;
+		is_rewinding = 0;
+		is_cooling = 0;
+		seconds_passed = 0; 
+		rewind_offset = 0;
+		seconds_cooldown = 0;
+	}
+};
+static_assert(sizeof(player_state) == 32, "player_state should stay half a cache line");
+//Snapshots and hashes read player_state as raw bytes, so every byte must be a member (padding isn't copied reliably):
+static_assert(offsetof(player_state, reserved) == sizeof(player_state) - 1, "player_state should have no padding");
+
+//A player's rewind log (copying one is a branch that shares its entries; see PersistentLog.hpp):
+typedef PersistentLog< glm::vec4 > RewindLog;
+
+struct player_info : player_state {
+	RewindLog rewind_log = RewindLog(rewind_log_size(RewindParams(), TICK_RATE)); //Stores the position of the head, the current angle
+									  //of the sword arm, and whether or not the player was attacking
+
+	player_info(glm::vec2 head_coord, int one_or_two, int palette_ = PALETTE_PLAYER_ONE) {
+		init(head_coord, one_or_two, palette_);
+	}
+
+	//Puts the player back in their starting state for a new round.
+	//Unlike re-constructing the player, this does not allocate.
+	void reset(glm::vec2 head_coord) {
+		player_state::reset(head_coord);
+		rewind_log.clear(); 
+	}
+
+	//The parts of the state that move smoothly, for interpolating between ticks:
+	struct Pose {
+		glm::vec2 head;
+		float left_arm_angle;
+		float right_arm_angle;
+	};
+
+	Pose get_pose() const {
+		Pose pose;
+		pose.head = head;
+		pose.left_arm_angle = left_arm_angle;
+		pose.right_arm_angle = right_arm_angle;
+		return pose;
+	}
+
+	void set_pose(Pose const &pose) {
+		update_coords(pose.head);
+		left_arm_angle = pose.left_arm_angle;
+		right_arm_angle = pose.right_arm_angle;
+	}
+
+};
+
+//Helpers used by the rules (and by RewindMode for drawing):
+double get_sin(float angle);
+double get_cos(float angle);
+void get_sword_points(player_state const &player, float sword_tip_length, glm::vec2 points[]);
+
+//Per-player steps of the rules (shared by RewindSim and RewindArena):
+void apply_input(uint8_t input, player_state &player, int others_rewinding);
+void update_cooldown(player_state &player, float elapsed, RewindParams const &params);
+void update_swing(player_state &player, float ticks, RewindParams const &params);
+void update_movements(int right_or_left, int one_or_two, player_state &player,
+					  player_state const &other_player, glm::vec2 court_radius, float sword_tip_length, float walk, float max_dist);
+//Hit tests, 1 if 'player's sword hits 'other_player' (0 otherwise): the original
+// rules, the sword tip against the front edges of the head and torso; and the
+// exact ones, the whole sword against every body part (see Collision.hpp):
+int sword_tip_hits(player_state const &player, player_state const &other_player, float sword_tip_length);
+int sword_hits(player_state const &player, player_state const &other_player, float sword_tip_length);
+//The exact test over a whole tick's swing (see sweep_sword): 'swing_from' and 'was_attacking'
+// are the sword's angle and is_attacking from before this tick's update_swing, and '*time'
+// is how far through the swing the sword first touched (when it hits):
+int sword_sweep_hits(player_state const &player, float swing_from, uint32_t was_attacking, player_state const &other_player, float sword_tip_length, float *time);
+void update_rewind(player_info &player, float elapsed, RewindParams const &params);
+
+//When a player is rewinding time, this function checks whether
+//time's up (lol) and determines their new position/state.
+//'log' holds entries like player_info::rewind_log, newest first, one per tick
+//(a RingBuffer, or anything else with size(), front(), operator[] and pop_front(),
+//like RewindHistory). Since entry i is always i ticks older than the newest,
+//its time is implicit: playback moves 'speed' entries back per tick (any
+//positive factor, not just whole entries) and sits 'rewind_offset' of the way
+//from log.front() to the next older entry, blending the two.
+//'max_rewind' is how far back a rewind can go, in seconds of history.
+//This computes in the scalar type S (see SimScalar.hpp); update_rewind() below in float.
+template< typename S, typename Log >
+void update_rewind_as(player_state &player, Log &log, S elapsed, S speed, S max_rewind) {
+	typedef ScalarTraits< S > T;
+
+	//Entries passed entirely this tick, and how far toward the next one playback ends up:
+	S position = T::from_float(player.rewind_offset) + speed;
+	size_t skip = T::whole(position);
+	S offset = position - S(int(skip));
+
+	if (T::from_float(player.seconds_passed) < max_rewind && log.size() > skip + (offset > S(0) ? 1 : 0)) {
+			for (size_t i = 0; i < skip; ++i) {
+				log.pop_front();
+			}
+			glm::vec4 past_info = log.front();
+			S x = T::from_float(past_info.x);
+			S y = T::from_float(past_info.y);
+			S angle = T::from_float(past_info.z);
+			if (offset > S(0)) {
+				glm::vec4 older = log[1];
+				x = x + (T::from_float(older.x) - x) * offset;
+				y = y + (T::from_float(older.y) - y) * offset;
+				angle = angle + (T::from_float(older.z) - angle) * offset;
+				past_info.w = (offset < T::from_float(0.5f) ? past_info.w : older.w);
+			}
+			player.update_coords(glm::vec2(T::to_float(x), T::to_float(y)));
+			if (player.sword_arm == PLAYER_ONE) {
+				player.right_arm_angle = T::to_float(angle);
+			} else {
+				player.left_arm_angle = T::to_float(angle);
+			}
+			player.is_attacking = (int)past_info.w;
+			player.rewind_offset = T::to_float(offset);
+			player.seconds_passed = T::to_float(T::from_float(player.seconds_passed) + speed * elapsed);
+	} else {
+			player.is_rewinding = 0;
+			player.is_cooling = 1;
+			player.seconds_passed = 0;
+			player.rewind_offset = 0;
+	}
+}
+template< typename Log >
+void update_rewind(player_state &player, Log &log, float elapsed, float speed = REWIND_SPEED, float max_rewind = MAX_REWIND) {
+	update_rewind_as< float >(player, log, elapsed, speed, max_rewind);
+}
+
+//Everything that changes during a match, for save/load, lookahead, and rollback.
+// 'state' is plain bytes (copied in and out with memcpy); the rewind logs
+// follow in 'tail', which only holds the entries actually in use.
+// A snapshot can only be restored into a RewindSim with the same tick rate.
+struct RewindSnapshot {
+	struct State {
+		player_state players[2]; //(first, since they are 16-byte aligned)
+		float tick_rate;
+		uint32_t exact_hits;
+		RewindParams params;
+		uint32_t round;
+		uint32_t left_score;
+		uint32_t right_score;
+		uint32_t log_size[2]; //number of entries of each player's rewind log in 'tail'
+		uint32_t two_rewinders; //(also fills out the last 16 bytes, so State has no padding and can be compared with memcmp)
+	} state;
+	std::vector< glm::vec4 > tail; //player one's rewind log, then player two's (each newest first)
+};
+
+//A match's fighters are World entities with a player_info (their state and
+// rewind log) and these components; RewindSim::step runs the rules as systems
+// over the fighters' component arrays (see RewindSim.cpp), so new kinds of
+// things in a match are new sets of components plus the systems that query
+// for them, not new members and loops:
+
+//Where the fighter's head starts each round:
+struct Spawn {
+	glm::vec2 head;
+};
+
+//This tick's swing, for the swept hit test (written by the movement system before it moves the sword):
+struct Swing {
+	float from_angle = 0.0f; //the sword's angle before this tick's swing
+	uint32_t was_attacking = 0; //is_attacking before this tick's swing
+};
+
+struct RewindSim {
+	RewindSim(float tick_rate = TICK_RATE, RewindParams const &params = RewindParams());
+
+	//Advances the match by one tick, given the buttons each player is holding:
+	// (an attack starts if attack is held while the sword is at rest; a rewind
+	//  starts if rewind is held and allowed, and stops when rewind is released)
+	// The rules compute in SimScalar, chosen at build time (see SimScalar.hpp).
+	void step(uint8_t player_one_input, uint8_t player_two_input);
+	//The same, computing in S (float or Fixed) whatever this build chose:
+	template< typename S >
+	void step_as(uint8_t player_one_input, uint8_t player_two_input);
+
+	//Starts a new round:
+	void reset_players();
+
+	//Changes the rules constants (between matches: rewind logs are resized, which empties them if their size changes):
+	void set_params(RewindParams const &params);
+
+	//Copies the whole match into 'into' (does not allocate once 'into' has been used before):
+	void save(RewindSnapshot *into) const;
+	//Puts the match back the way it was when 'from' was saved:
+	// (throws if 'from' was saved from a RewindSim with a different tick rate; takes on its params)
+	void restore(RewindSnapshot const &from);
+
+	float tick_rate; //Ticks per second
+	float tick; //Seconds per tick (1.0f / tick_rate)
+
+	//Hit rules: HITS_TIP checks the sword tip against the front edges of the other
+	// player's head and torso (the original rules); HITS_EXACT checks the whole sword
+	// triangle against every part of the other player with Collision.hpp; HITS_SWEPT
+	// does the same for every angle the sword passed through this tick (so a fast
+	// swing or a low tick rate can't skip over anything), and if both swords land,
+	// only the one that got there first scores.
+	// (RewindBatch only implements the original rules.)
+	uint32_t exact_hits = HITS_TIP;
+	//Rewind rules: 0, the original rules, where a rewind can't start while the other
+	// player is rewinding; 1 lets both players rewind at once (each through their own
+	// log), and a time rift both of them cause scores for both, as a double hit does.
+	// (RewindBatch only implements the original rules.)
+	uint32_t two_rewinders = 0;
+	//Rules constants (change them with set_params, since rewind logs are sized from them):
+	RewindParams params;
+	uint32_t round = 0; //Incremented whenever a new round starts
+
+	glm::vec2 court_radius = glm::vec2(10.0f, 5.0f); 
+	uint32_t left_score = 0;
+	uint32_t right_score = 0;
+
+	float sword_tip_length = 2.0f;
+	glm::vec2 player_one_init = glm::vec2(-court_radius.x + 2.0f, 0.0f);
+	glm::vec2 player_two_init = glm::vec2(court_radius.x - 2.0f, 0.0f);
+
+	//The fighters (entities with a player_info, Spawn and Swing), in the order they
+	// act each tick (which is part of the rules: each walks up to where the ones before it ended up):
+	World world;
+	Entity fighters[2]; //player one (on the left), then player two (on the right)
+
+	player_info &playerOne() { return *world.get< player_info >(fighters[0]); }
+	player_info const &playerOne() const { return *world.get< player_info >(fighters[0]); }
+	player_info &playerTwo() { return *world.get< player_info >(fighters[1]); }
+	player_info const &playerTwo() const { return *world.get< player_info >(fighters[1]); }
+
+};
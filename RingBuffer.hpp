@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+//Fixed-capacity history buffer used for the rewind logs.
+// Entries are pushed and popped at the front (newest end), like the
+// std::deque it replaces; once the buffer is full, pushing overwrites the
+// oldest entry. Storage is allocated once, in the constructor.
+template< typename T >
+struct RingBuffer {
+	RingBuffer(size_t capacity_ = 1) : data(capacity_ > 0 ? capacity_ : 1) { }
+
+	//Adds a new entry; drops the oldest entry if the buffer is full:
+	void push_front(T const &value) {
+		first = (first == 0 ? data.size() : first) - 1;
+		data[first] = value;
+		if (count < data.size()) count += 1;
+	}
+
+	//Removes the newest entry:
+	void pop_front() {
+		assert(count > 0);
+		first += 1;
+		if (first == data.size()) first = 0;
+		count -= 1;
+	}
+
+	//Newest entry:
+	T const &front() const {
+		assert(count > 0);
+		return data[first];
+	}
+
+	//i'th newest entry (0 is the same as front()):
+	T const &operator[](size_t i) const {
+		assert(i < count);
+		size_t at = first + i;
+		if (at >= data.size()) at -= data.size();
+		return data[at];
+	}
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+	size_t capacity() const { return data.size(); }
+
+	//Copies all entries to 'out', newest first ('out' must have room for size() entries):
+	void copy_to(T *out) const {
+		size_t wrap = std::min(count, data.size() - first); //entries before the end of storage
+		std::copy(data.begin() + first, data.begin() + first + wrap, out);
+		std::copy(data.begin(), data.begin() + (count - wrap), out + wrap);
+	}
+
+	//Replaces all entries with the 'n' entries at 'in', newest first:
+	void assign(T const *in, size_t n) {
+		assert(n <= data.size());
+		std::copy(in, in + n, data.begin());
+		first = 0;
+		count = n;
+	}
+
+	//Forgets all entries (does not free storage):
+	void clear() {
+		first = 0;
+		count = 0;
+	}
+
+	std::vector< T > data;
+	size_t first = 0; //index of the newest entry
+	size_t count = 0; //number of valid entries
+};
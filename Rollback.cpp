@@ -0,0 +1,213 @@
+#include "Rollback.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+static char const PACKET_MAGIC[4] = {'R', 'W', 'N', '1'};
+//magic, uint32 ack (remote inputs received), uint32 first tick, uint8 count, then 'count' inputs:
+static size_t const PACKET_HEADER_SIZE = 4 + 4 + 4 + 1;
+static char const HELLO_MAGIC[4] = {'R', 'W', 'N', 'H'};
+//magic, float tick rate, uint32 hit rules, uint32 rewind rules, RewindParams, uint8 SIM_FIXED_POINT, uint8 whether the sender has the other side's hello:
+static size_t const HELLO_SIZE = 4 + 4 + 4 + 4 + sizeof(RewindParams) + 1 + 1;
+static_assert(sizeof(RewindParams) % sizeof(float) == 0, "RewindParams is sent as it is in memory (all floats, so no padding)");
+//Inputs are trimmed once at least this many are no longer needed:
+static uint32_t const ROLLBACK_TRIM_BATCH = 256;
+
+RollbackSession::RollbackSession(RewindSim *sim_, int local_player_) : sim(sim_), local_player(local_player_), frames(ROLLBACK_WINDOW) {
+	assert(sim);
+	assert(local_player == PLAYER_ONE || local_player == PLAYER_TWO);
+	//(so saving snapshots doesn't allocate during play)
+	for (auto &frame : frames) sim->save(&frame.before);
+}
+
+//Remote input for tick 't': the real one if it has arrived, otherwise a guess that the latest one is still held:
+uint8_t RollbackSession::remote_input_for(uint32_t t) const {
+	if (t < remote_confirmed) return remote_inputs[t - remote_base];
+	if (remote_confirmed == 0) return 0;
+	return remote_inputs[remote_confirmed - 1 - remote_base];
+}
+
+void RollbackSession::step(uint8_t local_input, uint8_t remote_input) {
+	if (local_player == PLAYER_ONE) {
+		sim->step(local_input, remote_input);
+	} else {
+		sim->step(remote_input, local_input);
+	}
+}
+
+bool RollbackSession::advance(uint8_t local_input) {
+	if (!started()) return false;
+	resolve();
+
+	if (tick >= remote_confirmed + ROLLBACK_WINDOW) {
+		stats.stalls += 1;
+		return false;
+	}
+
+	Frame &frame = frames[tick % ROLLBACK_WINDOW];
+	sim->save(&frame.before);
+	frame.remote_input = remote_input_for(tick);
+	local_inputs.emplace_back(local_input);
+	step(local_input, frame.remote_input);
+	tick += 1;
+	trim_inputs();
+	return true;
+}
+
+void RollbackSession::trim_inputs() {
+	//Re-simulating only goes back ROLLBACK_WINDOW ticks; packets resend local inputs
+	// from local_acknowledged on; and guesses repeat the latest remote input:
+	uint32_t oldest = (tick > ROLLBACK_WINDOW ? tick - ROLLBACK_WINDOW : 0);
+	uint32_t keep_local = std::min(oldest, local_acknowledged);
+	uint32_t keep_remote = std::min(oldest, remote_confirmed > 0 ? remote_confirmed - 1 : 0);
+
+	//(trimming in batches, so each tick doesn't shift the whole window down)
+	if (keep_local - local_base >= ROLLBACK_TRIM_BATCH) {
+		local_inputs.erase(local_inputs.begin(), local_inputs.begin() + (keep_local - local_base));
+		local_base = keep_local;
+	}
+	if (keep_remote - remote_base >= ROLLBACK_TRIM_BATCH) {
+		remote_inputs.erase(remote_inputs.begin(), remote_inputs.begin() + (keep_remote - remote_base));
+		remote_base = keep_remote;
+	}
+}
+
+void RollbackSession::resolve() {
+	if (rollback_from >= tick) {
+		rollback_from = UINT32_MAX;
+		return;
+	}
+	//advance() never gets further ahead of remote_confirmed than the window, and wrong guesses are all after it:
+	assert(tick - rollback_from <= ROLLBACK_WINDOW);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	sim->restore(frames[rollback_from % ROLLBACK_WINDOW].before);
+	for (uint32_t t = rollback_from; t < tick; ++t) {
+		Frame &frame = frames[t % ROLLBACK_WINDOW];
+		if (t != rollback_from) sim->save(&frame.before);
+		frame.remote_input = remote_input_for(t);
+		step(local_inputs[t - local_base], frame.remote_input);
+	}
+
+	double seconds = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+	uint32_t depth = tick - rollback_from;
+	stats.rollbacks += 1;
+	stats.last_depth = depth;
+	stats.max_depth = std::max(stats.max_depth, depth);
+	stats.total_depth += depth;
+	stats.last_resimulate_seconds = seconds;
+	stats.max_resimulate_seconds = std::max(stats.max_resimulate_seconds, seconds);
+	stats.total_resimulate_seconds += seconds;
+
+	rollback_from = UINT32_MAX;
+}
+
+RewindSnapshot const *RollbackSession::final_state(uint32_t t) const {
+	//(frames[t % ROLLBACK_WINDOW] holds the state after t ticks until tick t + ROLLBACK_WINDOW is simulated)
+	if (t >= tick || tick - t > ROLLBACK_WINDOW) return nullptr;
+	if (t > remote_confirmed || rollback_from < t) return nullptr;
+	return &frames[t % ROLLBACK_WINDOW].before;
+}
+
+void RollbackSession::write_packet(std::vector< uint8_t > *packet) const {
+	if (!started()) {
+		packet->resize(HELLO_SIZE);
+		uint8_t *at = packet->data();
+		std::memcpy(at, HELLO_MAGIC, 4);
+		std::memcpy(at + 4, &sim->tick_rate, 4);
+		std::memcpy(at + 8, &sim->exact_hits, 4);
+		std::memcpy(at + 12, &sim->two_rewinders, 4);
+		std::memcpy(at + 16, &sim->params, sizeof(RewindParams));
+		at[16 + sizeof(RewindParams)] = (SIM_FIXED_POINT ? 1 : 0);
+		at[17 + sizeof(RewindParams)] = (have_hello ? 1 : 0);
+		return;
+	}
+
+	uint32_t first = local_acknowledged;
+	uint32_t count = std::min(tick - first, uint32_t(ROLLBACK_MAX_PACKET_INPUTS));
+
+	packet->resize(PACKET_HEADER_SIZE + count);
+	uint8_t *at = packet->data();
+	std::memcpy(at, PACKET_MAGIC, 4);
+	std::memcpy(at + 4, &remote_confirmed, 4);
+	std::memcpy(at + 8, &first, 4);
+	at[12] = uint8_t(count);
+	if (count) std::memcpy(at + PACKET_HEADER_SIZE, local_inputs.data() + (first - local_base), count);
+}
+
+bool RollbackSession::read_packet(uint8_t const *data, size_t size) {
+	if (size == HELLO_SIZE && std::memcmp(data, HELLO_MAGIC, 4) == 0) {
+		read_hello(data);
+		return true;
+	}
+	if (size < PACKET_HEADER_SIZE || std::memcmp(data, PACKET_MAGIC, 4) != 0) return false;
+	//(inputs only come once the remote side has our hello, and are no use before we have theirs)
+	if (!have_hello) return true;
+	remote_has_hello = true;
+	uint32_t ack, first;
+	std::memcpy(&ack, data + 4, 4);
+	std::memcpy(&first, data + 8, 4);
+	uint32_t count = data[12];
+	if (size != PACKET_HEADER_SIZE + count) return false;
+
+	//(packets may arrive out of order, so only ever move forward)
+	if (ack > local_acknowledged && ack <= tick) local_acknowledged = ack;
+
+	uint8_t const *inputs = data + PACKET_HEADER_SIZE;
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t t = first + i;
+		if (t < remote_confirmed) continue; //already have it
+		if (t > remote_confirmed) break; //a gap; a later packet will fill it in
+
+		uint8_t input = inputs[i];
+		if (t < tick && input != frames[t % ROLLBACK_WINDOW].remote_input) {
+			rollback_from = std::min(rollback_from, t);
+		}
+		remote_inputs.emplace_back(input);
+		remote_confirmed += 1;
+	}
+	return true;
+}
+
+void RollbackSession::read_hello(uint8_t const *data) {
+	float tick_rate;
+	uint32_t exact_hits;
+	uint32_t two_rewinders;
+	RewindParams params;
+	std::memcpy(&tick_rate, data + 4, 4);
+	std::memcpy(&exact_hits, data + 8, 4);
+	std::memcpy(&two_rewinders, data + 12, 4);
+	std::memcpy(&params, data + 16, sizeof(RewindParams));
+
+	std::ostringstream differences;
+	if (tick_rate != sim->tick_rate) {
+		differences << " tick rate " << sim->tick_rate << " here, " << tick_rate << " there;";
+	}
+	uint8_t fixed_point = data[16 + sizeof(RewindParams)];
+	if (fixed_point != (SIM_FIXED_POINT ? 1 : 0)) {
+		//(float and fixed point builds play slightly different matches)
+		differences << " " << (SIM_FIXED_POINT ? "fixed point" : "floats") << " here, " << (fixed_point ? "fixed point" : "floats") << " there;";
+	}
+	if (exact_hits != sim->exact_hits) {
+		differences << " hit rules " << sim->exact_hits << " here, " << exact_hits << " there;";
+	}
+	if (two_rewinders != sim->two_rewinders) {
+		differences << " two rewinders " << sim->two_rewinders << " here, " << two_rewinders << " there;";
+	}
+	for (auto const &info : rewind_param_info()) {
+		if (params.*info.value != sim->params.*info.value) {
+			differences << " " << info.name << " " << sim->params.*info.value << " here, " << params.*info.value << " there;";
+		}
+	}
+	if (!differences.str().empty()) {
+		std::string list = differences.str();
+		refused = "The other player's rules differ:" + list.substr(0, list.size() - 1) + ".";
+		return;
+	}
+	if (refused.empty()) have_hello = true;
+	if (data[17 + sizeof(RewindParams)]) remote_has_hello = true;
+}
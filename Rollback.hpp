@@ -0,0 +1,106 @@
+#pragma once
+
+//Rollback netcode for online play.
+// Each machine simulates the match as soon as its own player's input is
+// known, guessing that the remote player is still holding whatever they held
+// last. When the remote input for a tick arrives and turns out to differ from
+// the guess, the match is restored to a snapshot from before that tick and
+// re-simulated with the real inputs.
+//
+// RollbackSession doesn't do any networking itself; it reads and writes the
+// packets that carry inputs (see UdpLink.hpp for something to send them with).
+//
+// Before any inputs, the two sides swap hellos with the rules they will play by
+// (tick rate, hit rules and RewindParams); if those differ, the session refuses
+// to start, since the two matches would drift apart from the first tick.
+
+#include "RewindSim.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//Furthest (in ticks) the local simulation may run ahead of the last confirmed remote input:
+#define ROLLBACK_WINDOW 16
+
+//Most inputs sent in one packet:
+#define ROLLBACK_MAX_PACKET_INPUTS 64
+
+struct RollbackStats {
+	uint32_t rollbacks = 0; //number of times the match was re-simulated
+	uint32_t last_depth = 0; //ticks re-simulated by the latest rollback
+	uint32_t max_depth = 0;
+	uint64_t total_depth = 0;
+	double last_resimulate_seconds = 0.0; //time spent in the latest rollback
+	double max_resimulate_seconds = 0.0;
+	double total_resimulate_seconds = 0.0;
+	uint32_t stalls = 0; //ticks that couldn't be simulated because the remote player was too far behind
+};
+
+struct RollbackSession {
+	//'sim' is the match to run; 'local_player' is PLAYER_ONE or PLAYER_TWO:
+	RollbackSession(RewindSim *sim, int local_player);
+
+	//Simulates the next tick with the local player's input (and a guess for the
+	// remote player's); returns false (and does nothing) if the session hasn't
+	// started yet, or if the remote player is so far behind that the tick would
+	// be outside the rollback window:
+	bool advance(uint8_t local_input);
+
+	//Whether both sides have each other's hello, so inputs are being exchanged:
+	bool started() const { return have_hello && remote_has_hello; }
+	//Set (and the session never starts) if the remote side's rules differ from 'sim's; says how:
+	std::string refused;
+
+	//Re-simulates now if a remote input has disagreed with a guess:
+	// (advance() also does this, so this is only needed to look at the corrected match early)
+	void resolve();
+
+	//The match as it was after 't' ticks, once no remote input can change it
+	// (nullptr if it still might change, or is too old to still be kept):
+	RewindSnapshot const *final_state(uint32_t t) const;
+
+	//Packets:
+	// Packets carry every local input the remote side hasn't acknowledged yet
+	// (up to ROLLBACK_MAX_PACKET_INPUTS), so lost packets don't need resending.
+	// Until the session has started they are hellos instead, sent every time
+	// for the same reason.
+	void write_packet(std::vector< uint8_t > *packet) const;
+	//Returns false if the packet isn't a rollback packet:
+	bool read_packet(uint8_t const *data, size_t size);
+
+	RewindSim *sim;
+	int local_player;
+
+	bool have_hello = false; //the remote side's hello arrived (and its rules match)
+	bool remote_has_hello = false; //the remote side has ours (it said so, or it is sending inputs)
+
+	uint32_t tick = 0; //ticks simulated so far
+	uint32_t remote_confirmed = 0; //remote inputs are known for ticks before this
+	uint32_t local_acknowledged = 0; //the remote side has local inputs for ticks before this
+
+	//Inputs that may still be needed (for re-simulating, guessing, or resending),
+	// with older ones trimmed off the front; local_inputs[t - local_base] is the
+	// local input for tick t, and likewise for remote_inputs:
+	std::vector< uint8_t > local_inputs; //for ticks local_base to tick
+	std::vector< uint8_t > remote_inputs; //for ticks remote_base to remote_confirmed
+	uint32_t local_base = 0;
+	uint32_t remote_base = 0;
+
+	//what each of the last ROLLBACK_WINDOW ticks started from, at [tick % ROLLBACK_WINDOW]:
+	struct Frame {
+		RewindSnapshot before;
+		uint8_t remote_input; //input used for the remote player (maybe a guess)
+	};
+	std::vector< Frame > frames;
+
+	uint32_t rollback_from = UINT32_MAX; //earliest tick simulated with a wrong guess
+
+	RollbackStats stats;
+
+	uint8_t remote_input_for(uint32_t t) const;
+	void read_hello(uint8_t const *data);
+	void step(uint8_t local_input, uint8_t remote_input);
+	//Drops inputs from before the rollback window that can no longer be re-simulated, resent, or guessed from:
+	void trim_inputs();
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+//The scalar type the rules compute in, chosen at build time.
+//
+// Floating point results depend on the compiler, the optimization level and
+// the floating point unit (x87 or SSE, fused multiply-adds, -ffast-math), so
+// two builds can disagree about a match, which breaks replays and netcode
+// between them. Built with SIM_FIXED_POINT=1 ('jam -sSIM_FIXED_POINT=1'),
+// RewindSim::step computes everything in 16.16 fixed point (Fixed.hpp, with
+// integer trig from DegreeTrig), so every such build agrees bit for bit;
+// otherwise it uses floats, as it always has.
+//
+// Players keep their state in floats either way (so snapshots, replays, hashes
+// and drawing don't change): every value the fixed point rules produce is a
+// multiple of 2^-16, and the ones a match sees are well under 256, which a
+// float holds exactly, so converting on the way in and out loses nothing.
+//
+// Both versions of the rules are always compiled in (RewindSim::step_as< S >),
+// so 'rewind-bench fixed' can check and race them in any build.
+// (The exact and swept hit tests, and RewindBatch and RewindArena, stay float.)
+
+#include "Fixed.hpp"
+#include "DegreeTrig.hpp"
+
+#include <cstddef>
+
+#ifndef SIM_FIXED_POINT
+#define SIM_FIXED_POINT 0
+#endif
+
+//What the rules need to know about a scalar type:
+template< typename S >
+struct ScalarTraits;
+
+template< >
+struct ScalarTraits< float > {
+	typedef double Wide; //sword geometry is done in double, as get_sin / get_cos return it
+	static float from_float(float value) { return value; }
+	static float to_float(float value) { return value; }
+	static Wide widen(float value) { return value; }
+	static float narrow(Wide value) { return float(value); }
+	static Wide sin(float angle) { return sin_degrees(angle); }
+	static Wide cos(float angle) { return cos_degrees(angle); }
+	static size_t whole(float value) { return size_t(value); } //(value >= 0)
+};
+
+template< >
+struct ScalarTraits< Fixed > {
+	typedef Fixed Wide;
+	static Fixed from_float(float value) { return Fixed::from_float(value); }
+	static float to_float(Fixed value) { return value.to_float(); }
+	static Wide widen(Fixed value) { return value; }
+	static Fixed narrow(Wide value) { return value; }
+	static Wide sin(Fixed angle) { return sin_degrees(angle); }
+	static Wide cos(Fixed angle) { return cos_degrees(angle); }
+	static size_t whole(Fixed value) { return size_t(value.raw >> 16); } //(value >= 0)
+};
+
+#if SIM_FIXED_POINT
+typedef Fixed SimScalar;
+#else
+typedef float SimScalar;
+#endif
@@ -0,0 +1,185 @@
+#include "StateHash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static char const MAGIC[4] = {'R', 'W', 'H', 'S'};
+static uint32_t const VERSION = 2;
+
+static_assert(sizeof(player_state) == 32, "hash_player reads player_state as four 64-bit words");
+static_assert(sizeof(RewindParams) == 32, "hash_match reads RewindParams as four 64-bit words");
+
+namespace {
+
+//Mixes one 64-bit word with a key saying where it came from, for the field hashes:
+// a single multiply (each field only has to tell its own values apart), and
+// independent of the other words, so a whole state mixes in parallel:
+inline uint64_t mix(uint64_t word, uint64_t key) {
+	return (word ^ (key << 56)) * 0x9e3779b97f4a7c15ull;
+}
+
+//Thoroughly scrambles a word (splitmix64's finalizer), for the chain:
+inline uint64_t scramble(uint64_t h) {
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+	return h ^ (h >> 31);
+}
+
+inline uint32_t fold(uint64_t h) {
+	return uint32_t(h ^ (h >> 32));
+}
+
+inline uint64_t pack(uint32_t low, uint32_t high) {
+	return uint64_t(low) | (uint64_t(high) << 32);
+}
+
+inline uint32_t bits(float value) { //(bit for bit: the processes being compared should agree exactly)
+	uint32_t word;
+	std::memcpy(&word, &value, 4);
+	return word;
+}
+
+//Hashes one player's field groups into fields[first ... first + 4].
+// player_state is canonical byte for byte (its padding and unused bits are always
+// zero), so it is hashed as raw words: head, arm angles, the rewind timers, then
+// the cooldown timer alongside the flag bytes (sword arm, palette, and flags):
+inline void hash_player(player_state const &player, uint32_t log_size, glm::vec4 const *newest, uint32_t *fields, uint32_t first) {
+	uint64_t words[4];
+	std::memcpy(words, &player, sizeof(words));
+	fields[first] = fold(mix(words[0], first));
+	fields[first + 1] = fold(mix(words[1], first + 1));
+	fields[first + 2] = fold(mix(words[3] >> 32, first + 2));
+	fields[first + 3] = fold(mix(words[2], first + 3) ^ mix(words[3] & 0xffffffffull, first + 3 + HASH_FIELDS));
+
+	uint64_t history = mix(log_size, first + 4);
+	if (newest) {
+		history ^= mix(pack(bits(newest->x), bits(newest->y)), first + 4 + HASH_FIELDS);
+		history ^= mix(pack(bits(newest->z), bits(newest->w)), first + 4 + 2 * HASH_FIELDS);
+	}
+	fields[first + 4] = fold(history);
+}
+
+uint32_t hash_match(float tick_rate, uint32_t exact_hits, uint32_t two_rewinders, RewindParams const &params, uint32_t round, uint32_t left_score, uint32_t right_score) {
+	uint64_t words[4];
+	std::memcpy(words, &params, sizeof(words));
+	uint64_t h = mix(pack(bits(tick_rate), exact_hits | (two_rewinders << 8)), HASH_MATCH); //(so matches by the original rewind rules hash as they always have)
+	for (uint32_t i = 0; i < 4; ++i) {
+		h ^= mix(words[i], HASH_MATCH + (i + 1) * HASH_FIELDS);
+	}
+	h ^= mix(pack(round, left_score), HASH_MATCH + 5 * HASH_FIELDS);
+	h ^= mix(right_score, HASH_MATCH + 6 * HASH_FIELDS);
+	return fold(h);
+}
+
+//Chains the field hashes onto the previous tick's chain (the fields are
+// combined with independent multiplies, then scrambled once along with 'previous'):
+void finish(StateHash &hash, uint64_t previous) {
+	static uint64_t const odd[(HASH_FIELDS + 1) / 2] = {
+		0xd6e8feb86659fd93ull, 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+		0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull, 0x1d8e4e27c47d124full,
+	};
+	uint64_t combined = 0;
+	for (uint32_t f = 0; f < HASH_FIELDS; f += 2) {
+		combined += pack(hash.fields[f], f + 1 < HASH_FIELDS ? hash.fields[f + 1] : 0) * odd[f / 2];
+	}
+	hash.chain = scramble(scramble(previous) ^ combined);
+}
+
+}
+
+char const *hash_field_name(uint32_t field) {
+	static char const *names[HASH_FIELDS] = {
+		"rules/round/scores",
+		"player one position", "player one arms", "player one flags", "player one timers", "player one rewind log",
+		"player two position", "player two arms", "player two flags", "player two timers", "player two rewind log",
+	};
+	return field < HASH_FIELDS ? names[field] : "?";
+}
+
+StateHash hash_state(RewindSim const &sim, uint64_t previous) {
+	StateHash hash;
+	hash.fields[HASH_MATCH] = hash_match(sim.tick_rate, sim.exact_hits, sim.two_rewinders, sim.params, sim.round, sim.left_score, sim.right_score);
+	player_info const &one = sim.playerOne();
+	player_info const &two = sim.playerTwo();
+	hash_player(one, uint32_t(one.rewind_log.size()), one.rewind_log.empty() ? nullptr : &one.rewind_log.front(), hash.fields, HASH_ONE_POSITION);
+	hash_player(two, uint32_t(two.rewind_log.size()), two.rewind_log.empty() ? nullptr : &two.rewind_log.front(), hash.fields, HASH_TWO_POSITION);
+	finish(hash, previous);
+	return hash;
+}
+
+StateHash hash_state(RewindSnapshot const &snapshot, uint64_t previous) {
+	RewindSnapshot::State const &state = snapshot.state;
+	StateHash hash;
+	hash.fields[HASH_MATCH] = hash_match(state.tick_rate, state.exact_hits, state.two_rewinders, state.params, state.round, state.left_score, state.right_score);
+	glm::vec4 const *tail = snapshot.tail.data();
+	hash_player(state.players[0], state.log_size[0], state.log_size[0] ? tail : nullptr, hash.fields, HASH_ONE_POSITION);
+	hash_player(state.players[1], state.log_size[1], state.log_size[1] ? tail + state.log_size[0] : nullptr, hash.fields, HASH_TWO_POSITION);
+	finish(hash, previous);
+	return hash;
+}
+
+//----------------------------------------------------------
+
+StateHashWriter::StateHashWriter(std::string const &filename_) : filename(filename_), file(filename_.c_str(), std::ios::binary) {
+	if (!file) {
+		throw std::runtime_error("Failed to open hash log '" + filename + "' for writing.");
+	}
+	uint32_t fields = HASH_FIELDS;
+	file.write(MAGIC, 4);
+	file.write(reinterpret_cast< char const * >(&VERSION), 4);
+	file.write(reinterpret_cast< char const * >(&fields), 4);
+}
+
+void StateHashWriter::record(RewindSim const &sim) {
+	write(hash_state(sim, chain));
+}
+
+void StateHashWriter::record(RewindSnapshot const &snapshot) {
+	write(hash_state(snapshot, chain));
+}
+
+void StateHashWriter::write(StateHash const &hash) {
+	file.write(reinterpret_cast< char const * >(&hash.chain), 8);
+	file.write(reinterpret_cast< char const * >(hash.fields), 4 * HASH_FIELDS);
+	chain = hash.chain;
+	ticks += 1;
+}
+
+std::vector< StateHash > read_hash_log(std::string const &filename) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open hash log '" + filename + "'.");
+	}
+	char magic[4];
+	uint32_t version = 0, fields = 0;
+	file.read(magic, 4);
+	file.read(reinterpret_cast< char * >(&version), 4);
+	file.read(reinterpret_cast< char * >(&fields), 4);
+	if (!file || std::memcmp(magic, MAGIC, 4) != 0 || version != VERSION || fields != HASH_FIELDS) {
+		throw std::runtime_error("'" + filename + "' is not a hash log (or is from a different version).");
+	}
+
+	std::vector< StateHash > hashes;
+	StateHash hash;
+	while (file.read(reinterpret_cast< char * >(&hash.chain), 8) && file.read(reinterpret_cast< char * >(hash.fields), 4 * HASH_FIELDS)) {
+		hashes.emplace_back(hash);
+	}
+	return hashes;
+}
+
+bool find_desync(std::vector< StateHash > const &a, std::vector< StateHash > const &b, Desync *desync) {
+	size_t count = std::min(a.size(), b.size());
+	for (size_t t = 0; t < count; ++t) {
+		if (a[t].chain == b[t].chain) continue;
+		if (desync) {
+			desync->tick = uint32_t(t + 1);
+			desync->fields = 0;
+			for (uint32_t f = 0; f < HASH_FIELDS; ++f) {
+				if (a[t].fields[f] != b[t].fields[f]) desync->fields |= (1u << f);
+			}
+		}
+		return true;
+	}
+	return false;
+}
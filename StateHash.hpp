@@ -0,0 +1,86 @@
+#pragma once
+
+//Per-tick hashes of the match state, for checking that several processes
+// running the same match (players, recorders, replay viewers) agree.
+//
+// Every tick gets a StateHash: a small hash of each group of fields (so a
+// mismatch can say what differs), and a 64-bit 'chain' hash of those and the
+// previous tick's chain. Rewind logs are covered through the chain: each
+// tick hashes their sizes and newest entries, and every older entry was the
+// newest entry on some earlier tick. So the first tick whose chains differ
+// is the first tick the matches differed on.
+//
+// Hashes are of the canonical state -- the numbers that drive the rules, bit
+// for bit -- not of colors or other derived values. Each player_state is
+// hashed as its raw 32 bytes, one independent multiply per 64-bit word, and
+// only the chain is scrambled thoroughly; hashing takes about 30-50ns a tick,
+// a third to a half of a step (see rewind-bench hash).
+//
+// Hash logs (written with --hash-log, compared with rewind-desync):
+//  header:   "RWHS", uint32 version, uint32 HASH_FIELDS
+//  records:  one per tick (the state after that many ticks, starting with 1):
+//            uint64 chain, uint32 fields[HASH_FIELDS]
+
+#include "RewindSim.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//Groups of fields hashed separately:
+enum {
+	HASH_MATCH, //rules, round and scores
+	HASH_ONE_POSITION, //player one's head
+	HASH_ONE_ARMS, //player one's arm angles
+	HASH_ONE_FLAGS, //player one's walking/attacking/rewinding/cooling flags (and sword arm and palette)
+	HASH_ONE_TIMERS, //player one's rewind and cooldown timers
+	HASH_ONE_HISTORY, //player one's rewind log (size and newest entry)
+	HASH_TWO_POSITION,
+	HASH_TWO_ARMS,
+	HASH_TWO_FLAGS,
+	HASH_TWO_TIMERS,
+	HASH_TWO_HISTORY,
+	HASH_FIELDS
+};
+
+//Name of a field group, for reports:
+char const *hash_field_name(uint32_t field);
+
+struct StateHash {
+	uint64_t chain = 0;
+	uint32_t fields[HASH_FIELDS] = { };
+};
+
+//Hashes a match, chained onto the previous tick's hash ('previous' is 0 before the first tick):
+StateHash hash_state(RewindSim const &sim, uint64_t previous);
+//The same, for a match saved in a snapshot (gives the same hash as the RewindSim it was saved from):
+StateHash hash_state(RewindSnapshot const &snapshot, uint64_t previous);
+
+//Writes one StateHash per tick to a hash log:
+struct StateHashWriter {
+	//Starts a hash log (throws if the file can't be opened):
+	StateHashWriter(std::string const &filename);
+
+	//Hashes the match (call once per tick, after stepping) and writes the result:
+	void record(RewindSim const &sim);
+	void record(RewindSnapshot const &snapshot);
+	void write(StateHash const &hash);
+
+	std::string filename;
+	std::ofstream file;
+	uint64_t chain = 0; //latest hash written
+	uint32_t ticks = 0; //number of hashes written
+};
+
+//Reads a whole hash log (throws if it can't be read or doesn't look right):
+std::vector< StateHash > read_hash_log(std::string const &filename);
+
+//Where two runs of a match first disagree:
+struct Desync {
+	uint32_t tick = 0; //first tick (counting from 1) whose hashes differ
+	uint32_t fields = 0; //bit i set if field group i differs on that tick
+};
+
+//Compares per-tick hashes 'a' and 'b' (over the ticks both have); returns false if they agree:
+bool find_desync(std::vector< StateHash > const &a, std::vector< StateHash > const &b, Desync *desync);
@@ -0,0 +1,69 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threads) {
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	workers.reserve(threads - 1);
+	for (uint32_t t = 1; t < threads; ++t) {
+		workers.emplace_back(&ThreadPool::work, this, t);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	start.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::run(size_t count_, std::function< void(size_t, uint32_t) > const &job_) {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		job = &job_;
+		count = count_;
+		next = 0;
+		busy = uint32_t(workers.size());
+		generation += 1;
+	}
+	start.notify_all();
+
+	//the calling thread helps out:
+	while (true) {
+		size_t index;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			if (next >= count) break;
+			index = next++;
+		}
+		job_(index, 0);
+	}
+
+	std::unique_lock< std::mutex > lock(mutex);
+	finish.wait(lock, [this](){ return busy == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::work(uint32_t thread) {
+	uint32_t seen = 0;
+	std::unique_lock< std::mutex > lock(mutex);
+	while (true) {
+		start.wait(lock, [&](){ return quit || generation != seen; });
+		if (quit) return;
+		seen = generation;
+
+		while (next < count) {
+			size_t index = next++;
+			lock.unlock();
+			(*job)(index, thread);
+			lock.lock();
+		}
+
+		busy -= 1;
+		if (busy == 0) finish.notify_one();
+	}
+}
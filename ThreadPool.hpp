@@ -0,0 +1,43 @@
+#pragma once
+
+//A fixed set of worker threads for running many small independent jobs at once.
+// run() hands out job indices to the workers (and the calling thread) until
+// all are done, then returns; there is no per-job allocation.
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPool {
+	//'threads' counts the thread calling run(); 0 means one per hardware thread:
+	ThreadPool(uint32_t threads = 0);
+	~ThreadPool();
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool &operator=(ThreadPool const &) = delete;
+
+	//Calls job(index, thread) for every index in [0, count), spread over the threads,
+	// and returns once they have all finished. 'thread' is in [0, size()), so jobs
+	// can use it to pick per-thread scratch space.
+	void run(size_t count, std::function< void(size_t index, uint32_t thread) > const &job);
+
+	uint32_t size() const { return uint32_t(workers.size()) + 1; }
+
+private:
+	void work(uint32_t thread);
+
+	std::vector< std::thread > workers;
+
+	std::mutex mutex;
+	std::condition_variable start; //signalled when a new run() begins (or on shutdown)
+	std::condition_variable finish; //signalled when the last worker leaves a run()
+	std::function< void(size_t, uint32_t) > const *job = nullptr;
+	size_t count = 0;
+	size_t next = 0; //next index to hand out
+	uint32_t generation = 0; //incremented by every run()
+	uint32_t busy = 0; //workers still in the current run()
+	bool quit = false;
+};
@@ -0,0 +1,63 @@
+#include "Timeline.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+Timeline::Timeline(RewindSim const &sim) : checkpoint_interval(std::max(1u, uint32_t(TIMELINE_CHECKPOINT_SECONDS * sim.tick_rate))) {
+	checkpoints.emplace_back();
+	checkpoints.back().tick = 0;
+	sim.save(&checkpoints.back().snapshot);
+}
+
+void Timeline::record(RewindSim const &sim, uint8_t player_one_input, uint8_t player_two_input) {
+	uint32_t t = tick_count();
+	if (t == checkpoints.back().tick) {
+		//(re-save in case the match was changed since: e.g., its params set after the Timeline was made)
+		sim.save(&checkpoints.back().snapshot);
+	} else if (t - checkpoints.back().tick >= checkpoint_interval) {
+		checkpoints.emplace_back();
+		checkpoints.back().tick = t;
+		sim.save(&checkpoints.back().snapshot);
+	}
+	inputs.emplace_back(uint8_t((player_one_input & 0xf) | ((player_two_input & 0xf) << 4)));
+	tick = t + 1;
+}
+
+void Timeline::seek(RewindSim *sim, uint32_t to) {
+	assert(sim);
+	assert(!checkpoints.empty());
+	to = std::min(to, tick_count());
+
+	//last checkpoint at or before 'to':
+	auto after = std::upper_bound(checkpoints.begin(), checkpoints.end(), to, [](uint32_t t, Checkpoint const &c){
+		return t < c.tick;
+	});
+	assert(after != checkpoints.begin());
+	Checkpoint const &checkpoint = *(after - 1);
+
+	//(stepping forward a little from where 'sim' already is beats restoring)
+	if (!(tick >= checkpoint.tick && tick <= to)) {
+		sim->restore(checkpoint.snapshot);
+		tick = checkpoint.tick;
+	}
+	for (; tick < to; ++tick) {
+		sim->step(player_one_input(tick), player_two_input(tick));
+	}
+}
+
+void Timeline::truncate(uint32_t from) {
+	if (from >= tick_count()) return;
+	inputs.resize(from);
+	while (checkpoints.back().tick > from) { //(the checkpoint at tick 0 always stays)
+		checkpoints.pop_back();
+	}
+	tick = std::min(tick, from);
+}
+
+size_t Timeline::bytes_used() const {
+	size_t bytes = inputs.capacity() + checkpoints.capacity() * sizeof(Checkpoint);
+	for (auto const &checkpoint : checkpoints) {
+		bytes += checkpoint.snapshot.tail.capacity() * sizeof(glm::vec4);
+	}
+	return bytes;
+}
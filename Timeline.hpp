@@ -0,0 +1,53 @@
+#pragma once
+
+//In-memory record of a whole session, for scrubbing back and forth through it
+// (the time-travel debugger in RewindMode).
+//
+// Like a replay, it keeps every tick's inputs plus periodic checkpoints (full
+// RewindSnapshots), but in memory and densely -- one every
+// TIMELINE_CHECKPOINT_SECONDS -- so a seek restores the nearest checkpoint at
+// or before the target and re-simulates at most that many seconds of ticks,
+// however long the session has been.
+
+#include "RewindSim.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#define TIMELINE_CHECKPOINT_SECONDS 1.0f
+
+struct Timeline {
+	//Starts recording from 'sim' as it is now (tick 0), so there is always a checkpoint to seek to:
+	Timeline(RewindSim const &sim);
+
+	//Records one tick; call just before sim.step() with the same inputs:
+	void record(RewindSim const &sim, uint8_t player_one_input, uint8_t player_two_input);
+
+	//Number of ticks recorded (so the ticks that can be sought to are 0 ... tick_count()):
+	uint32_t tick_count() const { return uint32_t(inputs.size()); }
+
+	//Puts 'sim' (which must have been made with the same tick rate) in the state it was
+	// in just before tick 'to' (clamped to tick_count()) was recorded:
+	void seek(RewindSim *sim, uint32_t to);
+	//Tick 'sim' was last put at by seek():
+	uint32_t tick = 0;
+
+	//Forgets everything from tick 'from' on, so recording can continue from there:
+	void truncate(uint32_t from);
+
+	//Inputs recorded for tick 't':
+	uint8_t player_one_input(uint32_t t) const { return inputs[t] & 0xf; }
+	uint8_t player_two_input(uint32_t t) const { return inputs[t] >> 4; }
+
+	//Memory used by checkpoints and inputs:
+	size_t bytes_used() const;
+
+	uint32_t checkpoint_interval; //ticks
+
+	struct Checkpoint {
+		uint32_t tick;
+		RewindSnapshot snapshot;
+	};
+	std::vector< Checkpoint > checkpoints; //in tick order
+	std::vector< uint8_t > inputs; //player_one | player_two << 4, per tick
+};
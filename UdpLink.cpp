@@ -0,0 +1,141 @@
+#include "UdpLink.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+static void close_socket(intptr_t s) { closesocket(SOCKET(s)); }
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+static void close_socket(intptr_t s) { close(int(s)); }
+#endif
+
+static_assert(sizeof(sockaddr_in) <= sizeof(UdpLink::peer), "peer must be able to hold a sockaddr_in");
+
+UdpLink::UdpLink(uint16_t port) {
+#ifdef _WIN32
+	static bool started = false;
+	if (!started) {
+		WSADATA wsa;
+		if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) throw std::runtime_error("Failed to start winsock.");
+		started = true;
+	}
+	SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET) throw std::runtime_error("Failed to create UDP socket.");
+	socket = intptr_t(s);
+	u_long non_blocking = 1;
+	ioctlsocket(s, FIONBIO, &non_blocking);
+#else
+	int s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0) throw std::runtime_error("Failed to create UDP socket.");
+	socket = s;
+	fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(s, reinterpret_cast< sockaddr * >(&address), sizeof(address)) != 0) {
+		close_socket(socket);
+		throw std::runtime_error("Failed to bind UDP port " + std::to_string(port) + ".");
+	}
+	socklen_t length = sizeof(address);
+	getsockname(s, reinterpret_cast< sockaddr * >(&address), &length);
+	local_port = ntohs(address.sin_port);
+}
+
+UdpLink::~UdpLink() {
+	if (socket != -1) close_socket(socket);
+	socket = -1;
+}
+
+void UdpLink::connect(std::string const &host, uint16_t port) {
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *found = nullptr;
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || !found) {
+		throw std::runtime_error("Failed to look up '" + host + "'.");
+	}
+	sockaddr_in address;
+	std::memcpy(&address, found->ai_addr, sizeof(address));
+	freeaddrinfo(found);
+	address.sin_port = htons(port);
+
+	std::memcpy(peer, &address, sizeof(address));
+	has_peer = true;
+}
+
+double UdpLink::random() {
+	//xorshift32:
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return (random_state >> 8) / double(1 << 24);
+}
+
+void UdpLink::send(uint8_t const *data, size_t size, double now) {
+	if (conditions.loss > 0.0 && random() < conditions.loss) return;
+	if (conditions.latency <= 0.0 && conditions.jitter <= 0.0) {
+		send_now(data, size);
+		return;
+	}
+	delayed.emplace_back();
+	delayed.back().send_at = now + conditions.latency + conditions.jitter * random();
+	delayed.back().data.assign(data, data + size);
+}
+
+void UdpLink::send_now(uint8_t const *data, size_t size) {
+	if (!has_peer) return; //(nobody to send to yet)
+	sendto(socket, reinterpret_cast< char const * >(data), int(size), 0, reinterpret_cast< sockaddr const * >(peer), sizeof(sockaddr_in));
+}
+
+bool UdpLink::receive(std::vector< uint8_t > *packet, double now) {
+	//send delayed packets that are due (in the order they come due, so jitter can reorder them):
+	std::stable_sort(delayed.begin(), delayed.end(), [](Delayed const &a, Delayed const &b) {
+		return a.send_at < b.send_at;
+	});
+	size_t due = 0;
+	while (due < delayed.size() && delayed[due].send_at <= now) {
+		send_now(delayed[due].data.data(), delayed[due].data.size());
+		due += 1;
+	}
+	delayed.erase(delayed.begin(), delayed.begin() + due);
+
+	while (true) {
+		packet->resize(1500);
+		sockaddr_in from;
+		socklen_t from_length = sizeof(from);
+		auto got = recvfrom(socket, reinterpret_cast< char * >(packet->data()), int(packet->size()), 0, reinterpret_cast< sockaddr * >(&from), &from_length);
+		if (got < 0) {
+			packet->clear();
+			return false;
+		}
+		packet->resize(size_t(got));
+
+		//reply to whoever is talking to us:
+		if (!has_peer) {
+			std::memcpy(peer, &from, sizeof(from));
+			has_peer = true;
+			return true;
+		}
+		//...and ignore anyone else:
+		sockaddr_in expected;
+		std::memcpy(&expected, peer, sizeof(expected));
+		if (from.sin_addr.s_addr == expected.sin_addr.s_addr && from.sin_port == expected.sin_port) return true;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+//A UDP socket for talking to one other machine, with an optional simulated
+// bad network (latency, jitter, and loss applied to outgoing packets) so
+// online play can be tried out on one machine over loopback.
+//
+// Times are passed in (in seconds, from any steady clock) so that tests can
+// run faster than real time.
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct UdpLink {
+	//Opens a non-blocking socket bound to 'port' on all interfaces (0 picks any free port):
+	// (throws on failure)
+	UdpLink(uint16_t port = 0);
+	~UdpLink();
+	UdpLink(UdpLink const &) = delete;
+	UdpLink &operator=(UdpLink const &) = delete;
+
+	//Sends to 'host':'port' from now on; without this, packets go to whoever sent the first packet received:
+	void connect(std::string const &host, uint16_t port);
+
+	//Sends a packet (or queues it, if simulating latency):
+	void send(uint8_t const *data, size_t size, double now);
+
+	//Gets the next received packet, if there is one (also sends any queued packets that are due):
+	// (once there is a peer, packets from anywhere else are dropped)
+	bool receive(std::vector< uint8_t > *packet, double now);
+
+	//Port actually bound:
+	uint16_t local_port = 0;
+
+	//Simulated network conditions for outgoing packets:
+	struct Conditions {
+		double latency = 0.0; //seconds
+		double jitter = 0.0; //up to this many extra seconds, chosen at random per packet
+		double loss = 0.0; //fraction of packets dropped
+	} conditions;
+
+	//--- internals ---
+	intptr_t socket = -1;
+	bool has_peer = false;
+	uint8_t peer[16]; //sockaddr_in of the other machine
+
+	struct Delayed {
+		double send_at;
+		std::vector< uint8_t > data;
+	};
+	std::vector< Delayed > delayed;
+	uint32_t random_state = 0x12345678;
+
+	double random(); //in [0,1)
+	void send_now(uint8_t const *data, size_t size);
+};
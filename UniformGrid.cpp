@@ -0,0 +1,40 @@
+#include "UniformGrid.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void UniformGrid::resize(glm::vec2 court_radius, float cell_size_) {
+	assert(cell_size_ > 0.0f);
+	cell_size = cell_size_;
+	inv_cell_size = 1.0f / cell_size;
+	origin = -court_radius;
+	cells.x = std::max(1u, uint32_t(std::ceil(2.0f * court_radius.x * inv_cell_size)));
+	cells.y = std::max(1u, uint32_t(std::ceil(2.0f * court_radius.y * inv_cell_size)));
+	cell_start.assign(cells.x * cells.y + 1, 0);
+}
+
+void UniformGrid::build(glm::vec2 const *points, size_t count) {
+	cell_of.resize(count);
+	entries.resize(count);
+	std::fill(cell_start.begin(), cell_start.end(), 0);
+
+	//count points per cell (shifted by one, so the prefix sum gives starts):
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t cell = uint32_t(cell_y(points[i].y)) * cells.x + uint32_t(cell_x(points[i].x));
+		cell_of[i] = cell;
+		cell_start[cell + 1] += 1;
+	}
+	for (size_t c = 1; c < cell_start.size(); ++c) {
+		cell_start[c] += cell_start[c - 1];
+	}
+
+	//place points (using the starts as write cursors, then shifting them back):
+	for (size_t i = 0; i < count; ++i) {
+		entries[cell_start[cell_of[i]]++] = uint32_t(i);
+	}
+	for (size_t c = cell_start.size() - 1; c > 0; --c) {
+		cell_start[c] = cell_start[c - 1];
+	}
+	cell_start[0] = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+//Buckets points into square cells covering the court, so "what is near here?"
+// only looks at a few cells instead of every point.
+// build() is a counting sort (no allocation once the grid has seen as many points).
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct UniformGrid {
+	//Covers [-court_radius, court_radius] with cells of size 'cell_size' (points outside go in the edge cells):
+	void resize(glm::vec2 court_radius, float cell_size);
+
+	//Rebuilds the grid from 'count' points:
+	void build(glm::vec2 const *points, size_t count);
+
+	//Calls 'visit(index)' for every point in the cell containing 'at' and the eight cells around it
+	// (so it visits at least every point within cell_size of 'at' in x and y):
+	template< typename F >
+	void for_each_near(glm::vec2 at, F const &visit) const {
+		int32_t cx = cell_x(at.x), cy = cell_y(at.y);
+		for (int32_t y = (cy > 0 ? cy - 1 : 0); y <= cy + 1 && y < int32_t(cells.y); ++y) {
+			for (int32_t x = (cx > 0 ? cx - 1 : 0); x <= cx + 1 && x < int32_t(cells.x); ++x) {
+				uint32_t cell = uint32_t(y) * cells.x + uint32_t(x);
+				for (uint32_t i = cell_start[cell]; i < cell_start[cell + 1]; ++i) {
+					visit(entries[i]);
+				}
+			}
+		}
+	}
+
+	int32_t cell_x(float x) const {
+		int32_t c = int32_t((x - origin.x) * inv_cell_size);
+		return c < 0 ? 0 : (c >= int32_t(cells.x) ? int32_t(cells.x) - 1 : c);
+	}
+	int32_t cell_y(float y) const {
+		int32_t c = int32_t((y - origin.y) * inv_cell_size);
+		return c < 0 ? 0 : (c >= int32_t(cells.y) ? int32_t(cells.y) - 1 : c);
+	}
+
+	glm::vec2 origin = glm::vec2(0.0f); //lower-left corner of cell (0,0)
+	float cell_size = 1.0f;
+	float inv_cell_size = 1.0f;
+	glm::uvec2 cells = glm::uvec2(1, 1);
+
+	std::vector< uint32_t > cell_start; //points in cell c are entries[cell_start[c] .. cell_start[c+1])
+	std::vector< uint32_t > entries; //point indices, sorted by cell
+	std::vector< uint32_t > cell_of; //cell of each point (scratch for build)
+};
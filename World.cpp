@@ -0,0 +1,97 @@
+#include "World.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+uint32_t next_component_id() {
+	static std::atomic< uint32_t > next(0);
+	uint32_t id = next.fetch_add(1);
+	if (id >= WORLD_MAX_COMPONENTS) {
+		throw std::runtime_error("More than " + std::to_string(WORLD_MAX_COMPONENTS) + " component types; raise WORLD_MAX_COMPONENTS.");
+	}
+	return id;
+}
+
+World::World(World const &other) {
+	*this = other;
+}
+
+World &World::operator=(World const &other) {
+	if (this == &other) return *this;
+
+	//the same archetypes in the same order (the usual case, copying one match into another)? copy into them:
+	bool same = (archetypes.size() == other.archetypes.size());
+	for (size_t a = 0; same && a < archetypes.size(); ++a) {
+		same = (archetypes[a]->mask == other.archetypes[a]->mask);
+		//(columns are in the order the archetype's first entity listed them)
+		for (size_t c = 0; same && c < archetypes[a]->columns.size(); ++c) {
+			same = (archetypes[a]->columns[c]->id == other.archetypes[a]->columns[c]->id);
+		}
+	}
+	if (same) {
+		for (size_t a = 0; a < archetypes.size(); ++a) {
+			Archetype &to = *archetypes[a];
+			Archetype const &from = *other.archetypes[a];
+			for (size_t c = 0; c < to.columns.size(); ++c) to.columns[c]->copy_from(*from.columns[c]);
+			to.entities = from.entities;
+			to.refresh();
+		}
+	} else {
+		archetypes.clear();
+		archetypes.reserve(other.archetypes.size());
+		for (auto const &from : other.archetypes) {
+			archetypes.emplace_back(new Archetype);
+			Archetype &to = *archetypes.back();
+			to.mask = from->mask;
+			for (auto const &column : from->columns) to.columns.emplace_back(column->clone());
+			to.entities = from->entities;
+			to.refresh();
+		}
+	}
+
+	//records point at archetypes, so re-point them at the copies:
+	records = other.records;
+	for (auto &record : records) {
+		if (!record.archetype) continue;
+		for (size_t a = 0; a < other.archetypes.size(); ++a) {
+			if (other.archetypes[a].get() == record.archetype) {
+				record.archetype = archetypes[a].get();
+				break;
+			}
+		}
+	}
+	free_indices = other.free_indices;
+	return *this;
+}
+
+void World::destroy(Entity entity) {
+	assert(alive(entity));
+	Record &record = records[entity.index];
+	Archetype &archetype = *record.archetype;
+
+	//fill the hole with the archetype's last entity:
+	for (auto &column : archetype.columns) column->swap_remove(record.row);
+	Entity moved = archetype.entities.back();
+	archetype.entities[record.row] = moved;
+	archetype.entities.pop_back();
+	archetype.refresh();
+	if (moved != entity) records[moved.index].row = record.row;
+
+	record.archetype = nullptr;
+	record.generation += 1;
+	free_indices.emplace_back(entity.index);
+}
+
+Entity World::allocate_entity() {
+	Entity entity;
+	if (!free_indices.empty()) {
+		entity.index = free_indices.back();
+		free_indices.pop_back();
+	} else {
+		entity.index = uint32_t(records.size());
+		records.emplace_back();
+	}
+	entity.generation = records[entity.index].generation;
+	return entity;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+//A small archetype entity-component store.
+// An entity is just a handle; its components live in the archetype for its
+// exact set of component types, one contiguous array per type (so all
+// fighters' player_info sit next to each other, apart from anything else
+// they carry). query< A, B >() visits every archetype that has A and B,
+// handing the callback those arrays directly, so systems are plain loops.
+//
+// Components can be any copyable type (up to WORLD_MAX_COMPONENTS types).
+// Creating or destroying entities moves components around, so don't do it
+// (or hold on to pointers) while a query is running; queue up changes and
+// apply them afterwards instead.
+// Copying a World copies every component (RewindSim keeps its fighters in one,
+// so this is how matches are copied for lookahead); copying into a World with
+// the same archetypes reuses its arrays, so it doesn't allocate.
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+#define WORLD_MAX_COMPONENTS 32
+
+//Stays valid until the entity is destroyed (after that, World::alive() says so):
+struct Entity {
+	uint32_t index = ~0u;
+	uint32_t generation = 0;
+	bool operator==(Entity const &other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(Entity const &other) const { return !(*this == other); }
+};
+
+//Each component type's number, handed out during static initialization
+// (so looking one up is a plain load; don't use a World before main()):
+uint32_t next_component_id();
+template< typename T >
+struct ComponentId {
+	static uint32_t const id;
+};
+template< typename T >
+uint32_t const ComponentId< T >::id = next_component_id();
+
+template< typename T >
+uint32_t component_id() {
+	return ComponentId< T >::id;
+}
+
+struct World {
+	World() = default;
+	World(World const &other);
+	World &operator=(World const &other);
+
+	//Makes an entity with the given components (one of each type):
+	template< typename... Cs >
+	Entity create(Cs const &... components) {
+		uint32_t mask = mask_of< Cs... >();
+		Archetype *archetype = find_archetype(mask);
+		if (!archetype) {
+			archetypes.emplace_back(new Archetype);
+			archetype = archetypes.back().get();
+			archetype->mask = mask;
+			add_columns< Cs... >(archetype);
+		}
+		push_components(archetype, components...);
+		archetype->refresh();
+
+		Entity entity = allocate_entity();
+		records[entity.index].archetype = archetype;
+		records[entity.index].row = uint32_t(archetype->entities.size());
+		archetype->entities.emplace_back(entity);
+		return entity;
+	}
+
+	//Removes an entity and its components (its handle stops being alive()):
+	void destroy(Entity entity);
+
+	bool alive(Entity entity) const {
+		return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype;
+	}
+
+	//The entity's component of type T, or nullptr if it has none:
+	template< typename T >
+	T *get(Entity entity) {
+		assert(alive(entity));
+		Record const &record = records[entity.index];
+		T *items = data< T >(record.archetype);
+		return items ? &items[record.row] : nullptr;
+	}
+	template< typename T >
+	T const *get(Entity entity) const {
+		return const_cast< World * >(this)->get< T >(entity);
+	}
+
+	//Where the entity's components are in its archetype's arrays (for reaching other
+	// entities of the same archetype from inside a query, without a get() per component):
+	uint32_t row_of(Entity entity) const {
+		assert(alive(entity));
+		return records[entity.index].row;
+	}
+
+	//Calls fn(count, entities, Cs *...) once for each archetype with all of Cs (and any others),
+	// with that archetype's arrays of those components (so Cs[i] all belong to entities[i]):
+	template< typename... Cs, typename F >
+	void query(F const &fn) {
+		uint32_t mask = mask_of< Cs... >();
+		for (auto const &archetype : archetypes) {
+			if ((archetype->mask & mask) != mask || archetype->entities.empty()) continue;
+			fn(archetype->entities.size(), archetype->entities.data(), data< Cs >(archetype.get())...);
+		}
+	}
+
+	//Number of entities with all of Cs:
+	template< typename... Cs >
+	size_t count() const {
+		uint32_t mask = mask_of< Cs... >();
+		size_t total = 0;
+		for (auto const &archetype : archetypes) {
+			if ((archetype->mask & mask) == mask) total += archetype->entities.size();
+		}
+		return total;
+	}
+
+	//----- storage -----
+
+	//One component type's array in an archetype:
+	struct Column {
+		Column(uint32_t id_) : id(id_) { }
+		virtual ~Column() { }
+		uint32_t id; //component id
+		virtual void *data() = 0;
+		virtual Column *clone() const = 0;
+		virtual void copy_from(Column const &other) = 0; //(other must be a column of the same type)
+		virtual void swap_remove(uint32_t row) = 0; //moves the last row into 'row', then drops the last row
+	};
+	template< typename T >
+	struct ColumnOf : Column {
+		ColumnOf() : Column(component_id< T >()) { }
+		std::vector< T > items;
+		virtual void *data() override { return items.data(); }
+		virtual Column *clone() const override { return new ColumnOf< T >(*this); }
+		virtual void copy_from(Column const &other) override { items = static_cast< ColumnOf< T > const & >(other).items; }
+		virtual void swap_remove(uint32_t row) override {
+			if (row + 1 != items.size()) items[row] = items.back();
+			items.pop_back();
+		}
+	};
+
+	//All entities with exactly one set of component types:
+	struct Archetype {
+		uint32_t mask = 0; //bit component_id< T >() is set for each component type T
+		std::vector< std::unique_ptr< Column > > columns;
+		std::vector< Entity > entities; //row i of every column belongs to entities[i]
+		void *items[WORLD_MAX_COMPONENTS]; //each column's array by component id (nullptr if none), saving a few lookups
+		Archetype() { for (auto &i : items) i = nullptr; }
+		//Updates 'items' (after rows are added or removed):
+		void refresh() {
+			for (auto const &column : columns) items[column->id] = column->data();
+		}
+	};
+	std::vector< std::unique_ptr< Archetype > > archetypes; //(in the order they were first needed)
+
+	struct Record {
+		Archetype *archetype = nullptr; //nullptr if the index isn't in use
+		uint32_t row = 0;
+		uint32_t generation = 0;
+	};
+	std::vector< Record > records; //indexed by Entity::index
+	std::vector< uint32_t > free_indices; //indices of destroyed entities, for reuse
+
+private:
+	template< typename T >
+	static T *data(Archetype *archetype) {
+		return static_cast< T * >(archetype->items[component_id< T >()]);
+	}
+
+	//(a recursive struct rather than an array of bits: the array ends up on the stack,
+	// and reading it back costs more than the rest of a small query)
+	template< typename... Cs >
+	struct MaskOf {
+		static uint32_t get() { return 0; }
+	};
+	template< typename T, typename... Rest >
+	struct MaskOf< T, Rest... > {
+		static uint32_t get() { return (1u << component_id< T >()) | MaskOf< Rest... >::get(); }
+	};
+	template< typename... Cs >
+	static uint32_t mask_of() {
+		return MaskOf< Cs... >::get();
+	}
+
+	Archetype *find_archetype(uint32_t mask) {
+		for (auto const &archetype : archetypes) {
+			if (archetype->mask == mask) return archetype.get();
+		}
+		return nullptr;
+	}
+
+	template< typename T >
+	static void add_column(Archetype *archetype) {
+		archetype->columns.emplace_back(new ColumnOf< T >());
+	}
+	template< typename... Cs >
+	static void add_columns(Archetype *archetype) {
+		int each[] = { 0, (add_column< Cs >(archetype), 0)... };
+		(void)each;
+	}
+
+	static void push_components(Archetype *) { }
+	template< typename T, typename... Rest >
+	static void push_components(Archetype *archetype, T const &component, Rest const &... rest) {
+		for (auto const &column : archetype->columns) {
+			if (column->id == component_id< T >()) static_cast< ColumnOf< T > * >(column.get())->items.emplace_back(component);
+		}
+		push_components(archetype, rest...);
+	}
+
+	Entity allocate_entity();
+};
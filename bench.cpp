@@ -0,0 +1,1891 @@
+//Headless benchmarks for the game simulation.
+// Usage: rewind-bench [benchmark ...]   (runs all benchmarks if none are named)
+
+#include "RewindSim.hpp"
+#include "RewindBatch.hpp"
+#include "Replay.hpp"
+#include "Rollback.hpp"
+#include "UdpLink.hpp"
+#include "DegreeTrig.hpp"
+#include "Collision.hpp"
+#include "Arena.hpp"
+#include "MctsBot.hpp"
+#include "RewindHistory.hpp"
+#include "Timeline.hpp"
+#include "StateHash.hpp"
+#include "PhaseTimers.hpp"
+#include "LagCompensation.hpp"
+#include "RingBuffer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Random held-button patterns that change every few ticks, roughly like a person playing:
+struct RandomInputs {
+	RandomInputs(uint32_t seed) : mt(seed) { }
+
+	uint8_t next(uint32_t player) {
+		if (hold[player] == 0) {
+			held[player] = uint8_t(mt() & (INPUT_LEFT | INPUT_RIGHT | INPUT_ATTACK | INPUT_REWIND));
+			hold[player] = 1 + mt() % 30;
+		}
+		hold[player] -= 1;
+		return held[player];
+	}
+
+	std::mt19937 mt;
+	uint8_t held[2] = {0, 0};
+	uint32_t hold[2] = {0, 0};
+};
+
+//seconds since 'start':
+static double seconds_since(std::chrono::high_resolution_clock::time_point start) {
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//A path for a scratch file called 'name' in the temp directory (so benchmarks don't litter the working directory):
+static std::string temp_path(std::string const &name) {
+#if defined(_WIN32)
+	char const *dir = std::getenv("TEMP");
+	if (!dir || !dir[0]) dir = ".";
+#else
+	char const *dir = std::getenv("TMPDIR");
+	if (!dir || !dir[0]) dir = "/tmp";
+#endif
+	return std::string(dir) + "/" + name;
+}
+
+//Steps a single match with random inputs:
+static bool bench_ticks() {
+	RewindSim sim;
+	RandomInputs inputs(0x5eed);
+
+	uint32_t const count = 10000000;
+	//pre-generate inputs so the random number generator isn't being timed:
+	std::vector< uint8_t > stream(2 * 4096);
+	for (uint32_t i = 0; i < 4096; ++i) {
+		stream[2*i+0] = inputs.next(0);
+		stream[2*i+1] = inputs.next(1);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t at = 2 * (i % 4096);
+		sim.step(stream[at], stream[at+1]);
+	}
+	double seconds = seconds_since(start);
+
+	std::cout << "ticks: " << count << " ticks in " << seconds << "s = "
+		<< (count / seconds) / 1e6 << "M ticks/s (" << sim.round << " rounds, "
+		<< sim.left_score << "-" << sim.right_score << ")" << std::endl;
+
+	return true;
+}
+
+//Checks each batch kernel set against RewindSim, then times them:
+static bool bench_batch() {
+	std::vector< BatchKernels const * > kernel_sets;
+	if (batch_kernels_scalar()) kernel_sets.emplace_back(batch_kernels_scalar());
+	if (batch_kernels_sse()) kernel_sets.emplace_back(batch_kernels_sse());
+	if (batch_kernels_avx2()) kernel_sets.emplace_back(batch_kernels_avx2());
+
+	//equivalence: every field (including rewind logs) must match bit for bit after every tick
+	// (with the default rules, at rewind speeds that blend between log entries, and with every constant changed)
+	std::vector< RewindParams > rule_sets(4);
+	rule_sets[1].rewind_speed = 0.7f;
+	rule_sets[2].rewind_speed = 2.5f;
+	for (auto const &info : rewind_param_info()) rule_sets[3].*info.value *= 1.3f;
+	for (auto const &rules : rule_sets) {
+		size_t const matches = 61; //not a multiple of BATCH_LANES, on purpose
+		uint32_t const ticks = 5000;
+		for (auto kernels : kernel_sets) {
+			RewindBatch batch(matches, TICK_RATE, rules, kernels);
+			std::vector< RewindSim > sims(matches, RewindSim(TICK_RATE, rules));
+			std::vector< RandomInputs > inputs;
+			for (size_t m = 0; m < matches; ++m) inputs.emplace_back(uint32_t(m + 1));
+
+			for (uint32_t t = 0; t < ticks; ++t) {
+				for (size_t m = 0; m < matches; ++m) {
+					batch.input[0][m] = inputs[m].next(0);
+					batch.input[1][m] = inputs[m].next(1);
+					sims[m].step_as< float >(batch.input[0][m], batch.input[1][m]); //(the batch always runs in floats)
+				}
+				batch.step();
+				for (size_t m = 0; m < matches; ++m) {
+					if (char const *field = batch.compare(m, sims[m])) {
+						std::cout << "batch: " << kernels->name << " kernels differ from RewindSim in '"
+							<< field << "' (match " << m << ", tick " << t << ")" << std::endl;
+						return false;
+					}
+				}
+			}
+			uint32_t rounds = 0;
+			for (auto const &sim : sims) rounds += sim.round;
+			std::cout << "batch: " << kernels->name << " kernels match RewindSim (" << matches << " matches x "
+				<< ticks << " ticks, " << rounds << " rounds, rewinding at " << rules.rewind_speed << "x"
+				<< (&rules == &rule_sets[3] ? ", all constants x1.3" : "") << ")" << std::endl;
+		}
+	}
+
+	{ //throughput (best of three runs, since the machine may be busy):
+		size_t const matches = 4096;
+		uint32_t const ticks = 2000;
+
+		std::vector< uint8_t > stream(2 * matches);
+		size_t const wrap = stream.size() - 1; //(a power of two, so picking inputs is a mask rather than a division)
+		RandomInputs inputs(0x5eed);
+		for (auto &b : stream) b = inputs.next(0);
+
+		{ //baseline: one RewindSim per match
+			double best = 0.0;
+			for (uint32_t run = 0; run < 3; ++run) {
+				std::vector< RewindSim > sims(matches);
+				auto start = std::chrono::high_resolution_clock::now();
+				for (uint32_t t = 0; t < ticks; ++t) {
+					for (size_t m = 0; m < matches; ++m) {
+						sims[m].step(stream[(2*m + t) & wrap], stream[(2*m + 1 + 3*t) & wrap]);
+					}
+				}
+				best = std::max(best, (matches * double(ticks) / seconds_since(start)) / 1e6);
+			}
+			std::cout << "batch: RewindSim loop: " << best << "M match-ticks/s" << std::endl;
+		}
+
+		for (auto kernels : kernel_sets) {
+			double best = 0.0;
+			for (uint32_t run = 0; run < 3; ++run) {
+				RewindBatch batch(matches, TICK_RATE, RewindParams(), kernels);
+				auto start = std::chrono::high_resolution_clock::now();
+				for (uint32_t t = 0; t < ticks; ++t) {
+					for (size_t m = 0; m < matches; ++m) {
+						batch.input[0][m] = stream[(2*m + t) & wrap];
+						batch.input[1][m] = stream[(2*m + 1 + 3*t) & wrap];
+					}
+					batch.step();
+				}
+				best = std::max(best, (matches * double(ticks) / seconds_since(start)) / 1e6);
+			}
+			std::cout << "batch: " << kernels->name << " kernels: " << best << "M match-ticks/s" << std::endl;
+		}
+	}
+
+	return true;
+}
+
+//Times save/restore of a mid-match snapshot, and checks that restoring really rewinds the match:
+static bool bench_snapshot() {
+	RewindSim sim;
+	RandomInputs inputs(0x5eed);
+
+	//play until both rewind logs are full, without rewinding (so the logs hold as much as they can):
+	while (sim.playerOne().rewind_log.size() < sim.playerOne().rewind_log.capacity()
+	    || sim.playerTwo().rewind_log.size() < sim.playerTwo().rewind_log.capacity()) {
+		sim.step(inputs.next(0) & ~INPUT_REWIND, inputs.next(1) & ~INPUT_REWIND);
+	}
+
+	RewindSnapshot snapshot;
+	sim.save(&snapshot);
+
+	{ //round trip: play on, restore, replay the same inputs; the result must be identical
+		uint32_t const ticks = 2000;
+		std::vector< uint8_t > stream(2 * ticks);
+		for (uint32_t t = 0; t < ticks; ++t) {
+			stream[2*t+0] = inputs.next(0);
+			stream[2*t+1] = inputs.next(1);
+		}
+
+		RewindSnapshot first, second;
+		for (uint32_t t = 0; t < ticks; ++t) sim.step(stream[2*t], stream[2*t+1]);
+		sim.save(&first);
+
+		sim.restore(snapshot);
+		for (uint32_t t = 0; t < ticks; ++t) sim.step(stream[2*t], stream[2*t+1]);
+		sim.save(&second);
+
+		//(State has no padding -- see RewindSnapshot::State -- so memcmp is fair)
+		if (std::memcmp(&first.state, &second.state, sizeof(RewindSnapshot::State)) != 0
+		 || first.tail.size() != second.tail.size()
+		 || std::memcmp(first.tail.data(), second.tail.data(), first.tail.size() * sizeof(glm::vec4)) != 0) {
+			std::cout << "snapshot: replaying from a restored snapshot gave a different match" << std::endl;
+			return false;
+		}
+		sim.restore(snapshot);
+	}
+
+	std::cout << "snapshot: " << sizeof(RewindSnapshot::State) << " bytes of state + "
+		<< snapshot.tail.size() * sizeof(glm::vec4) << " bytes of rewind log" << std::endl;
+
+	uint32_t const count = 1000000;
+	RewindSnapshot scratch;
+	sim.save(&scratch); //(warm up, so the tail is already allocated)
+
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < count; ++i) {
+			sim.save(&scratch);
+			scratch.state.round += i; //(keep the compiler from dropping repeated saves)
+		}
+		double seconds = seconds_since(start);
+		std::cout << "snapshot: save: " << (seconds / count) * 1e9 << "ns" << std::endl;
+	}
+
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < count; ++i) {
+			sim.restore(snapshot);
+			sim.round += i;
+		}
+		double seconds = seconds_since(start);
+		std::cout << "snapshot: restore: " << (seconds / count) * 1e9 << "ns" << std::endl;
+	}
+
+	return true;
+}
+
+//Records a long match, then checks and times seeking around in it:
+static bool bench_replay() {
+	std::string const filename = temp_path("rewind-bench.replay");
+	uint32_t const ticks = uint32_t(60.0f * 60.0f * TICK_RATE); //an hour of play
+
+	//ticks to check seeking at, and the state the match was in at each one:
+	std::vector< uint32_t > check_ticks;
+	std::vector< RewindSnapshot > expected;
+	std::mt19937 mt(0x5eed);
+	for (uint32_t i = 0; i < 200; ++i) check_ticks.emplace_back(mt() % (ticks + 1));
+	check_ticks.emplace_back(0);
+	check_ticks.emplace_back(ticks);
+	std::sort(check_ticks.begin(), check_ticks.end());
+	expected.resize(check_ticks.size());
+
+	auto same = [](RewindSnapshot const &a, RewindSnapshot const &b) {
+		return std::memcmp(&a.state, &b.state, sizeof(RewindSnapshot::State)) == 0
+		    && a.tail.size() == b.tail.size()
+		    && std::memcmp(a.tail.data(), b.tail.data(), a.tail.size() * sizeof(glm::vec4)) == 0;
+	};
+
+	{ //record:
+		RewindSim sim;
+		RandomInputs inputs(0x5eed);
+		ReplayWriter writer(filename, sim);
+		size_t c = 0;
+		for (uint32_t t = 0; t <= ticks; ++t) {
+			while (c < check_ticks.size() && check_ticks[c] == t) sim.save(&expected[c++]);
+			if (t == ticks) break;
+			uint8_t player_one_input = inputs.next(0);
+			uint8_t player_two_input = inputs.next(1);
+			writer.record(sim, player_one_input, player_two_input);
+			sim.step(player_one_input, player_two_input);
+		}
+		writer.finish();
+		std::cout << "replay: " << ticks << " ticks (" << sim.round << " rounds) in "
+			<< writer.keyframes.size() << " keyframes, ";
+	}
+
+	bool ok = true;
+	{
+		ReplayReader reader(filename);
+		std::cout << reader.size << " bytes (" << (reader.size / 60.0) / 1024.0 << " KiB per minute)" << std::endl;
+
+		RewindSim sim(reader.tick_rate);
+		RewindSnapshot got;
+
+		//seeking:
+		std::vector< size_t > order(check_ticks.size());
+		for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+		std::shuffle(order.begin(), order.end(), mt);
+		for (auto i : order) {
+			reader.seek(&sim, check_ticks[i]);
+			sim.save(&got);
+			if (reader.tick != check_ticks[i] || !same(got, expected[i])) {
+				std::cout << "replay: seeking to tick " << check_ticks[i] << " gave a different state" << std::endl;
+				ok = false;
+				break;
+			}
+		}
+
+		//playing straight through:
+		if (ok) {
+			reader.seek(&sim, 0);
+			uint8_t player_one_input, player_two_input;
+			auto start = std::chrono::high_resolution_clock::now();
+			while (reader.next_input(&player_one_input, &player_two_input)) {
+				sim.step(player_one_input, player_two_input);
+			}
+			double seconds = seconds_since(start);
+			sim.save(&got);
+			if (reader.tick != ticks || !same(got, expected.back())) {
+				std::cout << "replay: playing through gave a different final state" << std::endl;
+				ok = false;
+			} else {
+				std::cout << "replay: playback at " << (ticks / seconds) / 1e6 << "M ticks/s" << std::endl;
+			}
+		}
+
+		if (ok) {
+			uint32_t const count = 20000;
+			auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < count; ++i) {
+				reader.seek(&sim, mt() % (ticks + 1));
+			}
+			double seconds = seconds_since(start);
+			std::cout << "replay: seek: " << (seconds / count) * 1e6 << "us (checked " << check_ticks.size() << " seeks)" << std::endl;
+		}
+	}
+
+	std::remove(filename.c_str());
+	return ok;
+}
+
+//Plays a match between two rollback sessions over loopback UDP with a simulated bad network:
+static bool bench_rollback() {
+	uint32_t const ticks = uint32_t(2.0f * 60.0f * TICK_RATE); //two minutes of play
+
+	std::vector< uint8_t > inputs[2];
+	{
+		RandomInputs random(0x5eed);
+		for (uint32_t t = 0; t < ticks; ++t) {
+			inputs[0].emplace_back(random.next(0));
+			inputs[1].emplace_back(random.next(1));
+		}
+	}
+
+	//what the match should end up as:
+	RewindSim expected;
+	std::vector< StateHash > expected_hashes;
+	for (uint32_t t = 0; t < ticks; ++t) {
+		expected.step(inputs[0][t], inputs[1][t]);
+		expected_hashes.emplace_back(hash_state(expected, expected_hashes.empty() ? 0 : expected_hashes.back().chain));
+	}
+
+	UdpLink host_link(0);
+	UdpLink client_link(0);
+	client_link.connect("127.0.0.1", host_link.local_port);
+
+	RewindSim sims[2];
+	RollbackSession sessions[2] = { RollbackSession(&sims[0], PLAYER_ONE), RollbackSession(&sims[1], PLAYER_TWO) };
+	UdpLink *links[2] = { &host_link, &client_link };
+	for (auto link : links) {
+		link->conditions.latency = 0.05;
+		link->conditions.jitter = 0.02;
+		link->conditions.loss = 0.05;
+	}
+
+	//run in simulated time (packets really go over loopback, but without waiting for the latency):
+	std::vector< uint8_t > packet;
+	uint32_t step = 0;
+	//settled states get hashed as they come (as with --hash-log), and should match the local match tick for tick:
+	uint32_t hashed[2] = {0, 0};
+	uint64_t chain[2] = {0, 0};
+	bool hashes_match = true;
+	auto hash_settled = [&](int p) {
+		while (RewindSnapshot const *state = sessions[p].final_state(hashed[p] + 1)) {
+			StateHash hash = hash_state(*state, chain[p]);
+			if (hash.chain != expected_hashes[hashed[p]].chain) hashes_match = false;
+			chain[p] = hash.chain;
+			hashed[p] += 1;
+		}
+	};
+	auto done = [&]() {
+		return sessions[0].tick == ticks && sessions[1].tick == ticks
+		    && sessions[0].remote_confirmed == ticks && sessions[1].remote_confirmed == ticks;
+	};
+	while (!done() && step < 4 * ticks) {
+		double now = step / double(TICK_RATE);
+		for (int p = 0; p < 2; ++p) {
+			while (links[p]->receive(&packet, now)) {
+				sessions[p].read_packet(packet.data(), packet.size());
+			}
+			if (sessions[p].tick < ticks) sessions[p].advance(inputs[p][sessions[p].tick]);
+			hash_settled(p);
+			sessions[p].write_packet(&packet);
+			links[p]->send(packet.data(), packet.size(), now);
+		}
+		step += 1;
+	}
+	if (!done()) {
+		std::cout << "rollback: sessions never caught up with each other" << std::endl;
+		return false;
+	}
+
+	for (int p = 0; p < 2; ++p) {
+		sessions[p].resolve();
+		hash_settled(p);
+	}
+	if (!hashes_match || hashed[0] + 1 < ticks || hashed[1] + 1 < ticks) {
+		std::cout << "rollback: settled states' hashes (" << hashed[0] << " and " << hashed[1] << " ticks) don't match the local match's" << std::endl;
+		return false;
+	}
+
+	RewindSnapshot want, got;
+	expected.save(&want);
+	for (int p = 0; p < 2; ++p) {
+		sessions[p].resolve();
+		sims[p].save(&got);
+		if (std::memcmp(&got.state, &want.state, sizeof(RewindSnapshot::State)) != 0
+		 || got.tail.size() != want.tail.size()
+		 || std::memcmp(got.tail.data(), want.tail.data(), got.tail.size() * sizeof(glm::vec4)) != 0) {
+			std::cout << "rollback: player " << (p + 1) << "'s match ended differently from the local one" << std::endl;
+			return false;
+		}
+	}
+
+	std::cout << "rollback: " << ticks << " ticks over loopback (" << host_link.conditions.latency * 1000.0 << "ms +"
+		<< host_link.conditions.jitter * 1000.0 << "ms jitter, " << host_link.conditions.loss * 100.0 << "% loss); both matches agree" << std::endl;
+	for (int p = 0; p < 2; ++p) {
+		RollbackStats const &stats = sessions[p].stats;
+		std::cout << "rollback: player " << (p + 1) << ": " << stats.rollbacks << " rollbacks, depth "
+			<< (stats.rollbacks ? double(stats.total_depth) / stats.rollbacks : 0.0) << " avg / " << stats.max_depth << " max ticks, re-simulation "
+			<< (stats.rollbacks ? stats.total_resimulate_seconds / stats.rollbacks * 1e6 : 0.0) << "us avg / "
+			<< stats.max_resimulate_seconds * 1e6 << "us max, " << stats.stalls << " stalls, "
+			<< sessions[p].local_inputs.size() << " local / " << sessions[p].remote_inputs.size() << " remote inputs kept" << std::endl;
+	}
+	//(old inputs are trimmed, so the session's memory doesn't grow with the length of the match)
+	for (int p = 0; p < 2; ++p) {
+		if (sessions[p].local_inputs.size() > 1024 || sessions[p].remote_inputs.size() > 1024) {
+			std::cout << "rollback: player " << (p + 1) << "'s session kept every input" << std::endl;
+			return false;
+		}
+	}
+
+	//a stranger's packets don't get into a session once it has a peer:
+	{
+		UdpLink stranger(0);
+		stranger.connect("127.0.0.1", client_link.local_port);
+		std::vector< uint8_t > hello;
+		RollbackSession(&sims[0], PLAYER_ONE).write_packet(&hello);
+		stranger.send(hello.data(), hello.size(), 0.0);
+		host_link.conditions = UdpLink::Conditions();
+		host_link.send(packet.data(), packet.size(), 0.0);
+		uint32_t received = 0;
+		for (uint32_t tries = 0; tries < 1000 && received == 0; ++tries) {
+			while (client_link.receive(&packet, 0.0)) received += 1;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		if (received != 1) {
+			std::cout << "rollback: the client took " << received << " packets; expected only the host's" << std::endl;
+			return false;
+		}
+	}
+
+	//sessions whose rules differ refuse to start:
+	{
+		RewindParams slower;
+		slower.walk_speed *= 0.5f;
+		RewindSim mismatched[2] = { RewindSim(TICK_RATE), RewindSim(TICK_RATE, slower) };
+		RollbackSession refusing[2] = { RollbackSession(&mismatched[0], PLAYER_ONE), RollbackSession(&mismatched[1], PLAYER_TWO) };
+		for (uint32_t t = 0; t < 10; ++t) {
+			for (int p = 0; p < 2; ++p) {
+				refusing[p].write_packet(&packet);
+				refusing[1 - p].read_packet(packet.data(), packet.size());
+				refusing[p].advance(0);
+			}
+		}
+		if (refusing[0].refused.empty() || refusing[1].refused.empty() || refusing[0].tick != 0 || refusing[1].tick != 0) {
+			std::cout << "rollback: sessions with different walk speeds started anyway" << std::endl;
+			return false;
+		}
+		std::cout << "rollback: mismatched rules refused (\"" << refusing[0].refused << "\"); a stranger's packets were dropped" << std::endl;
+	}
+
+	return true;
+}
+
+//The degree sin/cos that the game used before DegreeTrig (for comparison):
+static double libm_sin(float angle) { return std::sin(angle * 3.14159265 / 180); }
+static double libm_cos(float angle) { return std::cos(angle * 3.14159265 / 180); }
+
+//Checks DegreeTrig's accuracy, then times it against libm:
+static bool bench_trig() {
+	double const pi = 3.14159265358979323846;
+	bool ok = true;
+
+	{ //table path, at every table step in [-90, 90] (further out, the libm reference loses accuracy converting to radians):
+		double worst = 0.0;
+		for (int32_t i = -90 * DEGREE_TABLE_STEPS_PER_DEGREE; i <= 90 * DEGREE_TABLE_STEPS_PER_DEGREE; ++i) {
+			float angle = float(i) / DEGREE_TABLE_STEPS_PER_DEGREE;
+			worst = std::max(worst, std::abs(sin_degrees(angle) - std::sin(angle * (pi / 180.0))));
+			worst = std::max(worst, std::abs(cos_degrees(angle) - std::cos(angle * (pi / 180.0))));
+		}
+		std::cout << "trig: table max error " << worst << std::endl;
+		if (worst > 4e-16) ok = false;
+	}
+
+	{ //16.16 fixed point, every 1/64 of a degree around the circle and then some:
+		double worst = 0.0;
+		for (int32_t raw = -(400 << 16); raw <= (400 << 16); raw += 1 << 10) {
+			double radians = (raw / 65536.0) * (pi / 180.0);
+			worst = std::max(worst, std::abs(sin_degrees_16_16(raw) / 65536.0 - std::sin(radians)));
+			worst = std::max(worst, std::abs(cos_degrees_16_16(raw) / 65536.0 - std::cos(radians)));
+		}
+		std::cout << "trig: 16.16 fixed point max error " << worst << " (bound " << 1.0 / 32768.0 << ")" << std::endl;
+		if (worst > 1.0 / 32768.0) ok = false;
+	}
+
+	{ //batched path, over a dense sweep (and the SIMD and one-at-a-time versions must agree):
+		std::vector< float > angles;
+		for (int32_t i = -200000; i <= 200000; ++i) angles.emplace_back(i * 0.0137f);
+		angles.emplace_back(99999.0f);
+		angles.emplace_back(-99999.5f);
+		std::vector< float > sines(angles.size()), cosines(angles.size());
+		sincos_degrees(angles.data(), angles.size(), sines.data(), cosines.data());
+
+		double worst = 0.0;
+		bool agree = true;
+		for (size_t i = 0; i < angles.size(); ++i) {
+			worst = std::max(worst, std::abs(sines[i] - std::sin(double(angles[i]) * (pi / 180.0))));
+			worst = std::max(worst, std::abs(cosines[i] - std::cos(double(angles[i]) * (pi / 180.0))));
+			float s, c;
+			sincos_degrees(&angles[i], 1, &s, &c);
+			if (std::memcmp(&s, &sines[i], sizeof(float)) != 0 || std::memcmp(&c, &cosines[i], sizeof(float)) != 0) agree = false;
+		}
+		std::cout << "trig: sincos_degrees max error " << worst << " (bound " << SINCOS_DEGREES_MAX_ERROR << ")"
+			<< (agree ? "" : "; SIMD and scalar results DIFFER") << std::endl;
+		if (worst > SINCOS_DEGREES_MAX_ERROR || !agree) ok = false;
+	}
+
+	{ //timing, on the angles a real match produces:
+		std::vector< float > angles;
+		RewindSim sim;
+		RandomInputs inputs(0x5eed);
+		while (angles.size() < 4096) {
+			sim.step(inputs.next(0), inputs.next(1));
+			angles.emplace_back(sim.playerOne().right_arm_angle);
+			angles.emplace_back(sim.playerOne().left_arm_angle);
+			angles.emplace_back(sim.playerTwo().left_arm_angle);
+			angles.emplace_back(sim.playerTwo().right_arm_angle);
+		}
+		uint32_t const passes = 2000;
+		double count = double(passes) * angles.size();
+
+		auto time = [&](char const *name, std::function< double() > run) {
+			auto start = std::chrono::high_resolution_clock::now();
+			double sum = run();
+			double seconds = seconds_since(start);
+			std::cout << "trig: " << name << ": " << (seconds / count) * 1e9 << "ns per sin+cos (checksum " << sum << ")" << std::endl;
+		};
+
+		time("libm get_sin/get_cos (old)", [&]() {
+			double sum = 0.0;
+			for (uint32_t p = 0; p < passes; ++p) {
+				for (float a : angles) sum += libm_sin(a) + libm_cos(a);
+			}
+			return sum;
+		});
+		time("sin_degrees/cos_degrees (table)", [&]() {
+			double sum = 0.0;
+			for (uint32_t p = 0; p < passes; ++p) {
+				for (float a : angles) sum += sin_degrees(a) + cos_degrees(a);
+			}
+			return sum;
+		});
+		std::vector< float > sines(angles.size()), cosines(angles.size());
+		time("sincos_degrees (batched float)", [&]() {
+			double sum = 0.0;
+			for (uint32_t p = 0; p < passes; ++p) {
+				sincos_degrees(angles.data(), angles.size(), sines.data(), cosines.data());
+				sum += sines[p % sines.size()] + cosines[p % cosines.size()];
+			}
+			return sum;
+		});
+	}
+
+	return ok;
+}
+
+//Checks the separating-axis tests against brute force, then times them:
+static bool bench_collision() {
+	std::mt19937 mt(0x5eed);
+	auto uniform = [&mt](float lo, float hi) {
+		return lo + (hi - lo) * (mt() / 4294967296.0f);
+	};
+	auto random_shape = [&]() {
+		uint32_t kind = mt() % 3;
+		glm::vec2 at = glm::vec2(uniform(-3.0f, 3.0f), uniform(-3.0f, 3.0f));
+		if (kind == 0) return box_shape(at, glm::vec2(uniform(0.05f, 1.5f), uniform(0.05f, 1.5f)));
+		if (kind == 1) return arm_shape(at, glm::vec2(uniform(-1.5f, 1.5f), uniform(0.1f, 0.5f)), std::round(uniform(-180.0f, 180.0f) * 4.0f) / 4.0f);
+		ConvexShape triangle;
+		triangle.count = 3;
+		for (uint32_t c = 0; c < 3; ++c) triangle.corners[c] = at + glm::vec2(uniform(-1.5f, 1.5f), uniform(-1.5f, 1.5f));
+		return triangle;
+	};
+
+	//brute force: convex shapes overlap if edges cross or one contains a corner of the other
+	auto cross = [](glm::vec2 a, glm::vec2 b) { return a.x * b.y - a.y * b.x; };
+	auto contains = [&](ConvexShape const &s, glm::vec2 p) {
+		bool any_pos = false, any_neg = false;
+		for (uint32_t i = 0; i < s.count; ++i) {
+			float side = cross(s.corners[(i + 1) % s.count] - s.corners[i], p - s.corners[i]);
+			if (side > 0.0f) any_pos = true;
+			if (side < 0.0f) any_neg = true;
+		}
+		return !(any_pos && any_neg);
+	};
+	auto edges_cross = [&](glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b1) {
+		float d1 = cross(a1 - a0, b0 - a0), d2 = cross(a1 - a0, b1 - a0);
+		float d3 = cross(b1 - b0, a0 - b0), d4 = cross(b1 - b0, a1 - b0);
+		return ((d1 > 0.0f) != (d2 > 0.0f)) && ((d3 > 0.0f) != (d4 > 0.0f));
+	};
+	auto brute = [&](ConvexShape const &a, ConvexShape const &b) {
+		for (uint32_t i = 0; i < a.count; ++i) {
+			if (contains(b, a.corners[i])) return true;
+			for (uint32_t j = 0; j < b.count; ++j) {
+				if (edges_cross(a.corners[i], a.corners[(i + 1) % a.count], b.corners[j], b.corners[(j + 1) % b.count])) return true;
+			}
+		}
+		for (uint32_t j = 0; j < b.count; ++j) {
+			if (contains(a, b.corners[j])) return true;
+		}
+		return false;
+	};
+	auto moved = [](ConvexShape s, glm::vec2 by) {
+		for (uint32_t c = 0; c < s.count; ++c) s.corners[c] += by;
+		return s;
+	};
+
+	size_t const count = 1 << 20;
+	std::vector< ConvexShape > a(count), b(count);
+	for (size_t i = 0; i < count; ++i) {
+		a[i] = random_shape();
+		b[i] = random_shape();
+	}
+	std::vector< Contact > contacts(count);
+
+	{ //correctness (skipping near-touching pairs, where float rounding can go either way):
+		collide(a.data(), b.data(), count, contacts.data());
+		uint32_t hits = 0, checked = 0;
+		for (size_t i = 0; i < count; i += 16) {
+			Contact const &contact = contacts[i];
+			if (contact.hit && contact.depth < 1e-3f) continue;
+			checked += 1;
+			if (contact.hit != brute(a[i], b[i])) {
+				std::cout << "collision: pair " << i << " disagrees with brute force" << std::endl;
+				return false;
+			}
+			if (!contact.hit) continue;
+			hits += 1;
+			Contact after[2];
+			ConvexShape pushed[2] = { moved(b[i], contact.normal * (contact.depth + 1e-3f)), moved(b[i], contact.normal * (contact.depth - 1e-3f)) };
+			collide_one(a[i], pushed, 2, after);
+			if (after[0].hit || !after[1].hit) {
+				std::cout << "collision: pair " << i << " has the wrong contact normal or depth" << std::endl;
+				return false;
+			}
+		}
+		std::cout << "collision: " << checked << " random pairs (" << hits << " hitting) agree with brute force" << std::endl;
+	}
+
+	{ //timing:
+		auto start = std::chrono::high_resolution_clock::now();
+		uint32_t const passes = 8;
+		for (uint32_t p = 0; p < passes; ++p) {
+			collide(a.data(), b.data(), count, contacts.data());
+		}
+		double seconds = seconds_since(start);
+		std::cout << "collision: " << (double(passes) * count / seconds) / 1e6 << "M pairs/s" << std::endl;
+	}
+
+	//whole matches with each hit rule:
+	char const *rule_names[] = { "original", "exact", "swept" };
+	for (uint32_t rules = HITS_TIP; rules <= HITS_SWEPT; ++rules) {
+		RewindSim sim;
+		sim.exact_hits = rules;
+		RandomInputs inputs(0x5eed);
+		uint32_t const ticks = 2000000;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t t = 0; t < ticks; ++t) sim.step(inputs.next(0), inputs.next(1));
+		double seconds = seconds_since(start);
+		std::cout << "collision: " << rule_names[rules] << " hit rules: " << (ticks / seconds) / 1e6
+			<< "M ticks/s (" << sim.round << " rounds, " << sim.left_score << "-" << sim.right_score << ")" << std::endl;
+	}
+
+	return true;
+}
+
+//Checks sweep_sword against testing the sword at thousands of angles along each swing,
+// then checks that swept hits come out the same at any tick rate (and exact ones don't):
+static bool bench_swept() {
+	std::mt19937 mt(0x5eed);
+	auto uniform = [&mt](float lo, float hi) {
+		return lo + (hi - lo) * (mt() / 4294967296.0f);
+	};
+
+	{ //random swings past random boxes, against the sword tested every 1/4096th of the way:
+		uint32_t const swings = 20000;
+		uint32_t const samples = 4096;
+		uint32_t hits = 0, grazes = 0;
+		float worst_early = 0.0f; //degrees
+		for (uint32_t i = 0; i < swings; ++i) {
+			player_state player;
+			bool one = (mt() % 2 == 0);
+			player.init(glm::vec2(0.0f), one ? PLAYER_ONE : PLAYER_TWO, PALETTE_PLAYER_ONE);
+			float from = uniform(-60.0f, 0.0f), to = std::min(0.0f, from + uniform(0.0f, 40.0f));
+			if (!one) {
+				from = -from;
+				to = -to;
+			}
+			player.set_sword_angle(to);
+			ConvexShape target = box_shape(glm::vec2((one ? 1.0f : -1.0f) * uniform(0.5f, 4.5f), uniform(-4.0f, 1.0f)), glm::vec2(uniform(0.01f, 0.3f), uniform(0.01f, 0.3f)));
+
+			float time = 0.0f;
+			bool swept = sweep_sword(player, from, 2.0f, &target, 1, &time);
+
+			float first = -1.0f;
+			player_state at = player;
+			for (uint32_t s = 0; s <= samples && first < 0.0f; ++s) {
+				float t = float(s) / samples;
+				at.set_sword_angle(from + (to - from) * t);
+				Contact contact;
+				collide_one(sword_shape(at, 2.0f), &target, 1, &contact);
+				if (contact.hit) first = t;
+			}
+			if (first >= 0.0f) {
+				hits += 1;
+				//(the sweep may only find the touch early, and by no more than a leaf of the swing and a sample)
+				float leaf = SWEEP_LEAF_DEGREES / std::max(std::abs(to - from), SWEEP_LEAF_DEGREES);
+				if (!swept || time > first || first - time > leaf + 1.0f / samples) {
+					std::cout << "swept: swing " << i << " from " << from << " to " << to << " first touches at " << first
+						<< ", but the sweep says " << (swept ? std::to_string(time) : "it misses") << std::endl;
+					return false;
+				}
+				worst_early = std::max(worst_early, (first - time) * std::abs(to - from));
+			} else if (swept) {
+				grazes += 1; //(passes within a hair of the box: allowed, but should be rare)
+			}
+		}
+		if (grazes * 1000 > swings) {
+			std::cout << "swept: " << grazes << " of " << swings << " sweeps touch boxes the sword never reaches" << std::endl;
+			return false;
+		}
+		std::cout << "swept: " << swings << " random swings (" << hits << " hitting) agree with testing 4096 angles each ("
+			<< grazes << " near misses counted as hits, first touches found up to " << worst_early << " degrees early)" << std::endl;
+	}
+
+	{ //player one swings once at player two, standing still all over the place, at different tick rates:
+		float const rates[] = { 20.0f, 60.0f, 240.0f };
+		uint32_t const spots = 4000;
+		std::vector< glm::vec2 > heads(spots);
+		for (auto &head : heads) head = glm::vec2(uniform(-7.0f, -2.0f), uniform(-2.0f, 2.0f));
+		for (uint32_t rules : { uint32_t(HITS_EXACT), uint32_t(HITS_SWEPT) }) {
+			std::vector< uint8_t > landed[3];
+			for (uint32_t r = 0; r < 3; ++r) {
+				for (glm::vec2 head : heads) {
+					RewindSim sim(rates[r]);
+					sim.exact_hits = rules;
+					sim.playerTwo().reset(head);
+					sim.step(INPUT_ATTACK, 0);
+					for (uint32_t t = 0; t < uint32_t(rates[r]) && sim.round == 0; ++t) sim.step(0, 0);
+					landed[r].emplace_back(sim.left_score != 0 ? 1 : 0);
+				}
+			}
+			uint32_t differ = 0, counts[3] = {0, 0, 0};
+			for (uint32_t i = 0; i < spots; ++i) {
+				for (uint32_t r = 0; r < 3; ++r) counts[r] += landed[r][i];
+				if (landed[0][i] != landed[2][i] || landed[1][i] != landed[2][i]) differ += 1;
+			}
+			std::cout << "swept: " << (rules == HITS_SWEPT ? "swept" : "exact") << " hits, one swing at " << spots << " spots: hits " << counts[0] << " at 20 ticks/s, "
+				<< counts[1] << " at 60, " << counts[2] << " at 240 (" << differ << " spots differ)" << std::endl;
+			if (rules == HITS_SWEPT && differ != 0) {
+				std::cout << "swept: swept hits depend on the tick rate" << std::endl;
+				return false;
+			}
+		}
+	}
+
+	{ //timing, a 30 degree swing (a tick at 20 ticks/s) against a whole body:
+		RewindSim sim;
+		player_state const &attacker = sim.playerOne();
+		ConvexShape body[BodyPartCount];
+		uint32_t const count = 200000;
+		std::vector< player_state > targets(count);
+		for (auto &target : targets) {
+			target = sim.playerTwo();
+			target.update_coords(glm::vec2(uniform(-8.0f, -3.0f), uniform(-2.0f, 2.0f)));
+		}
+		uint32_t touched = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (auto const &target : targets) {
+			body_shapes(target, body);
+			float time;
+			player_state swung = attacker;
+			swung.set_sword_angle(-30.0f);
+			touched += sweep_sword(swung, -60.0f, sim.sword_tip_length, body, BodyPartCount, &time) ? 1 : 0;
+		}
+		double seconds = seconds_since(start);
+		std::cout << "swept: " << (seconds / count) * 1e9 << " ns per 30 degree sweep against a body (" << touched << " of " << count << " touching)" << std::endl;
+	}
+
+	return true;
+}
+
+//Checks the arena's grid against testing every pair, then times arenas of different sizes:
+static bool bench_arena() {
+	for (uint32_t count : {64u, 256u, 1024u, 4096u}) {
+		//random held buttons for every fighter, changing every few ticks:
+		uint32_t const period = 1024;
+		std::vector< uint8_t > stream(size_t(count) * period);
+		{
+			std::mt19937 mt(0x5eed + count);
+			std::vector< uint8_t > held(count, 0);
+			std::vector< uint32_t > hold(count, 0);
+			for (uint32_t t = 0; t < period; ++t) {
+				for (uint32_t i = 0; i < count; ++i) {
+					if (hold[i] == 0) {
+						held[i] = uint8_t(mt() & (INPUT_LEFT | INPUT_RIGHT | INPUT_ATTACK | INPUT_REWIND));
+						hold[i] = 1 + mt() % 30;
+					}
+					hold[i] -= 1;
+					stream[size_t(t) * count + i] = held[i];
+				}
+			}
+		}
+		auto run = [&](RewindArena &arena, uint32_t ticks) {
+			for (uint32_t t = 0; t < ticks; ++t) {
+				arena.step(stream.data() + size_t(t % period) * count);
+			}
+		};
+
+		if (count <= 1024) { //the grid has to find everything testing every pair finds:
+			RewindArena with_grid(count), every_pair(count);
+			every_pair.use_grid = false;
+			uint32_t const ticks = 2000;
+			run(with_grid, ticks);
+			run(every_pair, ticks);
+			for (uint32_t i = 0; i < count; ++i) {
+				if (with_grid.kills[i] != every_pair.kills[i] || with_grid.deaths[i] != every_pair.deaths[i]
+				 || with_grid.fighters[i].head != every_pair.fighters[i].head) {
+					std::cout << "arena: " << count << " fighters: fighter " << i << " differs between grid and every-pair tests" << std::endl;
+					return false;
+				}
+			}
+			std::cout << "arena: " << count << " fighters: grid matches every-pair tests for " << ticks << " ticks ("
+				<< with_grid.pair_tests / double(ticks) / count << " vs " << every_pair.pair_tests / double(ticks) / count << " pairs per fighter per tick)" << std::endl;
+		}
+
+		RewindArena arena(count);
+		uint32_t const ticks = std::max(200u, 2000000u / count);
+		auto start = std::chrono::high_resolution_clock::now();
+		run(arena, ticks);
+		double seconds = seconds_since(start);
+		uint64_t kills = 0;
+		for (uint32_t k : arena.kills) kills += k;
+		std::cout << "arena: " << count << " fighters: " << ticks / seconds << " ticks/s = "
+			<< (seconds / ticks / count) * 1e9 << "ns per fighter per tick (" << kills << " kills)" << std::endl;
+	}
+
+	return true;
+}
+
+//Plays the search bot against random buttons, reporting rollouts/second with one thread and with all of them:
+static bool bench_mcts() {
+	std::vector< uint32_t > thread_counts = {1};
+	if (std::thread::hardware_concurrency() > 1) thread_counts.emplace_back(std::thread::hardware_concurrency());
+	for (uint32_t threads : thread_counts) {
+		RewindSim sim;
+		MctsBot bot(PLAYER_TWO, sim.tick_rate, threads);
+		RandomInputs inputs(0x5eed);
+
+		double const budget = 0.002; //seconds per tick
+		uint32_t const ticks = uint32_t(20.0f * sim.tick_rate);
+		uint64_t reused = 0;
+		uint32_t decisions = 0;
+		for (uint32_t t = 0; t < ticks; ++t) {
+			uint8_t input = bot.act(sim, budget);
+			if (bot.stats.decisions != decisions) {
+				decisions = bot.stats.decisions;
+				reused += bot.stats.reused;
+			}
+			sim.step(inputs.next(0), input);
+		}
+
+		MctsStats const &stats = bot.stats;
+		std::cout << "mcts: " << threads << " thread" << (threads == 1 ? "" : "s") << ": "
+			<< (stats.rollouts / stats.search_seconds) / 1e3 << "k rollouts/s ("
+			<< (stats.rollout_ticks / stats.search_seconds) / 1e6 << "M ticks/s, "
+			<< double(stats.rollouts) / ticks << " rollouts per " << budget * 1e3 << "ms tick, "
+			<< double(reused) / std::max(1u, decisions) << " nodes kept per decision); "
+			<< "bot " << sim.right_score << " - " << sim.left_score << " random over " << ticks / sim.tick_rate << "s" << std::endl;
+	}
+	return true;
+}
+
+//Checks Timeline seeks against states saved while recording an hour of play, then times scrubbing:
+static bool bench_timeline() {
+	uint32_t const ticks = uint32_t(60.0f * 60.0f * TICK_RATE); //an hour of play
+
+	std::vector< uint32_t > check_ticks;
+	std::vector< RewindSnapshot > expected;
+	std::mt19937 mt(0x5eed);
+	for (uint32_t i = 0; i < 200; ++i) check_ticks.emplace_back(mt() % (ticks + 1));
+	check_ticks.emplace_back(0);
+	check_ticks.emplace_back(ticks);
+	std::sort(check_ticks.begin(), check_ticks.end());
+	expected.resize(check_ticks.size());
+
+	auto same = [](RewindSnapshot const &a, RewindSnapshot const &b) {
+		return std::memcmp(&a.state, &b.state, sizeof(RewindSnapshot::State)) == 0
+		    && a.tail.size() == b.tail.size()
+		    && std::memcmp(a.tail.data(), b.tail.data(), a.tail.size() * sizeof(glm::vec4)) == 0;
+	};
+
+	RewindSim sim;
+	Timeline timeline(sim);
+	{ //seeking before anything is recorded (as pausing and stepping right away do) stays at the start:
+		RewindSnapshot initial, got;
+		sim.save(&initial);
+		timeline.seek(&sim, 1);
+		sim.save(&got);
+		if (timeline.tick != 0 || !same(got, initial)) {
+			std::cout << "timeline: seeking an empty timeline didn't stay at tick 0" << std::endl;
+			return false;
+		}
+	}
+	{ //record:
+		RandomInputs inputs(0x5eed);
+		size_t c = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t t = 0; t <= ticks; ++t) {
+			while (c < check_ticks.size() && check_ticks[c] == t) sim.save(&expected[c++]);
+			if (t == ticks) break;
+			uint8_t player_one_input = inputs.next(0);
+			uint8_t player_two_input = inputs.next(1);
+			timeline.record(sim, player_one_input, player_two_input);
+			sim.step(player_one_input, player_two_input);
+		}
+		double seconds = seconds_since(start);
+		std::cout << "timeline: " << ticks << " ticks (" << sim.round << " rounds) in " << timeline.checkpoints.size() << " checkpoints, "
+			<< timeline.bytes_used() / (1024.0 * 1024.0) << " MiB; recording at " << (ticks / seconds) / 1e6 << "M ticks/s" << std::endl;
+	}
+
+	//seeking (in a random order, so every kind of jump gets checked):
+	RewindSnapshot got;
+	std::vector< size_t > order(check_ticks.size());
+	for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+	std::shuffle(order.begin(), order.end(), mt);
+	for (auto i : order) {
+		timeline.seek(&sim, check_ticks[i]);
+		sim.save(&got);
+		if (timeline.tick != check_ticks[i] || !same(got, expected[i])) {
+			std::cout << "timeline: seeking to tick " << check_ticks[i] << " gave a different state" << std::endl;
+			return false;
+		}
+	}
+
+	//scrubbing, as the debugger does it (random jumps, then single ticks back and forward):
+	uint32_t const count = 20000;
+	double worst = 0.0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t to = timeline.tick;
+		if (i % 4 == 0) to = mt() % (ticks + 1);
+		else if (i % 4 == 1 && to > 0) to -= 1;
+		else to += 1;
+		auto before = std::chrono::high_resolution_clock::now();
+		timeline.seek(&sim, to);
+		worst = std::max(worst, seconds_since(before));
+	}
+	double seconds = seconds_since(start);
+	std::cout << "timeline: scrubbing: " << (seconds / count) * 1e6 << "us per seek, " << worst * 1e6 << "us at worst (checked " << check_ticks.size() << " seeks)" << std::endl;
+
+	//branching: going back and playing on differently must leave a timeline that seeks correctly:
+	timeline.seek(&sim, ticks / 2);
+	timeline.truncate(ticks / 2);
+	RandomInputs other(0xb4a9c4);
+	for (uint32_t t = ticks / 2; t < ticks; ++t) {
+		uint8_t player_one_input = other.next(0);
+		uint8_t player_two_input = other.next(1);
+		timeline.record(sim, player_one_input, player_two_input);
+		sim.step(player_one_input, player_two_input);
+	}
+	sim.save(&expected.back());
+	timeline.seek(&sim, 0);
+	timeline.seek(&sim, ticks);
+	sim.save(&got);
+	if (!same(got, expected.back())) {
+		std::cout << "timeline: seeking after going back and playing on gave a different state" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//Checks RewindHistory against a player's rewind log through long rewinds, then reports its memory use and speed:
+static bool bench_history() {
+	RewindParams rules;
+	rules.max_rewind = 30.0f; //seconds of history a rewind can go back
+	rules.rewind_speed = 2.5f; //(so rewinds blend between entries)
+	float const window = rules.max_rewind;
+	size_t const capacity = rewind_log_size(rules, TICK_RATE);
+	float const tick = 1.0f / TICK_RATE;
+	float const walk = rules.walk_speed;
+	float const ring_bytes_per_second = sizeof(glm::vec4) * TICK_RATE;
+
+	//A lone fighter; every push to its log is repeated on a RewindHistory, and
+	// every tick of rewinding is repeated on a copy of the fighter that rewinds through it:
+	player_info fighter(glm::vec2(0.0f), PLAYER_ONE);
+	fighter.rewind_log = RewindLog(capacity);
+	RewindHistory history(capacity);
+	RandomInputs inputs(0x5eed);
+
+	auto matches = [](glm::vec4 const &a, glm::vec4 const &b) {
+		float const tolerance = (HISTORY_POSITION_TOLERANCE + 1.0f) / HISTORY_POSITION_STEPS;
+		return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance
+			&& std::abs(a.z - b.z) <= 0.5f / HISTORY_ANGLE_STEPS && a.w == b.w;
+	};
+
+	uint32_t const ticks = uint32_t(600.0f * TICK_RATE);
+	uint32_t rewinds = 0;
+	size_t max_bytes = 0;
+	bool filled = false;
+	std::vector< glm::vec4 > ring_entries(capacity), history_entries(capacity * 2);
+	for (uint32_t t = 0; t < ticks; ++t) {
+		int was_rewinding = fighter.is_rewinding;
+		apply_input(inputs.next(0), fighter, 0);
+		if (fighter.is_rewinding == 1 && was_rewinding == 0) rewinds += 1;
+		if (fighter.is_rewinding == 0) {
+			update_cooldown(fighter, tick, rules);
+			update_swing(fighter, 1.0f, rules);
+			float x = fighter.head.x + walk * (fighter.right_walk - fighter.left_walk);
+			fighter.update_coords(glm::vec2(std::max(-10.0f, std::min(10.0f, x)), 0.0f));
+			glm::vec4 entry(fighter.head.x, fighter.head.y, fighter.right_arm_angle, fighter.is_attacking);
+			fighter.rewind_log.push_front(entry);
+			history.push_front(entry);
+		} else {
+			player_state copy = fighter;
+			update_rewind(fighter, fighter.rewind_log, tick, rules.rewind_speed, rules.max_rewind);
+			if (fighter.is_rewinding == 1) {
+				update_rewind(copy, history, tick, rules.rewind_speed, rules.max_rewind);
+				if (!matches(glm::vec4(copy.head.x, copy.head.y, copy.right_arm_angle, copy.is_attacking),
+				             glm::vec4(fighter.head.x, fighter.head.y, fighter.right_arm_angle, fighter.is_attacking))
+				 || copy.rewind_offset != fighter.rewind_offset) {
+					std::cout << "history: rewinding through it differs from rewinding through the RingBuffer at tick " << t << std::endl;
+					return false;
+				}
+			}
+		}
+		max_bytes = std::max(max_bytes, history.bytes_used());
+
+		//(once the RingBuffer has dropped entries, the history may hold more)
+		filled = filled || fighter.rewind_log.size() == capacity;
+		if (history.size() < fighter.rewind_log.size() || (!filled && history.size() != fighter.rewind_log.size())
+		 || (!fighter.rewind_log.empty() && !matches(history.front(), fighter.rewind_log.front()))) {
+			std::cout << "history: newest entry differs from the RingBuffer's at tick " << t << std::endl;
+
+			return false;
+		}
+		if (t % 997 == 0) {
+			fighter.rewind_log.copy_to(ring_entries.data());
+			history.copy_to(history_entries.data());
+			for (size_t i = 0; i < fighter.rewind_log.size(); ++i) {
+				if (!matches(ring_entries[i], history_entries[i])) {
+					std::cout << "history: entry " << i << " differs from the RingBuffer's at tick " << t << std::endl;
+					return false;
+				}
+			}
+		}
+	}
+	std::cout << "history: matches a RingBuffer through " << ticks / TICK_RATE << "s of random play (" << rewinds << " rewinds of up to " << window << "s of history)" << std::endl;
+	std::cout << "history: random play: " << max_bytes / (capacity / TICK_RATE) << " bytes/s at most (vs " << ring_bytes_per_second << " bytes/s in a RingBuffer)" << std::endl;
+
+	//Memory for steady kinds of play, over a whole window:
+	struct Pattern {
+		char const *name;
+		uint8_t input;
+	};
+	for (auto const &pattern : { Pattern{"standing still", 0}, Pattern{"walking", INPUT_RIGHT}, Pattern{"swinging", INPUT_ATTACK} }) {
+		RewindHistory steady(capacity);
+		player_info p(glm::vec2(-10.0f, 0.0f), PLAYER_ONE);
+		for (size_t t = 0; t < capacity; ++t) {
+			apply_input(pattern.input, p, 0);
+			update_swing(p, 1.0f, rules);
+			if (pattern.input & INPUT_RIGHT) p.update_coords(glm::vec2(p.head.x + walk * ((t / 120) % 2 ? -1.0f : 1.0f), 0.0f));
+			steady.push_front(glm::vec4(p.head.x, p.head.y, p.right_arm_angle, p.is_attacking));
+		}
+		std::cout << "history: " << pattern.name << ": " << steady.bytes_used() / window << " bytes/s" << std::endl;
+	}
+
+	//Reverse iteration, as update_rewind does it:
+	{
+		RingBuffer< glm::vec4 > ring(capacity);
+		RewindHistory full(capacity);
+		RandomInputs more(0x5eed);
+		player_info p(glm::vec2(0.0f), PLAYER_ONE);
+		for (size_t t = 0; t < capacity; ++t) {
+			apply_input(more.next(0) & ~INPUT_REWIND, p, 0);
+			update_swing(p, 1.0f, rules);
+			float x = p.head.x + walk * (p.right_walk - p.left_walk);
+			p.update_coords(glm::vec2(std::max(-10.0f, std::min(10.0f, x)), 0.0f));
+			glm::vec4 entry(p.head.x, p.head.y, p.right_arm_angle, p.is_attacking);
+			ring.push_front(entry);
+			full.push_front(entry);
+		}
+		uint32_t const passes = 200;
+		float sum = 0.0f; //(so the reads can't be skipped)
+		double ring_seconds = 0.0, history_seconds = 0.0;
+		for (uint32_t pass = 0; pass < passes; ++pass) {
+			RingBuffer< glm::vec4 > r = ring;
+			RewindHistory h = full;
+			auto start = std::chrono::high_resolution_clock::now();
+			while (!r.empty()) {
+				sum += r.front().x;
+				r.pop_front();
+			}
+			ring_seconds += seconds_since(start);
+			start = std::chrono::high_resolution_clock::now();
+			while (!h.empty()) {
+				sum += h.front().x;
+				h.pop_front();
+			}
+			history_seconds += seconds_since(start);
+		}
+		std::cout << "history: rewinding through " << window << "s: " << history_seconds / passes / capacity * 1e9 << "ns per entry (vs "
+			<< ring_seconds / passes / capacity * 1e9 << "ns in a RingBuffer)" << (sum == 12345.0f ? " " : "") << std::endl;
+	}
+
+	return true;
+}
+
+//One tick of a lone fighter (walking, swinging and rewinding as bench_history plays them), logging to 'log':
+template< typename Log >
+static void lone_fighter_tick(player_state &fighter, Log &log, uint8_t input, RewindParams const &rules) {
+	float const tick = 1.0f / TICK_RATE;
+	apply_input(input, fighter, 0);
+	if (fighter.is_rewinding == 0) {
+		update_cooldown(fighter, tick, rules);
+		update_swing(fighter, 1.0f, rules);
+		float x = fighter.head.x + rules.walk_speed * (fighter.right_walk - fighter.left_walk);
+		fighter.update_coords(glm::vec2(std::max(-10.0f, std::min(10.0f, x)), 0.0f));
+		log.push_front(glm::vec4(fighter.head.x, fighter.head.y, fighter.right_arm_angle, fighter.is_attacking));
+	} else {
+		update_rewind(fighter, log, tick, rules.rewind_speed, rules.max_rewind);
+	}
+}
+
+//Rewind log branches (RewindLog, a PersistentLog): checks branches against RingBuffer copies while many
+// of them play and rewind at once off one timeline, plays two rewinders at once, then reports what
+// branching a match costs against copying its logs:
+static bool bench_branch() {
+	//A timeline (or a branch of one): the same fighter logged to a RingBuffer and to a RewindLog:
+	struct Branch {
+		player_state ring_fighter, log_fighter;
+		RingBuffer< glm::vec4 > ring;
+		RewindLog log;
+		RandomInputs inputs;
+		uint32_t ticks_left;
+	};
+	auto same = [](Branch const &b) {
+		player_state const &r = b.ring_fighter, &l = b.log_fighter;
+		if (r.head != l.head || r.right_arm_angle != l.right_arm_angle || r.is_attacking != l.is_attacking
+		 || r.is_rewinding != l.is_rewinding || r.is_cooling != l.is_cooling
+		 || r.rewind_offset != l.rewind_offset || r.seconds_passed != l.seconds_passed) return false;
+		return b.ring.size() == b.log.size() && (b.ring.empty() || b.ring.front() == b.log.front());
+	};
+
+	for (float window : { MAX_REWIND, 30.0f }) {
+		RewindParams rules;
+		rules.max_rewind = window;
+		size_t const capacity = rewind_log_size(rules, TICK_RATE);
+
+		player_state fighter = player_info(glm::vec2(0.0f), PLAYER_ONE);
+		Branch trunk{ fighter, fighter, RingBuffer< glm::vec4 >(capacity), RewindLog(capacity), RandomInputs(0x5eed), 0 };
+		std::vector< Branch > branches;
+		std::mt19937 mt(0xb7a9c8);
+		uint32_t const ticks = uint32_t(600.0f * TICK_RATE);
+		uint32_t branched = 0, rewinds = 0;
+		std::vector< glm::vec4 > ring_entries(capacity), log_entries(capacity);
+		for (uint32_t t = 0; t < ticks; ++t) {
+			//Every so often, branch the trunk and play the branch on for up to two windows' worth of ticks:
+			if (t % 37 == 0 && branches.size() < 8) {
+				branches.emplace_back(trunk);
+				branches.back().inputs = RandomInputs(uint32_t(mt()));
+				branches.back().ticks_left = 1 + mt() % uint32_t(2 * capacity);
+				branched += 1;
+			}
+			for (size_t i = 0; i <= branches.size(); ++i) {
+				Branch &b = (i < branches.size() ? branches[i] : trunk);
+				uint8_t input = b.inputs.next(0);
+				if (b.ring_fighter.is_rewinding == 0 && (input & INPUT_REWIND) && b.ring_fighter.is_cooling == 0) rewinds += 1;
+				lone_fighter_tick(b.ring_fighter, b.ring, input, rules);
+				lone_fighter_tick(b.log_fighter, b.log, input, rules);
+				if (!same(b)) {
+					std::cout << "branch: " << (i < branches.size() ? "a branch" : "the trunk") << " differs from its RingBuffer at tick " << t << " (" << window << "s window)" << std::endl;
+					return false;
+				}
+				if (t % 61 == 0) {
+					b.ring.copy_to(ring_entries.data());
+					b.log.copy_to(log_entries.data());
+					if (!std::equal(ring_entries.begin(), ring_entries.begin() + b.ring.size(), log_entries.begin())) {
+						std::cout << "branch: " << (i < branches.size() ? "a branch" : "the trunk") << "'s entries differ from its RingBuffer's at tick " << t << " (" << window << "s window)" << std::endl;
+						return false;
+					}
+				}
+			}
+			for (size_t i = 0; i < branches.size(); ) {
+				branches[i].ticks_left -= 1;
+				if (branches[i].ticks_left == 0) {
+					std::swap(branches[i], branches.back());
+					branches.pop_back();
+				} else {
+					++i;
+				}
+			}
+		}
+		std::cout << "branch: " << branched << " branches (" << rewinds << " rewinds) of a " << window << "s window match RingBuffer copies through " << ticks / TICK_RATE << "s of random play" << std::endl;
+	}
+
+	//Two rewinders: a match by RewindSim::two_rewinders, branched every so often; each branch
+	// must play on exactly as a match restored from a snapshot of the same moment does:
+	{
+		RewindSim sim;
+		sim.two_rewinders = 1;
+		RandomInputs inputs(0x5eed);
+		RewindSnapshot snapshot;
+		RewindSim restored;
+		uint32_t const ticks = uint32_t(600.0f * TICK_RATE);
+		uint32_t both = 0, checked = 0;
+		for (uint32_t t = 0; t < ticks; ++t) {
+			//(both players hold rewind together now and then)
+			uint8_t one = inputs.next(0), two = inputs.next(1);
+			if ((t / 90) % 4 == 0) {
+				one |= INPUT_REWIND;
+				two |= INPUT_REWIND;
+			}
+			sim.step(one, two);
+			if (sim.playerOne().is_rewinding == 1 && sim.playerTwo().is_rewinding == 1) both += 1;
+			if (t % 97 == 0) {
+				RewindSim branch = sim;
+				sim.save(&snapshot);
+				restored.restore(snapshot);
+				RandomInputs ahead(t);
+				for (uint32_t a = 0; a < 120; ++a) {
+					uint8_t x = ahead.next(0), y = ahead.next(1);
+					branch.step(x, y);
+					restored.step(x, y);
+					if (hash_state(branch, 0).chain != hash_state(restored, 0).chain) {
+						std::cout << "branch: a branch of a two-rewinder match differs from a restored snapshot " << a + 1 << " ticks after tick " << t << std::endl;
+						return false;
+					}
+				}
+				checked += 1;
+			}
+		}
+		std::cout << "branch: two rewinders: both rewinding on " << both << " of " << ticks << " ticks; " << checked
+			<< " branches play on as restored snapshots do (" << sim.round << " rounds, " << sim.left_score << "-" << sim.right_score << ")" << std::endl;
+		if (both == 0) {
+			std::cout << "branch: two rewinders never rewound at once" << std::endl;
+			return false;
+		}
+	}
+
+	//Cost of branching a match (copying it and playing a tick, which copies a path
+	// of each log) against restoring it from a snapshot, as windows grow:
+	for (float window : { MAX_REWIND, 30.0f, 240.0f }) {
+		RewindParams rules;
+		rules.max_rewind = window;
+		RewindSim sim(TICK_RATE, rules);
+		sim.two_rewinders = 1;
+		size_t const capacity = rewind_log_size(rules, TICK_RATE);
+		for (uint32_t t = 0; sim.playerOne().rewind_log.size() < capacity; ++t) {
+			uint8_t walk = ((t / 40) % 2 ? INPUT_LEFT : INPUT_RIGHT); //(no swings, so the round, and the logs, go on)
+			sim.step(walk, walk);
+		}
+		//both rewinding, as they would be when a rollback or lookahead branches off:
+		sim.step(INPUT_REWIND, INPUT_REWIND);
+
+		uint32_t const count = (window > 30.0f ? 2000 : 20000);
+		float sum = 0.0f; //(so the work can't be skipped)
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < count; ++i) {
+			RewindSim branch = sim;
+			branch.step(INPUT_REWIND, 0);
+			sum += branch.playerTwo().rewind_log.front().x;
+		}
+		double branch_seconds = seconds_since(start);
+		RewindSnapshot snapshot;
+		sim.save(&snapshot);
+		RewindSim restored(TICK_RATE, rules);
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < count; ++i) {
+			restored.restore(snapshot);
+			restored.step(INPUT_REWIND, 0);
+			sum += restored.playerTwo().rewind_log.front().x;
+		}
+		double restore_seconds = seconds_since(start);
+		RewindSim branch = sim;
+		branch.step(INPUT_REWIND, 0);
+		std::cout << "branch: " << window << "s window (" << capacity << " entries a log): branching a match and playing a tick "
+			<< branch_seconds / count * 1e9 << "ns (vs " << restore_seconds / count * 1e9 << "ns restoring a snapshot); the branch owns "
+			<< branch.playerOne().rewind_log.bytes_owned() + branch.playerTwo().rewind_log.bytes_owned() << " bytes of log (vs "
+			<< 2 * capacity * sizeof(glm::vec4) << " in a copy)" << (sum == 12345.0f ? " " : "") << std::endl;
+	}
+
+	return true;
+}
+
+//Per-tick state hashing: cost per tick, and whether a deliberate desync gets found where it happened:
+static bool bench_hash() {
+	uint32_t const ticks = uint32_t(10.0f * 60.0f * TICK_RATE); //ten minutes of play
+
+	std::vector< uint8_t > inputs[2];
+	{
+		RandomInputs random(0x5eed);
+		for (uint32_t t = 0; t < ticks; ++t) {
+			inputs[0].emplace_back(random.next(0));
+			inputs[1].emplace_back(random.next(1));
+		}
+	}
+
+	//stepping alone, then stepping and hashing (best of a few runs, since the difference is small):
+	double step_seconds = 1e9, hash_seconds = 1e9;
+	for (uint32_t run = 0; run < 3; ++run) {
+		RewindSim sim;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t t = 0; t < ticks; ++t) sim.step(inputs[0][t], inputs[1][t]);
+		step_seconds = std::min(step_seconds, seconds_since(start));
+	}
+	uint64_t timed_chain = 0;
+	for (uint32_t run = 0; run < 3; ++run) {
+		RewindSim sim;
+		uint64_t chain = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t t = 0; t < ticks; ++t) {
+			sim.step(inputs[0][t], inputs[1][t]);
+			chain = hash_state(sim, chain).chain;
+		}
+		hash_seconds = std::min(hash_seconds, seconds_since(start));
+		timed_chain = chain;
+	}
+	std::cout << "hash: " << ticks << " ticks; step " << step_seconds / ticks * 1e9 << "ns/tick, step + hash "
+		<< hash_seconds / ticks * 1e9 << "ns/tick (" << (hash_seconds - step_seconds) / ticks * 1e9 << "ns for hashing)" << std::endl;
+
+	std::vector< StateHash > hashes;
+	hashes.reserve(ticks);
+	{
+		RewindSim sim;
+		uint64_t chain = 0;
+		for (uint32_t t = 0; t < ticks; ++t) {
+			sim.step(inputs[0][t], inputs[1][t]);
+			hashes.emplace_back(hash_state(sim, chain));
+			chain = hashes.back().chain;
+		}
+		if (chain != timed_chain) {
+			std::cout << "hash: the same match hashed differently twice" << std::endl;
+			return false;
+		}
+	}
+
+	//snapshots hash the same as the matches they came from:
+	{
+		RewindSim sim;
+		RewindSnapshot snapshot;
+		uint64_t chain = 0;
+		for (uint32_t t = 0; t < ticks; ++t) {
+			sim.step(inputs[0][t], inputs[1][t]);
+			sim.save(&snapshot);
+			StateHash hash = hash_state(snapshot, chain);
+			if (std::memcmp(&hash, &hashes[t], sizeof(StateHash)) != 0) {
+				std::cout << "hash: snapshot after tick " << (t + 1) << " hashes differently from its match" << std::endl;
+				return false;
+			}
+			chain = hash.chain;
+		}
+	}
+
+	//perturb one field of a re-run, and check the desync is found on that tick, in that field:
+	struct Perturbation {
+		char const *what;
+		uint32_t field;
+		std::function< void(RewindSim &) > apply;
+	};
+	std::vector< Perturbation > perturbations = {
+		{"player one moved", HASH_ONE_POSITION, [](RewindSim &sim){ sim.playerOne().head.x = std::nextafter(sim.playerOne().head.x, 1e9f); }},
+		{"player two's sword nudged", HASH_TWO_ARMS, [](RewindSim &sim){ sim.playerTwo().right_arm_angle += 1.0f; }},
+		{"player two's cooldown", HASH_TWO_TIMERS, [](RewindSim &sim){ sim.playerTwo().seconds_cooldown += 0.25f; }},
+		{"player one's history dropped", HASH_ONE_HISTORY, [](RewindSim &sim){ if (!sim.playerOne().rewind_log.empty()) sim.playerOne().rewind_log.pop_front(); }},
+		{"score", HASH_MATCH, [](RewindSim &sim){ sim.left_score += 1; }},
+	};
+	std::mt19937 mt(0x5eed);
+	for (auto const &perturbation : perturbations) {
+		uint32_t at = 1 + mt() % (ticks - 1); //(perturbed after this many ticks)
+		RewindSim sim;
+		std::vector< StateHash > rerun;
+		uint64_t chain = 0;
+		for (uint32_t t = 0; t < ticks; ++t) {
+			sim.step(inputs[0][t], inputs[1][t]);
+			if (t + 1 == at) perturbation.apply(sim);
+			rerun.emplace_back(hash_state(sim, chain));
+			chain = rerun.back().chain;
+		}
+		Desync desync;
+		if (!find_desync(hashes, rerun, &desync)) {
+			std::cout << "hash: " << perturbation.what << " after tick " << at << " wasn't noticed" << std::endl;
+			return false;
+		}
+		if (desync.tick != at || !(desync.fields & (1u << perturbation.field))) {
+			std::cout << "hash: " << perturbation.what << " after tick " << at << " was reported after tick " << desync.tick
+				<< " (fields 0x" << std::hex << desync.fields << std::dec << ")" << std::endl;
+			return false;
+		}
+	}
+	std::cout << "hash: " << perturbations.size() << " deliberate desyncs found on the right tick and field" << std::endl;
+
+	return true;
+}
+
+//Per-phase tick timing: what the timers cost, and where tick time goes:
+static bool bench_phases() {
+	uint32_t const ticks = uint32_t(10.0f * 60.0f * TICK_RATE); //ten minutes of play
+
+	auto run = [&](bool exact_hits) {
+		RewindSim sim;
+		sim.exact_hits = exact_hits ? 1 : 0;
+		RandomInputs inputs(0x5eed);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t t = 0; t < ticks; ++t) sim.step(inputs.next(0), inputs.next(1));
+		return seconds_since(start) / ticks * 1e9;
+	};
+
+	if (!phase_timers_compiled_in()) {
+		std::cout << "phases: " << ticks << " ticks; step " << run(false) << "ns/tick; ";
+		dump_phase_timers(std::cout);
+		return true;
+	}
+
+	set_phase_timers(false);
+	double off = run(false);
+	std::cout << "phases: " << ticks << " ticks; step " << off << "ns/tick with timers compiled in but off" << std::endl;
+
+	//each set of rules separately, so every dump covers exactly one run:
+	for (bool exact_hits : {false, true}) {
+		reset_phase_timers();
+		set_phase_timers(true);
+		double on = run(exact_hits);
+		set_phase_timers(false);
+		std::cout << "phases: " << ticks << " ticks, " << (exact_hits ? "exact" : "tip") << " hits; step " << on << "ns/tick with timers on" << std::endl;
+		dump_phase_timers(std::cout);
+	}
+	reset_phase_timers();
+
+	return true;
+}
+
+//player_state as it was before palettes and body sizes moved to shared tables:
+// every player carried its own palettes, current colors, and limb positions and sizes.
+struct LegacyPlayerState {
+	glm::u8vec4 normal_colors[5];
+	glm::u8vec4 rewind_colors[5];
+	glm::u8vec4 cooldown_colors[5];
+
+	glm::vec2 head;
+	glm::vec2 head_radius = glm::vec2(0.5f, 0.5f);
+	glm::vec4 head_color;
+	glm::vec2 torso;
+	glm::vec2 torso_radius = glm::vec2(0.20, 1.0f);
+	glm::vec4 torso_color;
+	glm::vec2 left_arm;
+	glm::vec2 left_arm_radius = glm::vec2(-1.25f, 0.4f);
+	glm::u8vec4 left_arm_color;
+	float left_arm_angle;
+	glm::vec2 right_arm;
+	glm::vec2 right_arm_radius = glm::vec2(1.25f, 0.4f);
+	glm::u8vec4 right_arm_color;
+	float right_arm_angle;
+	glm::vec2 left_leg;
+	glm::vec2 left_leg_radius = glm::vec2(0.10f, 1.0f);
+	glm::u8vec4 left_leg_color;
+	glm::vec2 right_leg;
+	glm::vec2 right_leg_radius = glm::vec2(0.10f, 1.0f);
+	glm::u8vec4 right_leg_color;
+	glm::u8vec4 sword_color;
+
+	int sword_arm = 0;
+	int left_walk = 0;
+	int right_walk = 0;
+	int is_attacking = 0;
+	int is_rewinding = 0;
+	int is_cooling = 0;
+	float seconds_passed = 0;
+	float rewind_offset = 0;
+	float seconds_cooldown = 0;
+
+	void update_coords(glm::vec2 head_coord) {
+		head = head_coord;
+		torso = glm::vec2(head.x, head.y - 1.50f);
+		left_arm = glm::vec2(torso.x - 0.2f, torso.y + 0.4f);
+		right_arm = glm::vec2(torso.x + 0.2f, torso.y + 0.4f);
+		left_leg = glm::vec2(torso.x - 0.2, torso.y - 2.0f);
+		right_leg = glm::vec2(torso.x + 0.2, torso.y - 2.0f);
+	}
+
+	void update_colors(int to_update) {
+		glm::u8vec4 const *colors = (to_update == PALETTE_REWIND ? rewind_colors : (to_update == PALETTE_COOLDOWN ? cooldown_colors : normal_colors));
+		head_color = colors[0];
+		torso_color = colors[1];
+		left_arm_color = colors[2];
+		right_arm_color = colors[2];
+		left_leg_color = colors[3];
+		right_leg_color = colors[3];
+		sword_color = colors[4];
+	}
+};
+
+//(player_state's colors follow from its flags; the old layout stored them)
+static void recolor(player_state &, int) {
+}
+static void recolor(LegacyPlayerState &player, int palette) {
+	player.update_colors(palette);
+}
+
+//One tick of the per-player rules that only touch hot state (input, cooldown,
+// swing and walking, as apply_input, update_cooldown, update_swing and a
+// walk clamped to the court do for a left player), for either layout:
+template< typename P >
+static void hot_tick(P &player, uint8_t input, RewindParams const &params, float elapsed) {
+	player.left_walk = (input & INPUT_LEFT) ? 1 : 0;
+	player.right_walk = (input & INPUT_RIGHT) ? 1 : 0;
+	if ((input & INPUT_ATTACK) && player.right_arm_angle == -60) player.is_attacking = 1;
+	if (input & INPUT_REWIND) {
+		if (player.is_rewinding == 0 && player.is_cooling == 0) {
+			player.is_rewinding = 1;
+			recolor(player, PALETTE_REWIND);
+		}
+	} else if (player.is_rewinding == 1) {
+		player.is_rewinding = 0;
+		player.is_cooling = 1;
+		recolor(player, PALETTE_COOLDOWN);
+	}
+
+	if (player.is_cooling == 1) {
+		if (player.seconds_cooldown >= params.rewind_cooldown) {
+			recolor(player, PALETTE_NORMAL);
+			player.is_cooling = 0;
+			player.seconds_cooldown = 0;
+		}
+		player.seconds_cooldown += elapsed;
+	}
+
+	if (player.is_attacking == 1 && player.right_arm_angle <= 0) {
+		player.right_arm_angle += params.attack_speed;
+		if (player.right_arm_angle >= 0) {
+			player.is_attacking = 0;
+			player.right_arm_angle = 0;
+		}
+	} else if (player.is_attacking == 0 && player.right_arm_angle > -60) {
+		player.right_arm_angle -= params.attack_cooldown;
+		if (player.right_arm_angle <= -60) player.right_arm_angle = -60;
+	}
+
+	if (player.is_rewinding == 0 && player.left_walk != player.right_walk) {
+		float x = player.head.x + params.walk_speed * (int(player.right_walk) - int(player.left_walk));
+		player.update_coords(glm::vec2(std::max(-10.0f, std::min(10.0f, x)), player.head.y));
+	}
+}
+
+//Steps 'players' for 'ticks' ticks (each holds one of 'patterns' for 16 ticks at a time); returns ns per player per tick:
+template< typename P >
+static double run_hot_ticks(std::vector< P > *players, std::vector< uint8_t > const &patterns, uint32_t ticks, RewindParams const &params, float elapsed) {
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t t = 0; t < ticks; ++t) {
+		for (size_t i = 0; i < players->size(); ++i) {
+			hot_tick((*players)[i], patterns[(i * 7 + t / 16) % patterns.size()], params, elapsed);
+		}
+	}
+	return seconds_since(start) / (double(ticks) * players->size()) * 1e9;
+}
+
+//Hot/cold split: how much smaller per-tick player state got, and what that does for big crowds:
+static bool bench_hotcold() {
+	std::cout << "hotcold: player state is " << sizeof(player_state) << " bytes (was " << sizeof(LegacyPlayerState) << "): "
+		<< 32768 / sizeof(player_state) << " players fit in a 32 KiB L1 cache (was " << 32768 / sizeof(LegacyPlayerState) << "), "
+		<< 64 / sizeof(player_state) << " per cache line; shared tables: " << sizeof(PlayerBody) << " bytes of body sizes, "
+		<< sizeof(player_palettes) << " bytes of palettes" << std::endl;
+
+	RewindParams params;
+	float const elapsed = 1.0f / TICK_RATE;
+	std::vector< uint8_t > patterns(4096);
+	std::mt19937 mt(0x5eed);
+	for (auto &input : patterns) input = uint8_t(mt() & (INPUT_LEFT | INPUT_RIGHT | INPUT_ATTACK | INPUT_REWIND));
+
+	for (size_t count : {256, 1024, 4096, 32768}) {
+		std::vector< player_state > hot(count);
+		std::vector< LegacyPlayerState > legacy(count);
+		for (size_t i = 0; i < count; ++i) {
+			player_info fresh(glm::vec2(0.0f), PLAYER_ONE, PALETTE_PLAYER_ONE);
+			hot[i] = fresh;
+			for (int p = 0; p < 5; ++p) {
+				legacy[i].normal_colors[p] = player_palettes[PALETTE_PLAYER_ONE].colors[PALETTE_NORMAL][p];
+				legacy[i].rewind_colors[p] = player_palettes[PALETTE_PLAYER_ONE].colors[PALETTE_REWIND][p];
+				legacy[i].cooldown_colors[p] = player_palettes[PALETTE_PLAYER_ONE].colors[PALETTE_COOLDOWN][p];
+			}
+			legacy[i].sword_arm = PLAYER_ONE;
+			legacy[i].update_coords(fresh.head);
+			legacy[i].left_arm_angle = fresh.left_arm_angle;
+			legacy[i].right_arm_angle = fresh.right_arm_angle;
+			legacy[i].update_colors(PALETTE_NORMAL);
+		}
+
+		uint32_t ticks = uint32_t(std::max< size_t >(20, 8000000 / count));
+		double hot_ns = run_hot_ticks(&hot, patterns, ticks, params, elapsed);
+		double legacy_ns = run_hot_ticks(&legacy, patterns, ticks, params, elapsed);
+
+		for (size_t i = 0; i < count; ++i) {
+			player_state const &a = hot[i];
+			LegacyPlayerState const &b = legacy[i];
+			if (a.head != b.head || a.right_arm_angle != b.right_arm_angle || a.is_attacking != b.is_attacking
+			 || a.is_rewinding != b.is_rewinding || a.is_cooling != b.is_cooling || a.seconds_cooldown != b.seconds_cooldown
+			 || a.torso() != b.torso || a.right_arm() != b.right_arm || a.left_leg() != b.left_leg
+			 || a.colors()[0] != glm::u8vec4(b.head_color) || a.colors()[4] != b.sword_color) {
+				std::cout << "hotcold: player " << i << " of " << count << " ended up differently in the two layouts" << std::endl;
+				return false;
+			}
+		}
+
+		std::cout << "hotcold: " << count << " players (" << count * sizeof(player_state) / 1024.0 << " KiB vs "
+			<< count * sizeof(LegacyPlayerState) / 1024.0 << " KiB): " << hot_ns << "ns per player per tick (was "
+			<< legacy_ns << "ns, " << legacy_ns / hot_ns << "x)" << std::endl;
+	}
+
+	return true;
+}
+
+//Steps 'match' for 'count' ticks of the input pairs in 'stream' (over and over); returns millions of ticks per second:
+template< typename M >
+static double race_ticks(M *match, std::vector< uint8_t > const &stream, uint32_t count) {
+	uint32_t pairs = uint32_t(stream.size() / 2);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t at = 2 * (i % pairs);
+		match->step(stream[at], stream[at+1]);
+	}
+	return (count / seconds_since(start)) / 1e6;
+}
+
+//Steps a RewindSim in a given scalar type, for race_ticks:
+template< typename S >
+struct StepAs {
+	RewindSim sim;
+	void step(uint8_t player_one_input, uint8_t player_two_input) { sim.step_as< S >(player_one_input, player_two_input); }
+};
+
+//Fixed point simulation: checks RewindSim::step_as< Fixed > against hashes recorded
+// from other builds, then races it against the float rules:
+static bool bench_fixed() {
+	struct Rules {
+		char const *name;
+		float tick_rate;
+		float scale; //every RewindParams field multiplied by this
+		uint64_t fixed_hash; //hash chain of the fixed point match after 'ticks' ticks (the same for every build)
+	};
+	std::vector< Rules > rules = {
+		{"60 ticks/s", TICK_RATE, 1.0f, 0xe04a413c429f5f74ull},
+		{"24 ticks/s, all constants x1.3", 24.0f, 1.3f, 0x785aaf0affa50dd6ull},
+	};
+	uint32_t const ticks = uint32_t(10.0f * 60.0f * TICK_RATE); //ten minutes of play
+	bool ok = true;
+	for (auto const &r : rules) {
+		RewindParams params;
+		for (auto const &info : rewind_param_info()) params.*info.value *= r.scale;
+		RewindSim float_sim(r.tick_rate, params);
+		RewindSim fixed_sim(r.tick_rate, params);
+		RandomInputs inputs(0x5eed);
+		uint64_t hash = 0;
+		for (uint32_t t = 0; t < ticks; ++t) {
+			uint8_t one = inputs.next(0), two = inputs.next(1);
+			float_sim.step_as< float >(one, two);
+			fixed_sim.step_as< Fixed >(one, two);
+			hash = hash_state(fixed_sim, hash).chain;
+		}
+		char hex[32];
+		std::snprintf(hex, sizeof(hex), "0x%016llxull", (unsigned long long)hash);
+		std::cout << "fixed: " << r.name << ": " << ticks << " ticks in floats " << float_sim.round << " rounds, "
+			<< float_sim.left_score << "-" << float_sim.right_score << "; in fixed point " << fixed_sim.round << " rounds, "
+			<< fixed_sim.left_score << "-" << fixed_sim.right_score << ", hash " << hex;
+		if (hash == r.fixed_hash) {
+			std::cout << " (as recorded)" << std::endl;
+		} else {
+			std::cout << " -- DIFFERENT from the recorded hash, so this build doesn't agree with the others" << std::endl;
+			ok = false;
+		}
+	}
+
+	//pre-generate inputs so the random number generator isn't being timed (as in bench_ticks):
+	RandomInputs inputs(0x5eed);
+	std::vector< uint8_t > stream(2 * 4096);
+	for (uint32_t i = 0; i < 4096; ++i) {
+		stream[2*i+0] = inputs.next(0);
+		stream[2*i+1] = inputs.next(1);
+	}
+	uint32_t const count = 10000000;
+	StepAs< float > float_match;
+	StepAs< Fixed > fixed_match;
+	double float_rate = race_ticks(&float_match, stream, count);
+	double fixed_rate = race_ticks(&fixed_match, stream, count);
+	std::cout << "fixed: floats " << float_rate << "M ticks/s, fixed point " << fixed_rate << "M ticks/s"
+		<< " (RewindSim::step uses " << (SIM_FIXED_POINT ? "fixed point" : "floats") << " in this build)" << std::endl;
+
+	return ok;
+}
+
+//Lag compensation: checks rewound players against recorded history, then times queries in a crowded arena:
+static bool bench_lag() {
+	uint32_t const window = 32; //ticks of history recorded (and queried)
+
+	{ //two players, every tick back to 'window' ago:
+		RewindSim sim;
+		LagCompensation lag;
+		RandomInputs inputs(0x5eed);
+		std::vector< player_state > truth(window * 2); //after tick t, at [(t % window) * 2 + player]
+		uint64_t answered = 0, refused = 0;
+		for (uint32_t t = 1; t <= uint32_t(10.0f * 60.0f * TICK_RATE); ++t) {
+			sim.step(inputs.next(0), inputs.next(1));
+			lag.observe(sim);
+			truth[(t % window) * 2 + 0] = sim.playerOne();
+			truth[(t % window) * 2 + 1] = sim.playerTwo();
+			for (uint32_t back = 0; back < window && back < t; ++back) {
+				for (uint32_t p = 0; p < 2; ++p) {
+					player_info const &player = (p == 0 ? sim.playerOne() : sim.playerTwo());
+					player_state const &want = truth[((t - back) % window) * 2 + p];
+					player_state past = want;
+					past.head.x = 1e9f; //(a refused rewind has to leave this alone)
+					if (!lag.rewind(p, player, t - back, &past)) {
+						if (past.head.x != 1e9f) {
+							std::cout << "lag: a refused rewind of player " << p + 1 << " changed the state it was given" << std::endl;
+							return false;
+						}
+						refused += 1;
+						continue;
+					}
+					answered += 1;
+					if (past.head != want.head || past.sword_angle() != want.sword_angle() || past.is_attacking != want.is_attacking) {
+						std::cout << "lag: player " << p + 1 << " rewound to tick " << t - back << " (from " << t << ") isn't where they were" << std::endl;
+						return false;
+					}
+				}
+			}
+		}
+		std::cout << "lag: two players: " << answered << " rewinds matched history, " << refused << " refused (past a rewind or round start)" << std::endl;
+	}
+
+	//a crowd, with thousands of queries a tick between neighbors:
+	uint32_t const count = 1024;
+	uint32_t const queries_per_tick = 4096;
+	RewindArena arena(count);
+	LagCompensation lag(count);
+	std::mt19937 mt(0x5eed);
+	std::vector< uint8_t > held(count, 0), input(count, 0);
+	std::vector< uint32_t > hold(count, 0);
+	std::vector< player_state > truth(size_t(window) * count);
+	std::vector< LagCompensation::Query > queries(queries_per_tick);
+	std::vector< int8_t > results(queries_per_tick);
+	uint64_t asked = 0, hits = 0, refused = 0;
+	double seconds = 0.0;
+	uint32_t const ticks = 1200;
+	for (uint32_t t = 1; t <= ticks; ++t) {
+		for (uint32_t i = 0; i < count; ++i) {
+			if (hold[i] == 0) {
+				held[i] = uint8_t(mt() & (INPUT_LEFT | INPUT_RIGHT | INPUT_ATTACK | INPUT_REWIND));
+				hold[i] = 1 + mt() % 30;
+			}
+			hold[i] -= 1;
+			input[i] = held[i];
+		}
+		arena.step(input.data());
+		lag.observe(arena);
+		for (uint32_t i = 0; i < count; ++i) {
+			truth[size_t(t % window) * count + i] = arena.fighters[i];
+		}
+		if (t < window) continue;
+
+		//attackers swinging at the neighbor they face (who they can reach), as seen up to half a second ago:
+		for (auto &query : queries) {
+			query.attacker = mt() % count;
+			query.defender = (query.attacker ^ 1) % count;
+			query.tick = t - mt() % window;
+		}
+		auto start = std::chrono::high_resolution_clock::now();
+		lag.judge(arena, queries.data(), queries.size(), results.data());
+		seconds += seconds_since(start);
+
+		for (size_t q = 0; q < queries.size(); ++q) {
+			LagCompensation::Query const &query = queries[q];
+			asked += 1;
+			if (results[q] < 0) {
+				refused += 1;
+				continue;
+			}
+			player_info const &attacker = arena.fighters[query.attacker];
+			player_state const &was = truth[size_t(query.tick % window) * count + query.defender];
+			int want = (attacker.is_attacking == 1 ? sword_tip_hits(attacker, was, arena.sword_tip_length) : 0);
+			if (results[q] != want) {
+				std::cout << "lag: fighter " << query.attacker << " against fighter " << query.defender << " at tick " << query.tick
+					<< " (from " << t << ") gave " << int(results[q]) << ", not " << want << std::endl;
+				return false;
+			}
+			hits += uint64_t(want);
+		}
+	}
+	std::cout << "lag: " << count << " fighters: " << asked << " queries matched history (" << hits << " hits, " << refused << " refused); "
+		<< (seconds / asked) * 1e9 << "ns per query = " << (seconds / asked) * queries_per_tick * 1e6 << "us for " << queries_per_tick << " queries a tick" << std::endl;
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	struct Benchmark {
+		char const *name;
+		bool (*run)(); //returns false if a check failed
+	};
+	std::vector< Benchmark > benchmarks = {
+		{"ticks", bench_ticks},
+		{"batch", bench_batch},
+		{"snapshot", bench_snapshot},
+		{"replay", bench_replay},
+		{"rollback", bench_rollback},
+		{"trig", bench_trig},
+		{"collision", bench_collision},
+		{"swept", bench_swept},
+		{"arena", bench_arena},
+		{"mcts", bench_mcts},
+		{"history", bench_history},
+		{"timeline", bench_timeline},
+		{"hash", bench_hash},
+		{"phases", bench_phases},
+		{"hotcold", bench_hotcold},
+		{"fixed", bench_fixed},
+		{"lag", bench_lag},
+		{"branch", bench_branch},
+	};
+
+	std::vector< std::string > names(argv + 1, argv + argc);
+	for (auto const &name : names) {
+		bool found = false;
+		for (auto const &b : benchmarks) {
+			if (name == b.name) found = true;
+		}
+		if (!found) {
+			std::cerr << "Unknown benchmark '" << name << "'. Available:";
+			for (auto const &b : benchmarks) std::cerr << " " << b.name;
+			std::cerr << std::endl;
+			return 1;
+		}
+	}
+
+	bool ok = true;
+	for (auto const &b : benchmarks) {
+		bool run = names.empty();
+		for (auto const &name : names) {
+			if (name == b.name) run = true;
+		}
+		if (run && !b.run()) ok = false;
+	}
+
+	return ok ? 0 : 1;
+}
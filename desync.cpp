@@ -0,0 +1,76 @@
+//Finds where two runs of the same match diverged, from their per-tick state hashes (see StateHash.hpp).
+// Usage: rewind-desync <hash log> <hash log>
+//        rewind-desync --replay <replay file> <hash log>
+// Hash logs are written by 'rewind --hash-log <file>' (by each player of an
+// online match, or by whoever recorded or played back a replay). With
+// --replay, the replay is played back here and hashed, so a hash log can be
+// checked against the match a replay says happened.
+// Exits with 0 if the runs agree (on the ticks both cover), 2 if they don't.
+
+#include "StateHash.hpp"
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Hashes every tick of a replay, as 'rewind --play <replay> --hash-log <file>' would:
+static std::vector< StateHash > hash_replay(std::string const &filename) {
+	ReplayReader replay(filename);
+	RewindSim sim(replay.tick_rate);
+	replay.seek(&sim, 0);
+
+	std::vector< StateHash > hashes;
+	uint64_t chain = 0;
+	uint8_t player_one_input = 0, player_two_input = 0;
+	while (replay.next_input(&player_one_input, &player_two_input)) {
+		sim.step(player_one_input, player_two_input);
+		hashes.emplace_back(hash_state(sim, chain));
+		chain = hashes.back().chain;
+	}
+	return hashes;
+}
+
+int main(int argc, char **argv) {
+	std::string a_name, b_name;
+	std::vector< StateHash > a, b;
+
+	try {
+		if (argc == 4 && std::string(argv[1]) == "--replay") {
+			a_name = argv[2];
+			b_name = argv[3];
+			a = hash_replay(a_name);
+		} else if (argc == 3 && argv[1][0] != '-') {
+			a_name = argv[1];
+			b_name = argv[2];
+			a = read_hash_log(a_name);
+		} else {
+			throw std::runtime_error("Expecting two hash logs, or a replay and a hash log.");
+		}
+		b = read_hash_log(b_name);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << "Usage:\n\t" << argv[0] << " <hash log> <hash log>\n"
+			<< "\t" << argv[0] << " --replay <replay file> <hash log>" << std::endl;
+		return 1;
+	}
+
+	std::cout << a_name << ": " << a.size() << " ticks\n";
+	std::cout << b_name << ": " << b.size() << " ticks\n";
+
+	Desync desync;
+	if (!find_desync(a, b, &desync)) {
+		std::cout << "No desync: the runs agree on all " << std::min(a.size(), b.size()) << " ticks they both cover." << std::endl;
+		return 0;
+	}
+
+	std::cout << "Desync after tick " << desync.tick << ", in:";
+	for (uint32_t f = 0; f < HASH_FIELDS; ++f) {
+		if (desync.fields & (1u << f)) std::cout << " [" << hash_field_name(f) << "]";
+	}
+	if (desync.fields == 0) std::cout << " (no field differs -- is a log corrupt?)";
+	std::cout << std::endl;
+	return 2;
+}
@@ -0,0 +1,374 @@
+//Randomized input fuzzer for the rules' invariants.
+// Usage: rewind-fuzz [--cases <n>] [--seconds <per case>] [--threads <n>] [--seed <n>]
+//                    [--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [--param <name>=<value> ...]
+//                    [--out <replay file>]
+// Plays --cases matches of --seconds each, spread over every core, feeding them
+// input streams from several generators (see Generators below): random held
+// buttons and per-tick mashing, plus adversarial ones aimed at the rewind gate,
+// the attack's exact at-rest check, the walls and time rifts. After every tick
+// it checks that:
+//  - at most one player is rewinding (which RewindSim::step asserts), unless --two-rewinders,
+//  - both heads are inside court_radius,
+//  - rewind logs hold at most rewind_log_size() entries, and rewinds stop at max_rewind,
+//  - every number in the players' state and newest rewind log entries is finite.
+// The first case (in case order, so runs are repeatable) to break one is shrunk
+// -- dropping runs of ticks, then releasing buttons, for as long as it still
+// breaks the same invariant -- and written to --out as a replay ending on the
+// tick that broke it; watch it with 'rewind --play <replay file>'.
+// Exits with 0 if nothing broke, 2 if something did.
+
+#include "RewindSim.hpp"
+#include "Replay.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//----- invariants -----
+
+enum Invariant {
+	INVARIANT_HOLDS,
+	INVARIANT_ONE_REWINDER, //at most one player is rewinding
+	INVARIANT_IN_COURT, //heads are inside court_radius
+	INVARIANT_HISTORY, //rewind logs and rewinds are bounded
+	INVARIANT_FINITE, //no infinities or NaNs
+};
+
+static char const *invariant_name(int invariant) {
+	switch (invariant) {
+		case INVARIANT_HOLDS: return "none";
+		case INVARIANT_ONE_REWINDER: return "both players rewinding";
+		case INVARIANT_IN_COURT: return "head outside the court";
+		case INVARIANT_HISTORY: return "rewind history past its bounds";
+		case INVARIANT_FINITE: return "non-finite number";
+		default: return "?";
+	}
+}
+
+//The first invariant 'sim' breaks (or INVARIANT_HOLDS):
+static int broken_invariant(RewindSim const &sim) {
+	if (sim.two_rewinders == 0 && sim.playerOne().is_rewinding == 1 && sim.playerTwo().is_rewinding == 1) return INVARIANT_ONE_REWINDER;
+
+	size_t log_limit = rewind_log_size(sim.params, sim.tick_rate);
+	//seconds_passed only grows while it is below max_rewind, by this much a tick:
+	float rewind_limit = sim.params.max_rewind + sim.params.rewind_speed * sim.tick;
+	for (player_info const *player : { &sim.playerOne(), &sim.playerTwo() }) {
+		float numbers[] = {
+			player->head.x, player->head.y, player->left_arm_angle, player->right_arm_angle,
+			player->seconds_passed, player->rewind_offset, player->seconds_cooldown,
+			0.0f, 0.0f, 0.0f, 0.0f
+		};
+		if (!player->rewind_log.empty()) {
+			glm::vec4 newest = player->rewind_log.front(); //(older entries were checked when they were newest)
+			numbers[7] = newest.x;
+			numbers[8] = newest.y;
+			numbers[9] = newest.z;
+			numbers[10] = newest.w;
+		}
+		for (float number : numbers) {
+			if (!std::isfinite(number)) return INVARIANT_FINITE;
+		}
+		if (!(std::abs(player->head.x) <= sim.court_radius.x && std::abs(player->head.y) <= sim.court_radius.y)) return INVARIANT_IN_COURT;
+		if (player->rewind_log.size() > log_limit || player->seconds_passed > rewind_limit) return INVARIANT_HISTORY;
+	}
+	return INVARIANT_HOLDS;
+}
+
+//----- inputs -----
+
+//Ways of making up inputs (a case uses generator 'case % GENERATORS'):
+enum Generators {
+	GENERATE_HELD, //random buttons held for 1-30 ticks (like rewind-bench's random play)
+	GENERATE_MASH, //random buttons every tick
+	GENERATE_REWIND, //walking in while flicking rewind on and off (often on the same tick as the other player)
+	GENERATE_AT_REST, //attacking on exactly the ticks the sword is at rest, with the odd rewind
+	GENERATE_WALLS, //backing into the wall behind, tapping rewind
+	GENERATE_RIFT, //closing in, then rewinding and dodging about up close
+	GENERATORS
+};
+
+static char const *generator_name(uint32_t generator) {
+	char const *names[GENERATORS] = { "held", "mash", "rewind", "at-rest", "walls", "rift" };
+	return generator < GENERATORS ? names[generator] : "?";
+}
+
+//Small, quickly-seeded random numbers (splitmix64, as in MctsBot):
+struct FuzzRandom {
+	FuzzRandom(uint64_t seed) : state(seed) { }
+	uint32_t next() {
+		state += 0x9e3779b97f4a7c15ULL;
+		uint64_t z = state;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return uint32_t((z ^ (z >> 31)) >> 32);
+	}
+	uint64_t state;
+};
+
+//One case's input stream, made up a tick at a time (some generators look at the match):
+struct FuzzInputs {
+	FuzzInputs(uint32_t generator_, uint64_t seed) : generator(generator_), random(seed) { }
+
+	uint8_t next(RewindSim const &sim, int p) {
+		player_info const &me = (p == 0 ? sim.playerOne() : sim.playerTwo());
+		player_info const &other = (p == 0 ? sim.playerTwo() : sim.playerOne());
+		uint8_t forward = (p == 0 ? INPUT_RIGHT : INPUT_LEFT);
+		uint8_t back = (p == 0 ? INPUT_LEFT : INPUT_RIGHT);
+		uint32_t r = random.next();
+
+		if (generator == GENERATE_HELD) {
+			if (hold[p] == 0) {
+				held[p] = uint8_t(r & 0xf);
+				hold[p] = 1 + (r >> 4) % 30;
+			}
+			hold[p] -= 1;
+			return held[p];
+		} else if (generator == GENERATE_MASH) {
+			return uint8_t(r & 0xf);
+		} else if (generator == GENERATE_REWIND) {
+			return uint8_t(forward | ((r & 1) ? INPUT_REWIND : 0) | ((r & 0x70) == 0 ? INPUT_ATTACK : 0));
+		} else if (generator == GENERATE_AT_REST) {
+			bool at_rest = (me.sword_angle() == (p == 0 ? -60.0f : 60.0f));
+			uint8_t input = uint8_t(r & (r >> 8) & (INPUT_LEFT | INPUT_RIGHT | INPUT_REWIND));
+			return uint8_t(input | (at_rest ? INPUT_ATTACK : 0));
+		} else if (generator == GENERATE_WALLS) {
+			return uint8_t(((r & 0xf) != 0 ? back : forward) | ((r & 0x30) == 0 ? INPUT_REWIND : 0));
+		} else {
+			if (std::abs(me.head.x - other.head.x) > sim.params.max_dist + 1.0f) return forward;
+			return uint8_t(r & 0xf);
+		}
+	}
+
+	uint32_t generator;
+	FuzzRandom random;
+	uint8_t held[2] = { 0, 0 };
+	uint32_t hold[2] = { 0, 0 };
+};
+
+//----- shrinking -----
+
+//The rules a case was played by:
+struct FuzzRules {
+	float tick_rate;
+	RewindParams params;
+	uint32_t exact_hits;
+	uint32_t two_rewinders;
+};
+
+//Plays 'inputs' (player one's then player two's input, for each tick) from the start of a match
+// until an invariant breaks; returns which one, and sets 'tick' to the number of ticks played:
+static int play(FuzzRules const &rules, std::vector< uint8_t > const &inputs, uint32_t *tick) {
+	RewindSim sim(rules.tick_rate, rules.params);
+	sim.exact_hits = rules.exact_hits;
+	sim.two_rewinders = rules.two_rewinders;
+	uint32_t ticks = uint32_t(inputs.size() / 2);
+	for (uint32_t t = 0; t < ticks; ++t) {
+		sim.step(inputs[2*t+0], inputs[2*t+1]);
+		int broken = broken_invariant(sim);
+		if (broken != INVARIANT_HOLDS) {
+			*tick = t + 1;
+			return broken;
+		}
+	}
+	*tick = ticks;
+	return INVARIANT_HOLDS;
+}
+
+//Makes 'inputs' (which break 'invariant') as short and quiet as possible while they still break it:
+static void shrink(FuzzRules const &rules, int invariant, std::vector< uint8_t > *inputs) {
+	//(cuts off whatever comes after the invariant breaks)
+	auto still_breaks = [&](std::vector< uint8_t > *candidate) {
+		uint32_t tick = 0;
+		if (play(rules, *candidate, &tick) != invariant) return false;
+		candidate->resize(2 * size_t(tick));
+		return true;
+	};
+	still_breaks(inputs);
+
+	std::vector< uint8_t > candidate;
+	bool shrunk = true;
+	while (shrunk) {
+		shrunk = false;
+		//drop runs of ticks, halving the run length each pass:
+		for (size_t run = inputs->size() / 4; run >= 1; run /= 2) {
+			for (size_t start = 0; 2 * (start + run) <= inputs->size(); ) {
+				candidate.assign(inputs->begin(), inputs->begin() + 2 * start);
+				candidate.insert(candidate.end(), inputs->begin() + 2 * (start + run), inputs->end());
+				if (!candidate.empty() && still_breaks(&candidate)) {
+					inputs->swap(candidate);
+					shrunk = true;
+				} else {
+					start += run;
+				}
+			}
+		}
+		//release buttons one at a time:
+		for (size_t i = 0; i < inputs->size(); ++i) {
+			for (uint8_t bit = 1; bit <= INPUT_REWIND; bit <<= 1) {
+				if (!((*inputs)[i] & bit)) continue;
+				candidate = *inputs;
+				candidate[i] = uint8_t(candidate[i] & ~bit);
+				if (still_breaks(&candidate)) {
+					inputs->swap(candidate);
+					shrunk = true;
+					if (i >= inputs->size()) break;
+				}
+			}
+		}
+	}
+}
+
+//----- main -----
+
+int main(int argc, char **argv) {
+	uint64_t cases = 1000;
+	float seconds = 60.0f;
+	uint32_t threads = 0;
+	uint32_t seed = 0;
+	FuzzRules rules;
+	rules.tick_rate = TICK_RATE;
+	rules.exact_hits = HITS_TIP;
+	rules.two_rewinders = 0;
+	std::string out = "fuzz-failure.replay";
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--cases" && i + 1 < argc) {
+				cases = std::stoull(argv[i+1]);
+				i += 1;
+			} else if (arg == "--seconds" && i + 1 < argc) {
+				seconds = std::stof(argv[i+1]);
+				i += 1;
+			} else if (arg == "--threads" && i + 1 < argc) {
+				threads = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--seed" && i + 1 < argc) {
+				seed = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--tick-rate" && i + 1 < argc) {
+				rules.tick_rate = std::stof(argv[i+1]);
+				i += 1;
+			} else if (arg == "--exact-hits") {
+				rules.exact_hits = HITS_EXACT;
+			} else if (arg == "--swept-hits") {
+				rules.exact_hits = HITS_SWEPT;
+			} else if (arg == "--two-rewinders") {
+				rules.two_rewinders = 1;
+			} else if (arg == "--param" && i + 1 < argc) {
+				set_rewind_param(&rules.params, argv[i+1]);
+				i += 1;
+			} else if (arg == "--out" && i + 1 < argc) {
+				out = argv[i+1];
+				i += 1;
+			} else {
+				throw std::runtime_error("Unknown option '" + arg + "'.");
+			}
+		}
+		if (!(rules.tick_rate > 0.0f)) throw std::runtime_error("Tick rate must be positive.");
+		if (!(seconds > 0.0f)) throw std::runtime_error("Cases must last a positive number of seconds.");
+		check_rewind_params(rules.params);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << "Usage:\n\t" << argv[0] << " [--cases <n>] [--seconds <per case>] [--threads <n>] [--seed <n>]\n"
+			<< "\t\t[--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [--param <name>=<value> ...] [--out <replay file>]" << std::endl;
+		return 1;
+	}
+
+	uint32_t const ticks = std::max(1u, uint32_t(seconds * rules.tick_rate));
+	auto case_seed = [&](uint64_t c) { return (uint64_t(seed) << 32) ^ (c * 0x9e3779b97f4a7c15ULL); };
+
+	ThreadPool pool(threads);
+	std::vector< std::vector< uint8_t > > per_thread_inputs(pool.size());
+	std::vector< uint64_t > per_thread_ticks(pool.size(), 0);
+
+	//the first failing case (cases after it are skipped, but earlier ones still finish, so the result doesn't depend on timing):
+	std::atomic< uint64_t > first_failure(std::numeric_limits< uint64_t >::max());
+	std::mutex failure_mutex;
+	std::vector< uint8_t > failure_inputs;
+	int failure_invariant = INVARIANT_HOLDS;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	pool.run(cases, [&](size_t c, uint32_t thread) {
+		if (c > first_failure.load()) return;
+		std::vector< uint8_t > &inputs = per_thread_inputs[thread];
+		inputs.clear();
+
+		RewindSim sim(rules.tick_rate, rules.params);
+		sim.exact_hits = rules.exact_hits;
+		sim.two_rewinders = rules.two_rewinders;
+		FuzzInputs generate(uint32_t(c % GENERATORS), case_seed(c));
+		uint32_t t = 0;
+		int broken = INVARIANT_HOLDS;
+		while (t < ticks && broken == INVARIANT_HOLDS) {
+			uint8_t one = generate.next(sim, 0);
+			uint8_t two = generate.next(sim, 1);
+			inputs.emplace_back(one);
+			inputs.emplace_back(two);
+			sim.step(one, two);
+			broken = broken_invariant(sim);
+			t += 1;
+		}
+		per_thread_ticks[thread] += t;
+		if (broken == INVARIANT_HOLDS) return;
+
+		std::lock_guard< std::mutex > lock(failure_mutex);
+		if (c < first_failure.load()) {
+			first_failure = c;
+			failure_inputs = inputs;
+			failure_invariant = broken;
+		}
+	});
+	double elapsed = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+
+	uint64_t all_ticks = 0;
+	for (uint64_t t : per_thread_ticks) all_ticks += t;
+	std::cout << all_ticks << " ticks in " << elapsed << "s on " << pool.size() << " thread" << (pool.size() == 1 ? "" : "s")
+		<< " = " << (all_ticks / elapsed) / 1e6 << "M ticks/s" << std::endl;
+
+	if (failure_invariant == INVARIANT_HOLDS) {
+		std::cout << "All " << cases << " cases (" << ticks << " ticks each) kept every invariant." << std::endl;
+		return 0;
+	}
+
+	uint64_t c = first_failure.load();
+	std::cout << "Case " << c << " (" << generator_name(uint32_t(c % GENERATORS)) << " inputs, seed " << seed << ") broke an invariant ("
+		<< invariant_name(failure_invariant) << ") on tick " << failure_inputs.size() / 2 << "." << std::endl;
+
+	shrink(rules, failure_invariant, &failure_inputs);
+	uint32_t held = 0;
+	for (uint8_t input : failure_inputs) {
+		for (uint8_t bit = 1; bit <= INPUT_REWIND; bit <<= 1) held += (input & bit) ? 1 : 0;
+	}
+	std::cout << "Shrunk to " << failure_inputs.size() / 2 << " ticks (" << held << " button-ticks held)." << std::endl;
+
+	try {
+		RewindSim sim(rules.tick_rate, rules.params);
+		sim.exact_hits = rules.exact_hits;
+		sim.two_rewinders = rules.two_rewinders;
+		ReplayWriter replay(out, sim);
+		for (size_t t = 0; t < failure_inputs.size() / 2; ++t) {
+			replay.record(sim, failure_inputs[2*t+0], failure_inputs[2*t+1]);
+			sim.step(failure_inputs[2*t+0], failure_inputs[2*t+1]);
+		}
+		replay.finish();
+		std::cout << "Wrote '" << out << "' (watch it with 'rewind --play " << out << "'); the last tick has:\n";
+		for (player_info const *player : { &sim.playerOne(), &sim.playerTwo() }) {
+			std::cout << "  player " << (player == &sim.playerOne() ? "one" : "two") << ": head (" << player->head.x << ", " << player->head.y
+				<< "), sword at " << player->sword_angle() << ", attacking " << int(player->is_attacking) << ", rewinding " << int(player->is_rewinding)
+				<< " (" << player->seconds_passed << "s back), cooling " << int(player->is_cooling) << ", " << player->rewind_log.size() << " log entries\n";
+		}
+		std::cout.flush();
+	} catch (std::exception &e) {
+		std::cerr << e.what() << std::endl;
+	}
+	return 2;
+}
@@ -4,6 +4,9 @@
 //The 'GameMode' mode plays the game:
 #include "RewindMode.hpp"
 
+//Per-phase tick timing (--phase-timers, F2 to print):
+#include "PhaseTimers.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
@@ -19,6 +22,11 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <string>
+#include <cmath>
+
+//most simulation ticks to run in a single frame before dropping time:
+#define MAX_CATCHUP_TICKS 8
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -26,6 +34,127 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+
+	//simulation ticks per second; frames are presented independently of this:
+	float tick_rate = TICK_RATE;
+	//hit rules, HITS_* (see RewindSim::exact_hits):
+	uint32_t exact_hits = HITS_TIP;
+	//rewind rules (see RewindSim::two_rewinders):
+	uint32_t two_rewinders = 0;
+	//rules constants (see RewindParams; --rewind-speed <x> is short for --param rewind_speed=<x>):
+	RewindParams params;
+	//replay files to write and/or watch:
+	std::string record_filename;
+	std::string play_filename;
+	//per-tick state hashes to write (compare them with rewind-desync):
+	std::string hash_log_filename;
+	//online play (the host is player one):
+	int host_port = 0;
+	std::string connect_host;
+	int connect_port = 0;
+	UdpLink::Conditions net_conditions; //simulated bad network, for trying things out over loopback
+	//computer opponent (plays player two):
+	bool cpu = false;
+	double cpu_budget = 0.005; //seconds of search per tick at TICK_RATE (scaled to the actual tick rate below)
+	//keep the whole session for scrubbing through (see RewindMode::timeline):
+	bool debug = false;
+	//time the phases of each tick (printed with F2 and on exit; see PhaseTimers.hpp):
+	bool phase_timers = false;
+	//party mode with this many fighters instead of a match (see RewindArena):
+	size_t arena_fighters = 0;
+
+	bool online = false;
+	std::unique_ptr< ReplayReader > playback;
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--tick-rate" && i + 1 < argc) {
+				tick_rate = std::stof(argv[i+1]);
+				i += 1;
+			} else if (arg == "--record" && i + 1 < argc) {
+				record_filename = argv[i+1];
+				i += 1;
+			} else if (arg == "--hash-log" && i + 1 < argc) {
+				hash_log_filename = argv[i+1];
+				i += 1;
+			} else if (arg == "--play" && i + 1 < argc) {
+				play_filename = argv[i+1];
+				i += 1;
+			} else if (arg == "--rewind-speed" && i + 1 < argc) {
+				params.rewind_speed = std::stof(argv[i+1]);
+				i += 1;
+			} else if (arg == "--param" && i + 1 < argc) {
+				set_rewind_param(&params, argv[i+1]);
+				i += 1;
+			} else if (arg == "--exact-hits") {
+				exact_hits = HITS_EXACT;
+			} else if (arg == "--swept-hits") {
+				exact_hits = HITS_SWEPT;
+			} else if (arg == "--two-rewinders") {
+				two_rewinders = 1;
+			} else if (arg == "--host" && i + 1 < argc) {
+				host_port = std::stoi(argv[i+1]);
+				i += 1;
+			} else if (arg == "--connect" && i + 1 < argc) {
+				std::string address = argv[i+1];
+				auto colon = address.rfind(':');
+				if (colon == std::string::npos) throw std::runtime_error("Expecting --connect <host>:<port>.");
+				connect_host = address.substr(0, colon);
+				connect_port = std::stoi(address.substr(colon + 1));
+				i += 1;
+			} else if (arg == "--net-latency" && i + 1 < argc) {
+				net_conditions.latency = std::stod(argv[i+1]) / 1000.0;
+				i += 1;
+			} else if (arg == "--net-jitter" && i + 1 < argc) {
+				net_conditions.jitter = std::stod(argv[i+1]) / 1000.0;
+				i += 1;
+			} else if (arg == "--net-loss" && i + 1 < argc) {
+				net_conditions.loss = std::stod(argv[i+1]) / 100.0;
+				i += 1;
+			} else if (arg == "--cpu") {
+				cpu = true;
+			} else if (arg == "--cpu-budget" && i + 1 < argc) {
+				cpu = true;
+				cpu_budget = std::stod(argv[i+1]) / 1000.0;
+				i += 1;
+			} else if (arg == "--debug") {
+				debug = true;
+			} else if (arg == "--phase-timers") {
+				phase_timers = true;
+			} else if (arg == "--arena" && i + 1 < argc) {
+				int fighters = std::stoi(argv[i+1]);
+				if (fighters < 2) throw std::runtime_error("The arena needs at least two fighters (the two on the keyboard).");
+				arena_fighters = size_t(fighters);
+				i += 1;
+			} else {
+				throw std::runtime_error("Unknown option '" + arg + "'.");
+			}
+		}
+		online = (host_port != 0 || !connect_host.empty());
+		if (online && (host_port != 0) == !connect_host.empty()) throw std::runtime_error("Use either --host or --connect, not both.");
+		if (online && (!record_filename.empty() || !play_filename.empty())) throw std::runtime_error("Replays can't be recorded or played during online matches.");
+		if (cpu && (online || !play_filename.empty())) throw std::runtime_error("The computer opponent can't play online or in replays.");
+		if (debug && (online || !play_filename.empty())) throw std::runtime_error("The time-travel debugger can't be used online or in replays (replays can already seek).");
+		if (arena_fighters && (online || cpu || debug || !record_filename.empty() || !play_filename.empty() || !hash_log_filename.empty())) {
+			throw std::runtime_error("The arena is only for local play (no online play, computer opponent, time-travel debugging, replays or hash logs).");
+		}
+		if (debug && !hash_log_filename.empty()) throw std::runtime_error("Hash logs can't be written while time-travel debugging (resuming from the past would rewrite history).");
+
+		if (!play_filename.empty()) {
+			playback.reset(new ReplayReader(play_filename));
+			tick_rate = playback->tick_rate; //(replays only play back at the rate they were recorded at)
+		}
+		if (!(tick_rate > 0.0f)) throw std::runtime_error("Tick rate must be positive.");
+		check_rewind_params(params);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << "Usage:\n\t" << argv[0] << " [--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [--rewind-speed <factor>] [--param <name>=<value> ...] [--record <replay file>] [--play <replay file>] [--hash-log <file>]\n"
+			<< "\t\t[--host <port> | --connect <host>:<port>] [--net-latency <ms>] [--net-jitter <ms>] [--net-loss <percent>]\n"
+			<< "\t\t[--cpu] [--cpu-budget <ms>] [--debug] [--phase-timers] [--arena <fighters>]" << std::endl;
+		return 1;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -87,7 +216,46 @@ int main(int argc, char **argv) {
 	//SDL_ShowCursor(SDL_DISABLE);
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< RewindMode >());
+	{
+		std::shared_ptr< RewindMode > mode = std::make_shared< RewindMode >(tick_rate, arena_fighters, params);
+		mode->sim.exact_hits = exact_hits;
+		mode->sim.two_rewinders = two_rewinders;
+		mode->sim.set_params(params); //(online, both players need the same params, as with --tick-rate)
+		if (playback) {
+			playback->seek(&mode->sim, 0);
+			mode->playback = std::move(playback);
+		}
+		if (!hash_log_filename.empty()) {
+			mode->hash_log.reset(new StateHashWriter(hash_log_filename));
+		}
+		if (!record_filename.empty()) {
+			mode->recording.reset(new ReplayWriter(record_filename, mode->sim));
+		}
+		if (cpu) {
+			mode->bot.reset(new MctsBot(PLAYER_TWO, tick_rate));
+			//(the search shares this thread with the game, so it gets the same share of
+			// each tick at any tick rate, rather than outgrowing short ticks)
+			mode->bot_budget = cpu_budget * (TICK_RATE / tick_rate);
+		}
+		if (debug) {
+			mode->timeline.reset(new Timeline(mode->sim));
+		}
+		if (online) {
+			mode->link.reset(new UdpLink(uint16_t(host_port)));
+			if (!connect_host.empty()) mode->link->connect(connect_host, uint16_t(connect_port));
+			mode->link->conditions = net_conditions;
+			mode->rollback.reset(new RollbackSession(&mode->sim, connect_host.empty() ? PLAYER_ONE : PLAYER_TWO));
+			if (connect_host.empty()) {
+				std::cout << "Waiting for the other player on UDP port " << mode->link->local_port << "." << std::endl;
+			}
+		}
+		Mode::set_current(mode);
+	}
+
+	if (phase_timers && !phase_timers_compiled_in()) {
+		std::cerr << "Note: --phase-timers does nothing in this build (build with 'jam -sPHASE_TIMERS=1' to have them)." << std::endl;
+	}
+	set_phase_timers(phase_timers);
 
 	//------------ main loop ------------
 
@@ -106,6 +274,10 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	//simulation time not yet covered by a call to update:
+	float const tick = 1.0f / tick_rate;
+	float accumulator = 0.0f;
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
@@ -138,28 +310,40 @@ int main(int argc, char **argv) {
 						px.a = 0xff;
 					}
 					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F2) {
+					// --- phase timers key ---
+					dump_phase_timers(std::cout);
 				}
 			}
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
+		{ //(2) call the current mode's "update" function once per whole tick of elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
 			previous_time = current_time;
 
-			//if frames are taking a very long time to process,
-			//lag to avoid spiral of death:
-			elapsed = std::min(0.1f, elapsed);
-
-			Mode::current->update(elapsed);
+			accumulator += elapsed;
+			uint32_t ticks = 0;
+			while (accumulator >= tick && ticks < MAX_CATCHUP_TICKS) {
+				Mode::current->update(tick);
+				accumulator -= tick;
+				ticks += 1;
+				if (!Mode::current) break;
+			}
 			if (!Mode::current) break;
+
+			//if frames are taking a very long time to process,
+			//drop the leftover time to avoid spiral of death:
+			if (accumulator >= tick) {
+				accumulator = std::fmod(accumulator, tick);
+			}
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
 		
-			Mode::current->draw(drawable_size);
+			Mode::current->draw(drawable_size, accumulator / tick);
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
@@ -169,6 +353,8 @@ int main(int argc, char **argv) {
 
 	//------------  teardown ------------
 
+	if (phase_timers) dump_phase_timers(std::cout);
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
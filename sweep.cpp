@@ -0,0 +1,259 @@
+//Parameter sweep over the rules constants (see RewindParams), for tuning the game without rebuilding it.
+// Usage: rewind-sweep [--grid <name>=<values>]... [--random <name>=<low>:<high>]... [--samples <n>]
+//                     [--matches <per point>] [--rounds <to win>] [--policies <a>,<b>] [--threads <n>]
+//                     [--seed <n>] [--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [--out <file.csv>]
+// <values> is a list ("0.1,0.15,0.2") or an inclusive range with a number of
+// steps ("0.1:0.2:5"). Points are every combination of the --grid values,
+// each repeated for --samples random draws of the --random parameters (so
+// --random alone is a random search, and --grid alone a grid search); the
+// other parameters keep their defaults. At every point, policy 'a' plays
+// policy 'b' --matches times (swapping sides every match), with all the
+// matches of all the points spread over every core. One CSV row per point
+// (every parameter, then the outcomes) goes to --out, or to stdout.
+
+#include "RewindSim.hpp"
+#include "Policies.hpp"
+#include "ThreadPool.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Finds a parameter by name (throws if there is no such parameter):
+static float RewindParams::*find_param(std::string const &name) {
+	for (auto const &info : rewind_param_info()) {
+		if (name == info.name) return info.value;
+	}
+	RewindParams params;
+	set_rewind_param(&params, name + "=0"); //(throws, listing the parameters there are)
+	return nullptr;
+}
+
+//Splits "name=rest" (throws if there is no '='):
+static std::pair< std::string, std::string > split_assignment(std::string const &arg) {
+	size_t equals = arg.find('=');
+	if (equals == std::string::npos) throw std::runtime_error("Expecting '<name>=...', got '" + arg + "'.");
+	return std::make_pair(arg.substr(0, equals), arg.substr(equals + 1));
+}
+
+//Parses "a,b,c" or "low:high:steps":
+static std::vector< float > parse_values(std::string const &spec) {
+	std::vector< float > values;
+	size_t colon = spec.find(':');
+	if (colon != std::string::npos) {
+		size_t colon2 = spec.find(':', colon + 1);
+		if (colon2 == std::string::npos) throw std::runtime_error("Expecting '<low>:<high>:<steps>', got '" + spec + "'.");
+		float low = std::stof(spec.substr(0, colon));
+		float high = std::stof(spec.substr(colon + 1, colon2 - colon - 1));
+		uint32_t steps = uint32_t(std::stoul(spec.substr(colon2 + 1)));
+		if (steps == 0) throw std::runtime_error("A range needs at least one step.");
+		for (uint32_t i = 0; i < steps; ++i) {
+			values.emplace_back(steps == 1 ? low : low + (high - low) * float(i) / float(steps - 1));
+		}
+	} else {
+		size_t begin = 0;
+		while (begin <= spec.size()) {
+			size_t comma = spec.find(',', begin);
+			if (comma == std::string::npos) comma = spec.size();
+			values.emplace_back(std::stof(spec.substr(begin, comma - begin)));
+			begin = comma + 1;
+		}
+	}
+	return values;
+}
+
+int main(int argc, char **argv) {
+	struct Axis {
+		std::string name;
+		float RewindParams::*value;
+		std::vector< float > values; //for --grid
+		float low = 0.0f, high = 0.0f; //for --random
+	};
+	std::vector< Axis > grid, random;
+	uint32_t samples = 1;
+	uint64_t matches = 200;
+	uint32_t rounds = 3;
+	std::string a_name = "rush", b_name = "counter";
+	uint32_t threads = 0;
+	uint32_t seed = 0;
+	float tick_rate = TICK_RATE;
+	uint32_t exact_hits = HITS_TIP;
+	uint32_t two_rewinders = 0;
+	std::string out_filename;
+
+	//every point to play, as full sets of parameters:
+	std::vector< RewindParams > points;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--grid" && i + 1 < argc) {
+				auto assignment = split_assignment(argv[i+1]);
+				Axis axis;
+				axis.name = assignment.first;
+				axis.value = find_param(axis.name);
+				axis.values = parse_values(assignment.second);
+				grid.emplace_back(axis);
+				i += 1;
+			} else if (arg == "--random" && i + 1 < argc) {
+				auto assignment = split_assignment(argv[i+1]);
+				Axis axis;
+				axis.name = assignment.first;
+				axis.value = find_param(axis.name);
+				size_t colon = assignment.second.find(':');
+				if (colon == std::string::npos) throw std::runtime_error("Expecting '" + axis.name + "=<low>:<high>'.");
+				axis.low = std::stof(assignment.second.substr(0, colon));
+				axis.high = std::stof(assignment.second.substr(colon + 1));
+				random.emplace_back(axis);
+				i += 1;
+			} else if (arg == "--samples" && i + 1 < argc) {
+				samples = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--matches" && i + 1 < argc) {
+				matches = std::stoull(argv[i+1]);
+				i += 1;
+			} else if (arg == "--rounds" && i + 1 < argc) {
+				rounds = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--policies" && i + 1 < argc) {
+				std::string pair = argv[i+1];
+				size_t comma = pair.find(',');
+				if (comma == std::string::npos) throw std::runtime_error("Expecting '--policies <a>,<b>'.");
+				a_name = pair.substr(0, comma);
+				b_name = pair.substr(comma + 1);
+				i += 1;
+			} else if (arg == "--threads" && i + 1 < argc) {
+				threads = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--seed" && i + 1 < argc) {
+				seed = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--tick-rate" && i + 1 < argc) {
+				tick_rate = std::stof(argv[i+1]);
+				i += 1;
+			} else if (arg == "--exact-hits") {
+				exact_hits = HITS_EXACT;
+			} else if (arg == "--swept-hits") {
+				exact_hits = HITS_SWEPT;
+			} else if (arg == "--two-rewinders") {
+				two_rewinders = 1;
+			} else if (arg == "--out" && i + 1 < argc) {
+				out_filename = argv[i+1];
+				i += 1;
+			} else {
+				throw std::runtime_error("Unknown option '" + arg + "'.");
+			}
+		}
+		make_policy(a_name, tick_rate); //(throw if there are no such policies)
+		make_policy(b_name, tick_rate);
+		if (samples == 0 || matches == 0) throw std::runtime_error("Need at least one sample and one match.");
+		if (rounds == 0) throw std::runtime_error("Matches need at least one round.");
+		if (!(tick_rate > 0.0f)) throw std::runtime_error("Tick rate must be positive.");
+
+		//grid points (odometer order, last axis fastest), each with 'samples' random draws:
+		std::mt19937 mt(seed);
+		std::vector< size_t > digit(grid.size(), 0);
+		while (true) {
+			RewindParams params;
+			for (size_t g = 0; g < grid.size(); ++g) params.*grid[g].value = grid[g].values[digit[g]];
+			for (uint32_t s = 0; s < samples; ++s) {
+				for (auto const &axis : random) {
+					params.*axis.value = std::uniform_real_distribution< float >(axis.low, axis.high)(mt);
+				}
+				check_rewind_params(params);
+				points.emplace_back(params);
+			}
+			size_t g = grid.size();
+			while (g > 0) {
+				g -= 1;
+				digit[g] += 1;
+				if (digit[g] < grid[g].values.size()) break;
+				digit[g] = 0;
+			}
+			if (g == 0 && (grid.empty() || digit[0] == 0)) break;
+		}
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << "Usage:\n\t" << argv[0] << " [--grid <name>=<values>]... [--random <name>=<low>:<high>]... [--samples <n>]\n"
+			<< "\t\t[--matches <per point>] [--rounds <to win>] [--policies <a>,<b>] [--threads <n>]\n"
+			<< "\t\t[--seed <n>] [--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [--out <file.csv>]\n"
+			<< "<values> is a list (0.1,0.15,0.2) or a range with a number of steps (0.1:0.2:5).\n"
+			<< "Parameters:";
+		for (auto const &info : rewind_param_info()) std::cerr << " " << info.name;
+		std::cerr << "\nPolicies:";
+		for (auto const &name : policy_names()) std::cerr << " " << name;
+		std::cerr << std::endl;
+		return 1;
+	}
+
+	std::ofstream out_file;
+	if (!out_filename.empty()) {
+		out_file.open(out_filename.c_str());
+		if (!out_file) {
+			std::cerr << "Failed to open '" << out_filename << "' for writing." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream &out = (out_filename.empty() ? std::cout : out_file);
+
+	//------------ play ------------
+
+	uint64_t const total = points.size() * matches;
+
+	ThreadPool pool(threads);
+	std::vector< std::vector< MatchTally > > per_thread(pool.size(), std::vector< MatchTally >(points.size()));
+	//each thread's own policies (made when first needed, since some are expensive to make):
+	std::vector< std::unique_ptr< BotPolicy > > policies_a(pool.size()), policies_b(pool.size());
+
+	auto start = std::chrono::high_resolution_clock::now();
+	pool.run(total, [&](size_t m, uint32_t thread) {
+		uint64_t point = m / matches;
+		uint64_t match = m % matches;
+		if (!policies_a[thread]) policies_a[thread] = make_policy(a_name, tick_rate);
+		if (!policies_b[thread]) policies_b[thread] = make_policy(b_name, tick_rate);
+
+		//sides swap every match:
+		bool swapped = (match % 2 == 1);
+		BotPolicy &one = *(swapped ? policies_b : policies_a)[thread];
+		BotPolicy &two = *(swapped ? policies_a : policies_b)[thread];
+		one.reset(uint32_t(seed * 0x9e3779b9u + m * 2));
+		two.reset(uint32_t(seed * 0x9e3779b9u + m * 2 + 1));
+
+		RewindSim sim(tick_rate, points[point]);
+		sim.exact_hits = exact_hits;
+		sim.two_rewinders = two_rewinders;
+
+		per_thread[thread][point].add(play_match(sim, one, two, rounds), swapped);
+	});
+	double seconds = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+
+	//------------ report ------------
+
+	for (auto const &info : rewind_param_info()) out << info.name << ",";
+	out << "matches," << a_name << "_wins," << b_name << "_wins,draws,timeouts,rounds,seconds_per_round,left_round_share,double_hit_share,rewinds_per_round\n";
+	uint64_t all_ticks = 0;
+	for (size_t p = 0; p < points.size(); ++p) {
+		MatchTally r;
+		for (auto const &thread_results : per_thread) r.add(thread_results[p]);
+		all_ticks += r.ticks;
+
+		out << std::setprecision(6);
+		for (auto const &info : rewind_param_info()) out << points[p].*info.value << ",";
+		double per_round = (r.rounds ? 1.0 / r.rounds : 0.0);
+		out << r.matches << "," << r.a_wins << "," << r.b_wins << "," << r.draws << "," << r.timeouts << "," << r.rounds << ","
+			<< r.round_ticks * per_round / tick_rate << "," << (r.left_rounds + r.right_rounds ? double(r.left_rounds) / (r.left_rounds + r.right_rounds) : 0.0) << "," << r.double_hits * per_round << ","
+			<< r.rewinds * per_round << "\n";
+	}
+	out << std::flush;
+
+	std::cerr << points.size() << " points x " << matches << " matches (" << all_ticks << " ticks) in " << std::fixed << std::setprecision(2) << seconds << "s on "
+		<< pool.size() << " thread" << (pool.size() == 1 ? "" : "s") << " = " << std::setprecision(2) << (all_ticks / seconds) / 1e6 << "M ticks/s" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+//Self-play tournament between computer policies (see Policies.hpp), for checking game balance.
+// Usage: rewind-tournament [--matches <per pairing>] [--rounds <to win>] [--threads <n>] [--seed <n>]
+//                          [--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [policy ...]
+// Every pair of policies plays --matches matches (swapping sides every match);
+// a match goes to the first to win --rounds rounds. Threads take matches one
+// at a time (so a slow pairing, like mcts, doesn't all land on one thread),
+// each with its own RewindSim and policies, so the runner scales with cores.
+// Reports win rates, round lengths and Elo ratings.
+
+#include "RewindSim.hpp"
+#include "Policies.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Bradley-Terry ratings from match scores (by minorization-maximization), on the Elo scale, averaging 1500.
+// Every pairing gets one extra drawn match, so a policy that never scores still gets a finite rating.
+static std::vector< double > fit_elo(uint32_t count, std::vector< uint32_t > const &a, std::vector< uint32_t > const &b,
+	std::vector< MatchTally > const &results) {
+	std::vector< double > strength(count, 1.0);
+	std::vector< double > score(count, 0.0);
+	for (size_t p = 0; p < results.size(); ++p) {
+		score[a[p]] += results[p].a_wins + 0.5 * results[p].draws + 0.5;
+		score[b[p]] += results[p].b_wins + 0.5 * results[p].draws + 0.5;
+	}
+	for (uint32_t iteration = 0; iteration < 1000; ++iteration) {
+		std::vector< double > denominator(count, 0.0);
+		for (size_t p = 0; p < results.size(); ++p) {
+			double games = double(results[p].matches + 1);
+			double d = games / (strength[a[p]] + strength[b[p]]);
+			denominator[a[p]] += d;
+			denominator[b[p]] += d;
+		}
+		double log_mean = 0.0;
+		for (uint32_t i = 0; i < count; ++i) {
+			if (denominator[i] > 0.0) strength[i] = score[i] / denominator[i];
+			log_mean += std::log(strength[i]) / count;
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			strength[i] /= std::exp(log_mean);
+		}
+	}
+	std::vector< double > elo(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		elo[i] = 1500.0 + 400.0 * std::log10(strength[i]);
+	}
+	return elo;
+}
+
+int main(int argc, char **argv) {
+	uint64_t matches = 10000;
+	uint32_t rounds = 3;
+	uint32_t threads = 0;
+	uint32_t seed = 0;
+	float tick_rate = TICK_RATE;
+	uint32_t exact_hits = HITS_TIP;
+	uint32_t two_rewinders = 0;
+	std::vector< std::string > names;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			if (arg == "--matches" && i + 1 < argc) {
+				matches = std::stoull(argv[i+1]);
+				i += 1;
+			} else if (arg == "--rounds" && i + 1 < argc) {
+				rounds = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--threads" && i + 1 < argc) {
+				threads = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--seed" && i + 1 < argc) {
+				seed = uint32_t(std::stoul(argv[i+1]));
+				i += 1;
+			} else if (arg == "--tick-rate" && i + 1 < argc) {
+				tick_rate = std::stof(argv[i+1]);
+				i += 1;
+			} else if (arg == "--exact-hits") {
+				exact_hits = HITS_EXACT;
+			} else if (arg == "--swept-hits") {
+				exact_hits = HITS_SWEPT;
+			} else if (arg == "--two-rewinders") {
+				two_rewinders = 1;
+			} else if (arg.size() > 0 && arg[0] != '-') {
+				make_policy(arg, tick_rate); //(throws if there is no such policy)
+				names.emplace_back(arg);
+			} else {
+				throw std::runtime_error("Unknown option '" + arg + "'.");
+			}
+		}
+		if (names.empty()) names = { "idle", "random", "rush", "counter" };
+		if (names.size() < 2) throw std::runtime_error("Need at least two policies.");
+		if (rounds == 0) throw std::runtime_error("Matches need at least one round.");
+		if (!(tick_rate > 0.0f)) throw std::runtime_error("Tick rate must be positive.");
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << "Usage:\n\t" << argv[0] << " [--matches <per pairing>] [--rounds <to win>] [--threads <n>] [--seed <n>]\n"
+			<< "\t\t[--tick-rate <hz>] [--exact-hits | --swept-hits] [--two-rewinders] [policy ...]\n"
+			<< "Policies:";
+		for (auto const &name : policy_names()) std::cerr << " " << name;
+		std::cerr << std::endl;
+		return 1;
+	}
+
+	//every pair of policies:
+	std::vector< uint32_t > pairing_a, pairing_b;
+	for (uint32_t i = 0; i < names.size(); ++i) {
+		for (uint32_t j = i + 1; j < names.size(); ++j) {
+			pairing_a.emplace_back(i);
+			pairing_b.emplace_back(j);
+		}
+	}
+	uint64_t const total = pairing_a.size() * matches;
+
+	ThreadPool pool(threads);
+	std::vector< std::vector< MatchTally > > per_thread(pool.size(), std::vector< MatchTally >(pairing_a.size()));
+
+	//each thread's own match and policies (made when first needed, since some are expensive to make):
+	std::vector< std::unique_ptr< RewindSim > > sims(pool.size());
+	std::vector< std::vector< std::unique_ptr< BotPolicy > > > policies(pool.size());
+	for (auto &thread_policies : policies) thread_policies.resize(names.size());
+
+	auto start = std::chrono::high_resolution_clock::now();
+	pool.run(total, [&](size_t m, uint32_t thread) {
+		uint64_t pairing = m / matches;
+		uint64_t match = m % matches;
+		if (!sims[thread]) {
+			sims[thread].reset(new RewindSim(tick_rate));
+			sims[thread]->exact_hits = exact_hits;
+			sims[thread]->two_rewinders = two_rewinders;
+		}
+		RewindSim &sim = *sims[thread];
+		for (uint32_t p : { pairing_a[pairing], pairing_b[pairing] }) {
+			if (!policies[thread][p]) policies[thread][p] = make_policy(names[p], tick_rate);
+		}
+
+		//sides swap every match:
+		bool swapped = (match % 2 == 1);
+		BotPolicy &one = *policies[thread][swapped ? pairing_b[pairing] : pairing_a[pairing]];
+		BotPolicy &two = *policies[thread][swapped ? pairing_a[pairing] : pairing_b[pairing]];
+		one.reset(uint32_t(seed * 0x9e3779b9u + m * 2));
+		two.reset(uint32_t(seed * 0x9e3779b9u + m * 2 + 1));
+
+		per_thread[thread][pairing].add(play_match(sim, one, two, rounds), swapped);
+	});
+	double seconds = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::vector< MatchTally > results(pairing_a.size());
+	for (auto const &thread_results : per_thread) {
+		for (size_t p = 0; p < results.size(); ++p) {
+			results[p].add(thread_results[p]);
+		}
+	}
+
+	//------------ report ------------
+
+	std::vector< double > elo = fit_elo(uint32_t(names.size()), pairing_a, pairing_b, results);
+
+	uint64_t all_ticks = 0;
+	for (auto const &r : results) all_ticks += r.ticks;
+
+	std::cout << std::fixed;
+	std::cout << "Pairings (" << matches << " matches each, first to " << rounds << "):\n";
+	for (size_t p = 0; p < results.size(); ++p) {
+		MatchTally const &r = results[p];
+		std::cout << "  " << std::setw(8) << names[pairing_a[p]] << " vs " << std::setw(8) << std::left << names[pairing_b[p]] << std::right
+			<< "  " << std::setw(8) << r.a_wins << " - " << std::setw(8) << r.b_wins << " - " << std::setw(8) << r.draws << " draws"
+			<< "  ";
+		if (r.rounds) std::cout << std::setprecision(2) << std::setw(7) << double(r.round_ticks) / r.rounds / tick_rate << "s";
+		else std::cout << std::setw(8) << "n/a";
+		std::cout << " per round  (" << r.timeouts << " timed out)\n";
+	}
+
+	std::vector< uint32_t > order(names.size());
+	for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+	std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y){ return elo[x] > elo[y]; });
+
+	std::cout << "Ratings:\n";
+	for (uint32_t i : order) {
+		uint64_t played = 0, won = 0, drawn = 0;
+		for (size_t p = 0; p < results.size(); ++p) {
+			if (pairing_a[p] == i) won += results[p].a_wins;
+			else if (pairing_b[p] == i) won += results[p].b_wins;
+			else continue;
+			played += results[p].matches;
+			drawn += results[p].draws;
+		}
+		std::cout << "  " << std::setw(8) << names[i]
+			<< "  Elo " << std::setprecision(0) << std::setw(5) << elo[i]
+			<< "  won " << std::setprecision(1) << std::setw(5) << (played ? 100.0 * won / played : 0.0) << "%"
+			<< "  drew " << std::setw(5) << (played ? 100.0 * drawn / played : 0.0) << "%\n";
+	}
+
+	std::cout << std::setprecision(2) << total << " matches (" << all_ticks << " ticks) in " << seconds << "s on " << pool.size() << " thread" << (pool.size() == 1 ? "" : "s")
+		<< " = " << std::setprecision(0) << total / seconds << " matches/s, " << std::setprecision(2) << (all_ticks / seconds) / 1e6 << "M ticks/s" << std::endl;
+
+	return 0;
+}